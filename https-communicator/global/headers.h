@@ -15,9 +15,28 @@
 #include <format>
 #include <print>
 #include <expected>
+#include <optional>
+#include <filesystem>
+#include <charconv>
+#include <span>
+#include <functional>
+#include <array>
 
 #include <asio.hpp>
 
+#ifdef ASIO_NO_EXCEPTIONS
+namespace asio::detail
+{
+	// Release builds run without exceptions, every asio call on the request path takes an error_code instead
+	template <typename Exception>
+	void throw_exception(const Exception& e ASIO_SOURCE_LOCATION_PARAM)
+	{
+		std::fprintf(stderr, "Unhandled asio error: %s\n", e.what());
+		std::abort();
+	}
+}
+#endif
+
 #ifdef DEBUG
 constexpr bool DEBUG_STATUS = true;
 #elif defined(NDEBUG)
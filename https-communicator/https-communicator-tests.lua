@@ -0,0 +1,125 @@
+project "https-communicator-tests"
+    location "."
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++latest"
+    staticruntime "on"
+
+    targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+
+    -- The library sources without the example main, gtest_main provides one
+    files 
+    {
+        "src/**.cpp",           
+        "include/**.h",     
+        "include/**.inl",
+        "global/**.h",
+        "global/**.cpp",
+        "tests/**.cpp",
+    }
+
+    removefiles "src/main.cpp"
+    
+    includedirs 
+    {
+        "%{IncludeDir.ASIO}",
+        "%{IncludeDir.TEST}",
+        "global",            
+        "include",           
+        "src",
+    }
+
+    libdirs "%{LibDir.TEST}"
+    links 
+    {
+        "gtest_main",
+        "gtest"
+    }
+    
+    if _OPTIONS["with-openssl"] then
+        includedirs "%{IncludeDir.OpenSSL}"
+        libdirs "%{LibDir.OpenSSL}"
+        defines
+        {
+            "OPENSSL_NO_AUTO_INIT", 
+            "OPENSSL_NO_AUTO_CLEANUP",
+            "OPENSSL_USE_STATIC_LIBS",
+        }
+        links 
+        { 
+            "libssl_static",
+            "libcrypto_static.lib",
+            "ws2_32",
+            "crypt32",
+            "user32",
+            "gdi32",
+        }
+    end
+
+    if _OPTIONS["with-timing"] then
+        defines "HTTP_ENABLE_TIMING"
+    end
+
+    if _OPTIONS["log-level"] then
+        local levels = { trace = 0, debug = 1, info = 2, warn = 3, error = 4, off = 5 }
+        defines ("HTTP_LOG_LEVEL=" .. levels[_OPTIONS["log-level"]])
+    end
+
+    if _OPTIONS["with-io-uring"] then
+        filter "system:linux"
+            defines "HTTP_USE_IO_URING"
+            links "uring"
+        filter {}
+    end
+
+    if _OPTIONS["with-zlib"] then
+        defines "HTTP_USE_ZLIB"
+        filter "system:windows"
+            links "zlibstatic"
+        filter "system:not windows"
+            links "z"
+        filter {}
+    end
+
+    defines "ASIO_STANDALONE"
+    
+    pchheader "headers.h"
+    pchsource "global/headers.cpp"
+
+    -- Toolset and compiler settings
+    filter "toolset:msc"
+        toolset "msc-v143"
+        buildoptions { "/std:c++23" } 
+        
+    filter "toolset:gcc or toolset:clang"
+        buildoptions { "-std=c++23" }
+
+    -- Configuration settings
+    filter "configurations:Debug"
+        defines "DEBUG"
+        symbols "On"
+        optimize "Off"
+        runtime  "Release"
+
+    filter "configurations:Release"
+        symbols "Off"
+        optimize "On"
+        defines { "NDEBUG", "ASIO_NO_EXCEPTIONS" }
+        exceptionhandling "Off"
+        runtime "Release"
+
+    -- Windows specific settings
+    filter "system:windows"
+        systemversion "latest"
+        defines "PLATFORM_WINDOWS"
+        links "bcrypt"
+    
+    -- Visual Studio specific settings
+    filter "action:vs*"
+        defines "_CRT_SECURE_NO_WARNINGS"
+        staticruntime "on"
+
+    -- Linux/GCC/Clang settings
+    filter "system:linux or toolset:gcc or toolset:clang"
+        buildoptions { "-include pch.h" }
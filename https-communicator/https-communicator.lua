@@ -55,6 +55,31 @@ project "https-communicator"
         }
     end
 
+    if _OPTIONS["with-timing"] then
+        defines "HTTP_ENABLE_TIMING"
+    end
+
+    if _OPTIONS["log-level"] then
+        local levels = { trace = 0, debug = 1, info = 2, warn = 3, error = 4, off = 5 }
+        defines ("HTTP_LOG_LEVEL=" .. levels[_OPTIONS["log-level"]])
+    end
+
+    if _OPTIONS["with-io-uring"] then
+        filter "system:linux"
+            defines "HTTP_USE_IO_URING"
+            links "uring"
+        filter {}
+    end
+
+    if _OPTIONS["with-zlib"] then
+        defines "HTTP_USE_ZLIB"
+        filter "system:windows"
+            links "zlibstatic"
+        filter "system:not windows"
+            links "z"
+        filter {}
+    end
+
     defines "ASIO_STANDALONE"
     
     pchheader "headers.h"
@@ -78,13 +103,15 @@ project "https-communicator"
     filter "configurations:Release"
         symbols "Off"
         optimize "On"
-        defines "NDEBUG"
+        defines { "NDEBUG", "ASIO_NO_EXCEPTIONS" }
+        exceptionhandling "Off"
         runtime "Release"
 
     -- Windows specific settings
     filter "system:windows"
         systemversion "latest"
         defines "PLATFORM_WINDOWS"
+        links "bcrypt"
     
     -- Visual Studio specific settings
     filter "action:vs*"
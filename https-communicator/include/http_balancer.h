@@ -0,0 +1,134 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "http_communicator.h"
+
+namespace communicator
+{
+
+	struct HTTPBalancerOptions
+	{
+		size_t connectTimeout = 10;
+		HTTPSocketOptions socket; // A tunnelling proxy is sent CONNECT for the chosen endpoint. unixSocketPath is ignored
+		size_t maxIdlePerEndpoint = 4; // Kept-alive connections held on to per endpoint, 0 closes each one after its response
+		size_t consecutiveFailures = 3; // Failures in a row that eject an endpoint, a connect timeout ejects at once
+		std::chrono::milliseconds baseEjection{ 5000 }; // Doubles every time the same endpoint is ejected again
+		std::chrono::milliseconds maxEjection{ 300000 };
+		double maxEjectedRatio = 0.5; // Never eject past this share of the endpoints
+		double latencyDecay = 0.2; // Weight of the newest sample in the latency average
+	};
+
+	struct HTTPEndpointStats
+	{
+		asio::ip::tcp::endpoint address;
+		size_t outstanding = 0;
+		std::chrono::microseconds latency{ 0 };
+		uint64_t requests = 0;
+		uint64_t failures = 0;
+		bool ejected = false;
+		size_t idle = 0; // Kept-alive connections waiting in the pool
+	};
+
+
+	class HTTPBalancer
+	// Spreads requests for one logical host over all of its endpoints. Each request goes to the better of two
+	// randomly chosen endpoints, scored by outstanding requests times average latency. Endpoints that keep
+	// failing are ejected for a while and then given another chance. Each endpoint keeps its own pool of
+	// kept-alive connections, an ejection closes it.
+	{
+	public:
+
+		using Exchange = std::function<std::expected<HTTPOutput, HTTPErr>(HTTPSocket& socket)>;
+
+		HTTPBalancer(std::string_view host, std::string_view port, const HTTPBalancerOptions& options = {});
+		// Balances over every address the name resolves to
+
+		HTTPBalancer(std::string_view host, const std::vector<std::string>& endpoints, const HTTPBalancerOptions& options = {});
+		// Balances over a static "address:port" list, host is still sent in the Host header
+
+		HTTPBalancer(const HTTPBalancer&) = delete;
+		HTTPBalancer& operator=(const HTTPBalancer&) = delete;
+
+		HTTPErr refresh(); // Re-resolves the name, keeping the state of endpoints that are still listed
+
+		std::expected<HTTPOutput, HTTPErr> run(HTTPMethod method, const Exchange& send);
+		// Runs send on a pooled or new connection to the chosen endpoint and records the outcome. A response that
+		// keeps the connection alive returns it to the pool. method decides whether a request that died on a
+		// pooled connection is sent again on a new one
+
+		std::expected<HTTPOutput, HTTPErr> get(
+			std::string_view path,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::expected<HTTPOutput, HTTPErr> post(
+			std::string_view path,
+			HTTPContent content,
+			std::string_view body,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::expected<HTTPOutput, HTTPErr> send(
+			HTTPMethod method,
+			HTTPContent content,
+			std::string_view path,
+			std::string_view body = "",
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::vector<HTTPEndpointStats> endpoints();
+
+	private:
+
+		using Clock = std::chrono::steady_clock;
+
+		struct Endpoint
+		{
+			asio::ip::tcp::endpoint address;
+			size_t outstanding = 0;
+			double latencyUs = 0; // 0 until the first sample, such endpoints are tried first
+			size_t failuresInRow = 0;
+			uint32_t ejections = 0;
+			Clock::time_point ejectedUntil{};
+			uint64_t requests = 0;
+			uint64_t failures = 0;
+			std::vector<HTTPSocket> idle; // On _socketContext
+		};
+
+		HTTPBalancerOptions _options;
+
+		asio::io_context _socketContext; // Only owns the pooled sockets, every exchange on them blocks
+
+		std::string _host;
+		std::string _port;
+		std::vector<std::string> _static;
+
+		std::mutex _mutex;
+		std::vector<Endpoint> _endpoints;
+
+	private:
+
+		std::expected<asio::ip::tcp::endpoint, HTTPErr> pick();
+
+		std::expected<HTTPSocket, HTTPErr> connect(asio::io_context& ioContext, const asio::ip::tcp::endpoint& address);
+
+		std::optional<HTTPSocket> take_idle(const asio::ip::tcp::endpoint& address); // Closes the stale connections it finds on the way
+
+		void release(const asio::ip::tcp::endpoint& address, HTTPSocket socket);
+
+		void report(const asio::ip::tcp::endpoint& address, HTTPErr err, Clock::duration latency);
+
+		double score(const Endpoint& endpoint) const;
+
+		size_t ejected_count(Clock::time_point now) const;
+	};
+
+}
@@ -2,19 +2,40 @@
 
 #include <asio.hpp>
 #include <expected>
+#include <filesystem>
 #include <vector>
 #include <variant>
 
 #include "http_enums.h"
+#include "http_disk_cache.h"
+#include "http_file_io.h"
+#include "http_headers.h"
+#include "http_json.h"
+#include "http_limiter.h"
+#include "http_multipart.h"
+#include "http_prepared.h"
+#include "http_range.h"
+#include "http_socket.h"
+#include "http_sse.h"
+#include "http_stream.h"
+#include "http_timing.h"
+#include "http_url.h"
+#include "http_websocket.h"
 
 namespace communicator
 {
 
+	constexpr size_t HTTP_MAX_BODY_SIZE = 1024 * 1024 * 1024;
+	// Bodies read into memory. A longer Content-Length fails with InvalidContentLength, a chunked or EOF-delimited body
+	// growing past it with MessageTooLarge. get_to_file takes a body of any size
+	constexpr size_t HTTP_BODY_RESERVE_SIZE = 16 * 1024 * 1024; // Reserved up front at most, a longer body grows as its bytes arrive
+
 	struct URLDescriptorOutput // URLDescriptorOutput
 	{
 		std::string host;
 		std::string path;
 		std::string port;
+		std::string socketPath; // Decoded, for http+unix URLs only
 	};
 
 	struct HTTPOutput
@@ -28,6 +49,14 @@ namespace communicator
 		size_t contentLength;
 		unsigned int statusCode;
 		std::string statusMessage;
+		std::string etag;
+		std::string lastModified;
+		std::string vary;
+		std::string cacheControl;
+		std::string contentRange; // "bytes first-last/total" on a 206
+#ifdef HTTP_ENABLE_TIMING
+		HTTPTiming timing;
+#endif
 	};
 
 	class HTTPCommunicator
@@ -44,6 +73,31 @@ namespace communicator
 
 		virtual std::expected<HTTPOutput, HTTPErr> get_http_output(std::string_view url = "/", const std::unordered_map<std::string, std::string>& headers = {});
 
+		virtual HTTPErr get_to_file(
+			std::string_view url,
+			const std::filesystem::path& file,
+			const HTTPFileWriteOptions& options = {},
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		virtual std::expected<std::vector<uint8_t>, HTTPErr> get_bytes_segmented(
+			std::string_view url,
+			const HTTPSegmentOptions& options = {},
+			const std::unordered_map<std::string, std::string>& headers = {});
+		// Opens connections of its own for the segments, the persistent connection is left alone
+
+		virtual HTTPErr get_to_file_segmented(
+			std::string_view url,
+			const std::filesystem::path& file,
+			const HTTPSegmentOptions& options = {},
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		virtual HTTPErr stream_events(
+			std::string_view url,
+			const HTTPEventCallback& callback,
+			const HTTPEventStreamOptions& options = {},
+			const std::unordered_map<std::string, std::string>& headers = {});
+		// Blocks on a connection of its own until the callback stops the stream or it cannot be reopened
+
 
 		virtual HTTPErr post_bytes(
 			std::string_view url,
@@ -64,14 +118,52 @@ namespace communicator
 			const std::unordered_map<std::string, std::string>& headers = {}
 		);
 
+		virtual HTTPErr post_multipart(
+			std::string_view url,
+			const HTTPMultipartBody& body,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		virtual HTTPErr post_file(
+			std::string_view url,
+			HTTPContent content,
+			const std::filesystem::path& file,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		virtual HTTPErr put_file(
+			std::string_view url,
+			HTTPContent content,
+			const std::filesystem::path& file,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		virtual std::expected<HTTPPreparedRequest, HTTPErr> prepare(
+			HTTPMethod method,
+			std::string_view url,
+			HTTPContent content = HTTPContent::None,
+			const std::unordered_map<std::string, std::string>& headers = {});
+		// Bakes this communicator's host and default headers into the head
+
+		virtual std::expected<HTTPOutput, HTTPErr> send_prepared(const HTTPPreparedRequest& request, std::string_view body = "");
+
+		virtual std::expected<HTTPOutput, HTTPErr> send_prepared(const HTTPPreparedRequest& request, const std::vector<uint8_t>& body);
+
+		virtual std::expected<HTTPCachedResponse, HTTPErr> get_cached(std::string_view url = "/", const std::unordered_map<std::string, std::string>& headers = {});
+
 		virtual void set_headers(const std::unordered_map<std::string, std::string>& headers);
-		//virtual void set_proxy(std::string_view proxyHost, uint16_t proxyPort);
+		// Sent with every request, per-request headers of the same name replace them
+
+		virtual void set_disk_cache(HTTPDiskCache* cache);
+
+		virtual void set_concurrency_limiter(HTTPConcurrencyLimiter* limiter); // Shared between communicators, nullptr turns limiting off
+
+		virtual HTTPErr set_socket_options(const HTTPSocketOptions& options); // Applied to the open connection at once and to every later one
+
+		virtual HTTPErr set_proxy(const HTTPProxy& proxy); // Closes the open connection, later ones go through the proxy. An empty host connects directly
 
 		virtual ~HTTPCommunicator();
 
 	private:
 
-		std::unordered_map<std::string, std::string> _headers;
+		HTTPHeaderBlock _defaultHeaders; // Serialized once, not per request
 		
 		std::string _requestUrl;
 
@@ -84,10 +176,15 @@ namespace communicator
 
 		asio::io_context _persistentIoContext;
 
-		std::unique_ptr<asio::ip::tcp::socket> _socket;
+		std::unique_ptr<HTTPSocket> _socket;
+		bool _connectionReused = false; // The last request went out on a connection kept alive from before
+
+		HTTPDiskCache* _diskCache = nullptr;
 
-		std::string _proxyHost = "";
-		uint16_t _proxyPort = 0;
+		HTTPConcurrencyLimiter* _limiter = nullptr;
+
+		HTTPSocketOptions _socketOptions;
+		bool _socketPathFromUrl = false; // _socketOptions.unixSocketPath came from an http+unix URL
 
 	private:
 
@@ -110,20 +207,40 @@ namespace communicator
 			const std::unordered_map<std::string, 
 			std::string>& headers = {});
 
-		HTTPErr check_before_sending_request(HTTPMethod method);
+		HTTPErr upload_file(
+			HTTPMethod method,
+			std::string_view url,
+			HTTPContent content,
+			const std::filesystem::path& file,
+			const std::unordered_map<std::string, std::string>& headers);
 
+		HTTPErr check_before_sending_request(HTTPMethod method); // Replaces a persistent connection the server has closed
 
-		std::expected<std::string, HTTPErr> write_headers(
-			HTTPMethod method,
-			HTTPConnection connenction,  
-			HTTPContent contentType,
-			std::string_view host,
-			std::string_view path,
-			std::string_view body = "",
-			const std::unordered_map<std::string, std::string>& extraHeaders = {});
+		bool replace_stale_connection(HTTPMethod method, HTTPErr err);
+		// True when err came from a reused connection closing before an idempotent request was answered and a new one is up
 
-		
-		HTTPErr attempt_to_close_socket(asio::ip::tcp::socket& socket);
+		HTTPErr attempt_to_close_socket(HTTPSocket& socket);
+
+		template <typename Send>
+		std::expected<HTTPOutput, HTTPErr> limited(Send&& send)
+		// Runs send through the concurrency limiter when one is set
+		{
+			if (!_limiter)
+				return send();
+
+			return _limiter->run(_requestHost, _requestPort, std::forward<Send>(send));
+		}
+
+		template <typename Send>
+		std::expected<HTTPOutput, HTTPErr> persistent_exchange(HTTPMethod method, Send&& send)
+		// Runs send on the persistent connection, a second time on a new one if the reused connection was found stale
+		{
+			auto output = limited(send);
+			if (output.has_value() || !replace_stale_connection(method, output.error()))
+				return output;
+
+			return limited(send);
+		}
 	};
 
 
@@ -133,7 +250,7 @@ namespace communicator
 		std::string_view url, 
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
 	
 
 	std::expected<HTTPOutput, HTTPErr> get(
@@ -141,7 +258,16 @@ namespace communicator
 		std::string_view path, std::string_view port, 
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close, 
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
+	
+
+	std::expected<HTTPOutput, HTTPErr> get_to_file( // The returned output has an empty body, contentLength is the size written
+		std::string_view url,
+		const std::filesystem::path& file,
+		const HTTPFileWriteOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr);
 	
 
 	// --- POST Methods ---
@@ -153,7 +279,7 @@ namespace communicator
 		std::string_view body, 
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
 
 	
 	std::expected<HTTPOutput, HTTPErr> post(
@@ -164,7 +290,7 @@ namespace communicator
 		std::string_view body,
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
 
 		// -- POST Methods with Byte Data --
 
@@ -176,7 +302,7 @@ namespace communicator
 		const std::vector<uint8_t>& body,
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
 
 
 	std::expected<HTTPOutput, HTTPErr> post(
@@ -185,7 +311,37 @@ namespace communicator
 		const std::vector<uint8_t>& body,
 		const std::unordered_map<std::string, std::string>& headers = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
+
+
+	// -- File Upload Methods --
+
+	std::expected<HTTPOutput, HTTPErr> post_file(
+		std::string_view url,
+		HTTPContent content,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& headers = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr);
+
+
+	std::expected<HTTPOutput, HTTPErr> put_file(
+		std::string_view url,
+		HTTPContent content,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& headers = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr);
+
+
+	// -- Multipart Methods --
+
+	std::expected<HTTPOutput, HTTPErr> post_multipart(
+		std::string_view url,
+		const HTTPMultipartBody& body,
+		const std::unordered_map<std::string, std::string>& headers = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr);
 
 
 	// --- Decryption ---
@@ -214,7 +370,9 @@ namespace communicator
 		std::string_view body = "",
 		const std::unordered_map<std::string, std::string>& extraHeaders = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr,
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
 
 
 	std::expected<HTTPOutput, HTTPErr> send_http_request( // For sending POST requests with byte data
@@ -225,7 +383,63 @@ namespace communicator
 		const std::vector<uint8_t>& body,
 		const std::unordered_map<std::string, std::string>& extraHeaders = {},
 		HTTPConnection connection = HTTPConnection::Close,
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr,
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+
+	std::expected<HTTPOutput, HTTPErr> send_file_request( // Streams the body from a file instead of memory
+		HTTPMethod method,
+		HTTPContent content,
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& extraHeaders = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr,
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+
+	std::expected<HTTPOutput, HTTPErr> send_multipart_request(
+		HTTPMethod method,
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPMultipartBody& body,
+		const std::unordered_map<std::string, std::string>& extraHeaders = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr,
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+
+	std::expected<HTTPOutput, HTTPErr> send_download_request( // Streams the response body into a file instead of memory
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const HTTPFileWriteOptions& options = {},
+		const std::unordered_map<std::string, std::string>& extraHeaders = {},
+		HTTPConnection connection = HTTPConnection::Close,
+		HTTPSocket* socket = nullptr,
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+
+	std::expected<HTTPOutput, HTTPErr> send_prepared_request( // Writes only the length per call, head and body in one gathered write
+		const HTTPPreparedRequest& request,
+		std::string_view body,
+		HTTPSocket* socket = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+
+	std::expected<HTTPOutput, HTTPErr> send_prepared_request(
+		const HTTPPreparedRequest& request,
+		const std::vector<uint8_t>& body,
+		HTTPSocket* socket = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
 
 
 	std::expected<HTTPOutput, HTTPErr> send_raw_http_request(
@@ -233,14 +447,62 @@ namespace communicator
 		std::string_view path, 
 		std::string_view port, 
 		std::string_view request, 
-		asio::ip::tcp::socket* socket = nullptr);
+		HTTPSocket* socket = nullptr);
 
-	void send_close_http_request(asio::ip::tcp::socket& socket,std::string_view host, std::string_view port, std::string_view path = "/");
+	void send_close_http_request(HTTPSocket& socket,std::string_view host, std::string_view port, std::string_view path = "/");
 
 
 	// --- Request Writing Methods ---
 
-	std::expected<HTTPOutput, HTTPErr> read_http_response(asio::ip::tcp::socket& socket);
+	std::expected<HTTPOutput, HTTPErr> read_http_response(HTTPSocket& socket, HTTPTiming* timing = nullptr);
+
+	std::expected<HTTPOutput, HTTPErr> read_http_response(HTTPStream& stream, HTTPTiming* timing = nullptr);
+
+	std::expected<HTTPOutput, HTTPErr> read_http_response( // Continues from whatever is already in responseBuffer
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		HTTPTiming* timing = nullptr,
+		bool anyStatus = false);
+
+	std::expected<bool, HTTPErr> await_continue(
+		// After a head sent with Expect: 100-continue. True once the body should follow, on 100 Continue or after timeout
+		// from a server that ignores Expect. False when a final answer came first, it is left in responseBuffer
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		std::chrono::milliseconds timeout);
+
+	std::expected<HTTPOutput, HTTPErr> read_http_head( // Leaves any body bytes already received in responseBuffer
+		// Skips interim 1xx answers but 101. Statuses other than 200, 206 and 304 fail with ResponseError unless anyStatus is set
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		HTTPTiming* timing = nullptr,
+		bool anyStatus = false);
+
+	HTTPErr read_http_body( // The rest of read_http_response, head is the one read_http_head returned
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		HTTPOutput& head,
+		HTTPTiming* timing = nullptr);
+
+	std::optional<size_t> buffered_head_size(std::string_view bytes);
+	// The length of the final head at the start of bytes, interim heads included, nullopt while it is still incomplete.
+	// Once it is known read_http_head parses the buffered bytes without reading from the socket
+
+	std::optional<size_t> buffered_body_size(std::string_view bytes, const HTTPOutput& head);
+	// The same for the body following head, nullopt while it is incomplete or until EOF for a body the server
+	// ends by closing the connection. A malformed chunk line counts as complete, read_http_body reports it
+
+	HTTPErr read_body_to_bytes(
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		const HTTPOutput& head,
+		std::vector<uint8_t>& body);
+
+	HTTPErr read_body_to_file(
+		HTTPStream& stream,
+		asio::streambuf& responseBuffer,
+		const HTTPOutput& head,
+		HTTPFileSink& sink);
 
 
 	// --- Helper Methods ---
@@ -252,19 +514,67 @@ namespace communicator
 		std::string_view host,
 		std::string_view path,
 		std::string_view body = "",
-		const std::unordered_map<std::string, std::string>& extraHeaders = {});
+		const std::unordered_map<std::string, std::string>& extraHeaders = {},
+		const HTTPHeaderBlock* defaultHeaders = nullptr);
+
+	std::expected<std::string, HTTPErr> write_str_request( // Writes only the head, without a length the body must be sent chunked
+		HTTPMethod method,
+		HTTPContent contentType,
+		HTTPConnection connenction,
+		std::string_view host,
+		std::string_view path,
+		std::optional<uint64_t> contentLength,
+		const std::unordered_map<std::string, std::string>& extraHeaders = {},
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		bool expectContinue = false); // Adds Expect: 100-continue to a head with a body, see await_continue
 
-	std::expected<asio::ip::tcp::socket, HTTPErr> create_and_connect_socket(
-		// Remember to move the result into the socket variable
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_socket(
+		// Remember to move the result into the socket variable. Through the proxy in socketOptions when one is set,
+		// a tunnelling proxy has been sent CONNECT host:port by the time it returns
 		asio::io_context& ioContext,
 		std::string_view host,
 		std::string_view port, 
-		size_t requestTimeout);
+		size_t requestTimeout,
+		HTTPTiming* timing = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_local_socket(
+		// Connects to a Unix domain socket. The request writers, the response readers and the connection pools
+		// take it like a TCP connection
+		asio::io_context& ioContext,
+		std::string_view socketPath,
+		size_t requestTimeout,
+		HTTPTiming* timing = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_socket( // Tries the already resolved endpoints in order
+		asio::io_context& ioContext,
+		const asio::ip::tcp::resolver::results_type& endpoints,
+		size_t requestTimeout,
+		HTTPTiming* timing = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+	HTTPSocketOptions socket_options_for(const HTTPURLView& url); // Routes an http+unix URL to its socket, the defaults otherwise
+
+	bool expects_continue(const HTTPSocketOptions& options, uint64_t contentLength); // The body is past expectContinueThreshold
 
 	HTTPErr is_valid_http_request(std::string_view request);
 
+	HTTPErr to_http_err(const asio::error_code& ec, HTTPErr fallback); // Maps the socket errors callers can act on, everything else becomes the fallback
+
+	bool is_connection_alive(HTTPSocket& socket);
+	// Checks an idle kept-alive connection without blocking, false once the server closed or reset it or sent unasked-for bytes
+
+	bool is_idempotent(HTTPMethod method); // Safe to send again when a connection dies before the response starts
+
 	std::string istream_to_string(std::istream& stream);
 
+	std::string_view trim_header_value(std::string_view value);
+
+	bool has_header(const std::unordered_map<std::string, std::string>& headers, std::string_view name);
+
+	std::expected<HTTPJSONValue, HTTPErr> json_view(const HTTPOutput& output); // Reads the body in place, the output must outlive the view
+
 	bool is_str_data(HTTPContent content);
 
 	bool is_binary_data(HTTPContent content);
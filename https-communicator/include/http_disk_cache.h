@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "http_enums.h"
+
+namespace communicator
+{
+
+	struct HTTPOutput;
+
+	constexpr uint64_t HTTP_DISK_CACHE_MAX_SIZE = 256ull * 1024 * 1024;
+	// For the cache file. A store that would grow it past the limit fails with CacheFull until the cache is opened again
+
+	struct HTTPCachedResponse
+	{
+		std::span<const uint8_t> body; // Points into the cache mapping, valid until the cache is closed
+		HTTPContent contentType;
+		HTTPContentEncoding contentEncoding;
+		unsigned int statusCode;
+		std::string_view etag;
+		std::string_view lastModified;
+		int64_t storedAt;
+		std::shared_ptr<const HTTPOutput> uncached; // Set for a response the cache refused, the views point into it instead
+	};
+
+	class HTTPDiskCache
+	// Append-only, memory-mapped response store keyed by URL plus the request headers named in Vary. Opening it rewrites
+	// the file without the records a newer one replaced, and without the oldest ones when the rest exceed the size limit
+	{
+	public:
+
+		HTTPDiskCache() = default;
+
+		explicit HTTPDiskCache(const std::filesystem::path& directory, uint64_t maxSize = HTTP_DISK_CACHE_MAX_SIZE);
+
+		HTTPDiskCache(const HTTPDiskCache&) = delete;
+		HTTPDiskCache& operator=(const HTTPDiskCache&) = delete;
+
+		HTTPErr open(const std::filesystem::path& directory, uint64_t maxSize = HTTP_DISK_CACHE_MAX_SIZE);
+
+		void close();
+
+		bool is_open() const;
+
+		std::expected<HTTPCachedResponse, HTTPErr> lookup(
+			std::string_view url,
+			const std::unordered_map<std::string, std::string>& requestHeaders = {});
+
+		std::expected<HTTPCachedResponse, HTTPErr> store(
+			std::string_view url,
+			const std::unordered_map<std::string, std::string>& requestHeaders,
+			const HTTPOutput& output);
+
+		size_t entry_count() const;
+
+		~HTTPDiskCache();
+
+	private:
+
+		struct MappedRegion
+		{
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+			void* mappingHandle = nullptr;
+		};
+
+		std::filesystem::path _filePath;
+
+		intptr_t _fileHandle = -1;
+
+		// Older regions stay mapped so views handed out before a remap remain valid
+		std::vector<MappedRegion> _regions;
+
+		uint64_t _logicalSize = 0;
+		uint64_t _capacity = 0;
+		uint64_t _maxSize = HTTP_DISK_CACHE_MAX_SIZE;
+
+		// Hash of the full cache key -> record offset, and hash of the URL -> newest record for that URL
+		std::unordered_map<uint64_t, uint64_t> _index;
+		std::unordered_map<uint64_t, uint64_t> _urlIndex;
+
+	private:
+
+		HTTPErr open_file();
+
+		HTTPErr compact(); // Only while no view into the file has been handed out
+
+		HTTPErr scan_records();
+
+		HTTPErr ensure_capacity(uint64_t size);
+
+		HTTPErr map_file();
+
+		HTTPErr write_at(uint64_t offset, std::span<const uint8_t> data);
+
+		const uint8_t* record_at(uint64_t offset) const;
+
+		HTTPCachedResponse make_response(uint64_t offset) const;
+
+		std::string build_key(
+			std::string_view url,
+			std::string_view varyNames,
+			const std::unordered_map<std::string, std::string>& requestHeaders) const;
+
+		void release_regions();
+	};
+
+}
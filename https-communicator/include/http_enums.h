@@ -61,6 +61,9 @@ namespace communicator
 
 		//Unsupported Yet:
 		ApplicationOctetStream,
+
+		MultipartFormData,
+		TextEventStream,
 	};
 
 
@@ -109,6 +112,35 @@ namespace communicator
 		ChunkedEncodingNotSupported,
 		UnsupportedTransferEncoding,
 		UnsupportedContentEncoding,
+		CacheMiss,
+		CacheUnavailable,
+		NotCacheable,
+		FileIOFailed,
+		SendFailed,
+		ReceiveFailed,
+		ConnectionClosed,
+		ConnectionTimeout,
+		InvalidStatusLine,
+		InvalidContentLength,
+		InvalidChunkSize,
+		ConcurrencyLimited,
+		InvalidHeader,
+		InvalidJSON,
+		JSONTypeMismatch,
+		JSONFieldNotFound,
+		BatchCancelled,
+		ClosedBeforeResponse,
+		SocketOptionFailed,
+		LocalSocketUnsupported,
+		ProxyConnectFailed,
+		InvalidContentRange,
+		ResourceChanged,
+		WebSocketHandshakeFailed,
+		WebSocketProtocolError,
+		WebSocketClosed,
+		MessageTooLarge,
+		RandomSourceFailed,
+		CacheFull,
 
 	};
 
@@ -51,6 +51,7 @@ namespace communicator
 			return static_cast<uint32_t>(HTTPConnection::Close);
 		else if (method.find("upgrade") != std::string_view::npos)
 			return static_cast<uint32_t>(HTTPConnection::Upgrade);
+		return static_cast<uint32_t>(HTTPConnection::None);
 	}
 
 	template<>
@@ -78,6 +79,12 @@ namespace communicator
 			return static_cast<uint32_t>(HTTPContent::ImageJPEG);
 		else if (content.find("image/gif") != std::string_view::npos)
 			return static_cast<uint32_t>(HTTPContent::ImageGIF);
+		else if (content.find("application/octet-stream") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPContent::ApplicationOctetStream);
+		else if (content.find("multipart/form-data") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPContent::MultipartFormData);
+		else if (content.find("text/event-stream") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPContent::TextEventStream);
 		return 0;
 	}
 
@@ -106,6 +113,64 @@ namespace communicator
 			return static_cast<uint32_t>(HTTPErr::NoBodyForMethod);
 		else if (err.find("Chunked Encoding Not Supported") != std::string_view::npos)
 			return static_cast<uint32_t>(HTTPErr::ChunkedEncodingNotSupported);
+		else if (err.find("Cache Miss") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::CacheMiss);
+		else if (err.find("Cache Unavailable") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::CacheUnavailable);
+		else if (err.find("Not Cacheable") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::NotCacheable);
+		else if (err.find("File IO Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::FileIOFailed);
+		else if (err.find("Send Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::SendFailed);
+		else if (err.find("Receive Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ReceiveFailed);
+		else if (err.find("Connection Closed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ConnectionClosed);
+		else if (err.find("Connection Timeout") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ConnectionTimeout);
+		else if (err.find("Invalid Status Line") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidStatusLine);
+		else if (err.find("Invalid Content Length") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidContentLength);
+		else if (err.find("Invalid Chunk Size") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidChunkSize);
+		else if (err.find("Concurrency Limited") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ConcurrencyLimited);
+		else if (err.find("Invalid Header") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidHeader);
+		else if (err.find("Invalid JSON") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidJSON);
+		else if (err.find("JSON Type Mismatch") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::JSONTypeMismatch);
+		else if (err.find("JSON Field Not Found") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::JSONFieldNotFound);
+		else if (err.find("Batch Cancelled") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::BatchCancelled);
+		else if (err.find("Closed Before Response") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ClosedBeforeResponse);
+		else if (err.find("Socket Option Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::SocketOptionFailed);
+		else if (err.find("Local Socket Unsupported") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::LocalSocketUnsupported);
+		else if (err.find("Proxy Connect Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ProxyConnectFailed);
+		else if (err.find("Invalid Content Range") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::InvalidContentRange);
+		else if (err.find("Resource Changed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::ResourceChanged);
+		else if (err.find("WebSocket Handshake Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::WebSocketHandshakeFailed);
+		else if (err.find("WebSocket Protocol Error") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::WebSocketProtocolError);
+		else if (err.find("WebSocket Closed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::WebSocketClosed);
+		else if (err.find("Message Too Large") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::MessageTooLarge);
+		else if (err.find("Random Source Failed") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::RandomSourceFailed);
+		else if (err.find("Cache Full") != std::string_view::npos)
+			return static_cast<uint32_t>(HTTPErr::CacheFull);
 		return 0;
 	}
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <asio.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "http_enums.h"
+#include "http_stream.h"
+
+namespace communicator
+{
+
+	constexpr size_t FILE_IO_CHUNK_SIZE = 256 * 1024;
+
+
+	enum class HTTPFileSync : uint32_t
+	{
+		None,
+		OnComplete,
+		Periodic,
+	};
+
+	struct HTTPFileWriteOptions
+	{
+		HTTPFileSync sync = HTTPFileSync::None;
+		uint64_t syncInterval = 64ull * 1024 * 1024; // Bytes between syncs with HTTPFileSync::Periodic
+		bool atomicRename = true; // Download into "<path>.part" and rename over the target on completion
+		bool preallocate = true;
+	};
+
+
+	class HTTPFileSink
+	// Writes a response body to disk with a bounded amount of memory
+	{
+	public:
+
+		HTTPFileSink() = default;
+
+		HTTPFileSink(const HTTPFileSink&) = delete;
+		HTTPFileSink& operator=(const HTTPFileSink&) = delete;
+
+		HTTPErr open(const std::filesystem::path& path, const HTTPFileWriteOptions& options, uint64_t expectedSize = 0);
+
+		HTTPErr write(std::span<const uint8_t> data);
+
+		HTTPErr write_from_stream(
+			// Moves length bytes from the stream to the file, or everything up to EOF when untilEof is set
+			HTTPStream& stream,
+			uint64_t length,
+			bool untilEof = false);
+
+		HTTPErr commit();
+
+		void abort();
+
+		uint64_t bytes_written() const;
+
+		~HTTPFileSink();
+
+	private:
+
+		std::filesystem::path _targetPath;
+		std::filesystem::path _writePath;
+
+		HTTPFileWriteOptions _options;
+
+		int _fd = -1;
+		int _pipe[2] = { -1, -1 };
+		bool _spliceSupported = true;
+
+		std::ofstream _stream;
+
+		std::vector<uint8_t> _buffer;
+
+		uint64_t _written = 0;
+		uint64_t _preallocated = 0;
+		uint64_t _lastSync = 0;
+
+	private:
+
+		HTTPErr splice_from_socket(HTTPSocket& socket, uint64_t& remaining, bool untilEof);
+
+		HTTPErr maybe_sync();
+
+		void close_handles();
+	};
+
+
+	// --- File Transfer Methods ---
+
+	HTTPErr send_file_body(
+		// Streams length bytes of the file into the socket, with sendfile(2) where available
+		HTTPSocket& socket,
+		const std::filesystem::path& path,
+		uint64_t length);
+
+}
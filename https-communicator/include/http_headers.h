@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace communicator
+{
+
+	class HTTPHeaderBlock
+	// Default headers serialized once into wire format. A request header with the same name, compared
+	// case-insensitively, replaces the default instead of being sent next to it.
+	{
+	public:
+
+		HTTPHeaderBlock() = default;
+
+		explicit HTTPHeaderBlock(const std::unordered_map<std::string, std::string>& headers);
+
+		void assign(const std::unordered_map<std::string, std::string>& headers);
+
+		void clear();
+
+		bool empty() const;
+
+		bool contains(std::string_view name) const;
+
+		std::string_view wire() const; // Every header as "Name: value\r\n"
+
+		void append_to(std::string& out, const std::unordered_map<std::string, std::string>& overrides) const;
+		// Appends the defaults overrides does not replace, one append when there are no overrides
+
+	private:
+
+		struct Entry
+		{
+			uint32_t offset = 0;
+			uint32_t length = 0; // The whole line including "\r\n"
+			uint32_t nameLength = 0;
+		};
+
+		std::string _wire;
+		std::vector<Entry> _entries;
+
+	private:
+
+		std::string_view name_of(const Entry& entry) const;
+	};
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "http_enums.h"
+
+namespace communicator
+{
+
+	enum class HTTPJSONType : uint32_t
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object,
+		Invalid
+	};
+
+
+	class HTTPJSONValue
+	// One value inside a JSON document the view does not own, e.g. a response body. Nothing is tokenized until
+	// a field, element or scalar is asked for, and the values passed on the way are skipped by a SIMD scan for
+	// quotes and brackets instead of being parsed. Malformed JSON is only reported where it is walked over.
+	{
+	public:
+
+		HTTPJSONValue() = default;
+
+		explicit HTTPJSONValue(std::string_view document); // The root value, leading whitespace is skipped
+
+		HTTPJSONType type() const; // From the first byte only
+
+		std::expected<HTTPJSONValue, HTTPErr> find(std::string_view key) const; // The first field named key
+
+		std::expected<HTTPJSONValue, HTTPErr> at(size_t index) const;
+
+		std::expected<HTTPJSONValue, HTTPErr> at_pointer(std::string_view pointer) const; // RFC 6901, e.g. "/items/0/id"
+
+		std::expected<std::string_view, HTTPErr> get_raw_string() const; // Between the quotes, escapes left in place
+
+		HTTPErr get_string(std::string& out) const; // Unescaped into out, which keeps its capacity
+
+		std::expected<int64_t, HTTPErr> get_int64() const;
+
+		std::expected<double, HTTPErr> get_double() const;
+
+		std::expected<bool, HTTPErr> get_bool() const;
+
+		bool is_null() const;
+
+		std::expected<std::string_view, HTTPErr> raw() const; // The value exactly as it appears in the document
+
+		template <typename Fn>
+		HTTPErr for_each_element(Fn&& fn) const
+		// fn(HTTPJSONValue) for every element of an array
+		{
+			size_t pos = 0;
+			bool done = false;
+
+			HTTPErr err = open_container('[', pos, done);
+			while (err == HTTPErr::None && !done)
+			{
+				HTTPJSONValue value;
+				err = next_item(pos, nullptr, value, done);
+				if (err == HTTPErr::None && !done)
+					fn(value);
+			}
+			return err;
+		}
+
+		template <typename Fn>
+		HTTPErr for_each_member(Fn&& fn) const
+		// fn(std::string_view key, HTTPJSONValue) for every field of an object, the key as get_raw_string returns it
+		{
+			size_t pos = 0;
+			bool done = false;
+
+			HTTPErr err = open_container('{', pos, done);
+			while (err == HTTPErr::None && !done)
+			{
+				std::string_view key;
+				HTTPJSONValue value;
+				err = next_item(pos, &key, value, done);
+				if (err == HTTPErr::None && !done)
+					fn(key, value);
+			}
+			return err;
+		}
+
+	private:
+
+		std::string_view _json; // From the first byte of this value to the end of the document
+
+	private:
+
+		HTTPErr open_container(char open, size_t& pos, bool& done) const;
+
+		HTTPErr next_item(size_t& pos, std::string_view* key, HTTPJSONValue& value, bool& done) const;
+		// Reads the item at pos and moves pos past it and its separator, done is set at the closing bracket
+
+		std::string_view scalar() const; // The bytes of a number or literal
+	};
+
+}
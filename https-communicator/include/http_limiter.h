@@ -0,0 +1,151 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "http_enums.h"
+
+namespace communicator
+{
+
+	struct HTTPLimiterOptions
+	{
+		size_t initialLimit = 8;
+		size_t minLimit = 1;
+		size_t maxLimit = 256;
+		double backoffRatio = 0.9; // Multiplied into the limit on every dropped request
+		double latencyTolerance = 2.0; // A success slower than this multiple of the baseline latency counts as dropped
+		size_t maxQueue = 64; // Callers waiting for a slot, anyone past this fails fast
+		std::chrono::milliseconds queueTimeout{ 1000 }; // 0 never waits, over-limit requests fail immediately
+		size_t baselineWindow = 500; // Samples after which the baseline latency is re-measured
+	};
+
+	struct HTTPLimiterStats
+	{
+		size_t limit = 0;
+		size_t inFlight = 0;
+		size_t queued = 0;
+		uint64_t rejected = 0;
+		std::chrono::microseconds baselineLatency{ 0 };
+	};
+
+	enum class HTTPLimiterOutcome : uint32_t
+	{
+		Success,
+		Dropped, // Timed out or failed in a way that points at an overloaded backend
+		Ignored // Says nothing about the backend, e.g. a local file error
+	};
+
+
+	class HTTPConcurrencyLimiter;
+
+	class HTTPLimiterPermit
+	// One admitted request. Releasing it reports the outcome, a permit that is just destroyed counts as Ignored.
+	{
+	public:
+
+		HTTPLimiterPermit() = default;
+
+		HTTPLimiterPermit(HTTPLimiterPermit&& other) noexcept;
+		HTTPLimiterPermit& operator=(HTTPLimiterPermit&& other) noexcept;
+
+		HTTPLimiterPermit(const HTTPLimiterPermit&) = delete;
+		HTTPLimiterPermit& operator=(const HTTPLimiterPermit&) = delete;
+
+		~HTTPLimiterPermit();
+
+		void release(HTTPLimiterOutcome outcome);
+
+	private:
+
+		friend class HTTPConcurrencyLimiter;
+
+		HTTPConcurrencyLimiter* _limiter = nullptr;
+		void* _host = nullptr;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+
+	class HTTPConcurrencyLimiter
+	// Per-(host, port) AIMD limit on requests in flight. The limit grows by one per window of fast successes
+	// while the host is kept busy, and shrinks by backoffRatio whenever a request fails or runs slow.
+	{
+	public:
+
+		explicit HTTPConcurrencyLimiter(const HTTPLimiterOptions& options = {});
+
+		HTTPConcurrencyLimiter(const HTTPConcurrencyLimiter&) = delete;
+		HTTPConcurrencyLimiter& operator=(const HTTPConcurrencyLimiter&) = delete;
+
+		std::expected<HTTPLimiterPermit, HTTPErr> acquire(std::string_view host, std::string_view port);
+		// Queues for up to queueTimeout when the host is at its limit
+
+		std::expected<HTTPLimiterPermit, HTTPErr> try_acquire(std::string_view host, std::string_view port);
+		// Never waits, for callers that must not block such as runtime shards
+
+		template <typename Send>
+		auto run(std::string_view host, std::string_view port, Send&& send, bool wait = true) -> std::invoke_result_t<Send&>
+		// Admits, runs and reports one request, send returns a std::expected with an HTTPErr error
+		{
+			auto permit = wait ? acquire(host, port) : try_acquire(host, port);
+			if (!permit.has_value())
+			{
+				return std::unexpected(permit.error());
+			}
+
+			auto output = send();
+			permit->release(output.has_value() ? HTTPLimiterOutcome::Success : classify(output.error()));
+			return output;
+		}
+
+		HTTPLimiterStats stats(std::string_view host, std::string_view port);
+
+		std::vector<std::pair<std::string, HTTPLimiterStats>> snapshot(); // Every host seen so far, keyed "host:port"
+
+		static HTTPLimiterOutcome classify(HTTPErr err);
+
+	private:
+
+		struct HostState
+		{
+			std::mutex mutex;
+			std::condition_variable available;
+
+			double limit = 0;
+			size_t inFlight = 0;
+			size_t queued = 0;
+			uint64_t rejected = 0;
+
+			int64_t baselineUs = 0; // 0 until the first sample
+			int64_t windowMinUs = 0;
+			size_t windowSamples = 0;
+		};
+
+		friend class HTTPLimiterPermit;
+
+		HTTPLimiterOptions _options;
+
+		std::mutex _hostsMutex;
+		std::unordered_map<std::string, std::unique_ptr<HostState>> _hosts;
+
+	private:
+
+		HostState& host_state(std::string_view host, std::string_view port);
+
+		HTTPLimiterPermit admit(HostState& state);
+
+		void complete(HostState& state, HTTPLimiterOutcome outcome, std::chrono::steady_clock::duration latency);
+
+		HTTPLimiterStats stats_of(HostState& state);
+	};
+
+}
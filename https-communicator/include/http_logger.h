@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <string_view>
+
+
+// Records below HTTP_LOG_LEVEL are discarded at compile time, the premake option --log-level=<name> overrides the default
+// 0 Trace, 1 Debug, 2 Info, 3 Warn, 4 Error, 5 Off
+
+#ifndef HTTP_LOG_LEVEL
+#ifdef NDEBUG
+#define HTTP_LOG_LEVEL 4
+#else
+#define HTTP_LOG_LEVEL 1
+#endif
+#endif
+
+
+namespace communicator
+{
+
+	enum class HTTPLogLevel : uint32_t
+	{
+		Trace = 0,
+		Debug,
+		Info,
+		Warn,
+		Error,
+		Off,
+	};
+
+	constexpr bool log_enabled(HTTPLogLevel level)
+	{
+		return static_cast<uint32_t>(level) >= HTTP_LOG_LEVEL && level != HTTPLogLevel::Off;
+	}
+
+	std::string_view to_string(HTTPLogLevel level);
+
+
+	constexpr size_t HTTP_LOG_RECORD_SIZE = 512;
+	constexpr size_t HTTP_LOG_RING_CAPACITY = 256; // Records per thread, must be a power of two
+
+	struct alignas(64) HTTPLogRecord
+	// One fixed-size slot in a thread's ring, messages longer than the slot are truncated
+	{
+		uint64_t timestamp = 0; // Nanoseconds since the Unix epoch
+		uint32_t thread = 0; // Small id assigned when the thread first logs
+		HTTPLogLevel level = HTTPLogLevel::Info;
+		uint32_t length = 0;
+		bool truncated = false;
+
+		static constexpr size_t MESSAGE_CAPACITY = HTTP_LOG_RECORD_SIZE - sizeof(uint64_t) - 3 * sizeof(uint32_t) - 8;
+
+		char message[MESSAGE_CAPACITY];
+
+		std::string_view text() const { return std::string_view(message, length); }
+	};
+
+	static_assert(sizeof(HTTPLogRecord) == HTTP_LOG_RECORD_SIZE);
+	static_assert((HTTP_LOG_RING_CAPACITY & (HTTP_LOG_RING_CAPACITY - 1)) == 0);
+
+
+	class HTTPLogRing
+	// Single producer (the owning thread), single consumer (the drain thread)
+	{
+	public:
+
+		explicit HTTPLogRing(uint32_t thread);
+
+		HTTPLogRecord* try_reserve(); // Producer side, nullptr when the ring is full
+
+		void publish();
+
+		const HTTPLogRecord* front() const; // Consumer side, nullptr when the ring is empty
+
+		void pop();
+
+		uint32_t thread() const;
+
+		std::atomic<uint64_t> dropped = 0;
+		std::atomic<bool> retired = false; // Set when the owning thread exits
+
+	private:
+
+		alignas(64) std::atomic<uint64_t> _head = 0;
+		alignas(64) std::atomic<uint64_t> _tail = 0;
+
+		uint32_t _thread;
+
+		std::array<HTTPLogRecord, HTTP_LOG_RING_CAPACITY> _records;
+	};
+
+
+	class HTTPLogger
+	// Logging call sites only format into their own thread's ring, a background thread writes the records out
+	{
+	public:
+
+		using Sink = std::function<void(const HTTPLogRecord& record)>;
+
+		template <typename... Args>
+		static void write(HTTPLogLevel level, std::format_string<Args...> format, Args&&... args)
+		{
+			HTTPLogRing& ring = thread_ring();
+
+			HTTPLogRecord* record = ring.try_reserve();
+			if (!record)
+			{
+				ring.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			auto result = std::format_to_n(record->message, HTTPLogRecord::MESSAGE_CAPACITY, format, std::forward<Args>(args)...);
+
+			record->timestamp = now_ns();
+			record->thread = ring.thread();
+			record->level = level;
+			record->truncated = static_cast<size_t>(result.size) > HTTPLogRecord::MESSAGE_CAPACITY;
+			record->length = static_cast<uint32_t>(record->truncated ? HTTPLogRecord::MESSAGE_CAPACITY : result.size);
+
+			ring.publish();
+		}
+
+		static void set_sink(Sink sink); // Runs on the drain thread, the default sink prints Warn and above to stderr, the rest to stdout
+
+		static void flush(); // Blocks until every record published before the call has reached the sink
+
+		static uint64_t dropped(); // Records lost because a ring was full
+
+	private:
+
+		static HTTPLogRing& thread_ring();
+
+		static uint64_t now_ns();
+	};
+
+}
+
+
+#define HTTP_LOG(level, ...) do { if constexpr (::communicator::log_enabled(level)) ::communicator::HTTPLogger::write(level, __VA_ARGS__); } while (0)
+
+#define HTTP_LOG_TRACE(...) HTTP_LOG(::communicator::HTTPLogLevel::Trace, __VA_ARGS__)
+
+#define HTTP_LOG_DEBUG(...) HTTP_LOG(::communicator::HTTPLogLevel::Debug, __VA_ARGS__)
+
+#define HTTP_LOG_INFO(...) HTTP_LOG(::communicator::HTTPLogLevel::Info, __VA_ARGS__)
+
+#define HTTP_LOG_WARN(...) HTTP_LOG(::communicator::HTTPLogLevel::Warn, __VA_ARGS__)
+
+#define HTTP_LOG_ERROR(...) HTTP_LOG(::communicator::HTTPLogLevel::Error, __VA_ARGS__)
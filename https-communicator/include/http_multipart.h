@@ -0,0 +1,90 @@
+#pragma once
+
+#include <asio.hpp>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "http_enums.h"
+#include "http_stream.h"
+
+namespace communicator
+{
+
+	class HTTPMultipartBody
+	// Describes a multipart/form-data body whose parts are streamed to the socket, never assembled in memory
+	{
+	public:
+
+		// Fills the buffer and returns the number of bytes written, 0 once the part is complete
+		using Producer = std::function<std::expected<size_t, HTTPErr>(std::span<uint8_t> buffer)>;
+
+		HTTPMultipartBody();
+
+		explicit HTTPMultipartBody(std::string boundary);
+
+		void add_field(std::string_view name, std::string_view value);
+
+		void add_bytes( // The data is referenced, not copied, and must outlive the request
+			std::string_view name,
+			std::string_view filename,
+			HTTPContent content,
+			std::span<const uint8_t> data);
+
+		HTTPErr add_file(
+			std::string_view name,
+			const std::filesystem::path& file,
+			HTTPContent content,
+			std::string_view filename = "");
+
+		void add_producer( // Without a size the whole body is sent with chunked transfer encoding
+			std::string_view name,
+			std::string_view filename,
+			HTTPContent content,
+			Producer producer,
+			std::optional<uint64_t> size = std::nullopt);
+
+		const std::string& boundary() const;
+
+		std::string content_type() const;
+
+		std::optional<uint64_t> content_length() const;
+
+		HTTPErr write_to(HTTPSocket& socket) const;
+
+	private:
+
+		enum class PartSource : uint32_t
+		{
+			Memory,
+			File,
+			Producer,
+		};
+
+		struct Part
+		{
+			std::string preamble; // Boundary line and part headers
+			PartSource source;
+			std::string value; // Owned data for plain fields
+			std::span<const uint8_t> data;
+			std::filesystem::path file;
+			Producer producer;
+			std::optional<uint64_t> size;
+		};
+
+		std::string _boundary;
+		std::string _closing;
+
+		std::vector<Part> _parts;
+
+	private:
+
+		std::string make_preamble(std::string_view name, std::string_view filename, HTTPContent content, bool hasContentType) const;
+	};
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http_enums.h"
+#include "http_headers.h"
+
+namespace communicator
+{
+
+	class HTTPPreparedRequest
+	// A request head serialized and validated once, for endpoints hit over and over where only the body changes.
+	// Sending patches in the Content-Length line and writes head and body in one gathered write.
+	{
+	public:
+
+		struct LengthLine
+		{
+			std::array<char, 48> data{};
+			size_t size = 0;
+
+			std::string_view view() const { return std::string_view(data.data(), size); }
+		};
+
+		static std::expected<HTTPPreparedRequest, HTTPErr> prepare(
+			HTTPMethod method,
+			HTTPContent content,
+			std::string_view host,
+			std::string_view path,
+			std::string_view port,
+			const std::unordered_map<std::string, std::string>& headers = {},
+			HTTPConnection connection = HTTPConnection::Persistent,
+			const HTTPHeaderBlock* defaultHeaders = nullptr);
+
+		LengthLine length_line(uint64_t contentLength) const;
+		// The Content-Length line and the blank line ending the head, only the blank line for a bodyless GET
+
+		bool accepts_body_size(uint64_t contentLength) const; // POST and PUT must carry a body
+
+		std::string_view head() const; // Everything before the length line
+
+		std::string_view host() const;
+
+		std::string_view port() const;
+
+		HTTPMethod method() const;
+
+		HTTPConnection connection() const;
+
+	private:
+
+		HTTPPreparedRequest() = default;
+
+		std::string _head;
+		std::string _host;
+		std::string _port;
+
+		HTTPMethod _method = HTTPMethod::GET;
+		HTTPConnection _connection = HTTPConnection::Persistent;
+		bool _requiresBody = false;
+	};
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <asio.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http_enums.h"
+#include "http_stream.h"
+
+namespace communicator
+{
+
+	enum class HTTPProxyMode : uint32_t
+	{
+		Forward, // The proxy gets each request in absolute form, "GET http://host/path HTTP/1.1"
+		Tunnel // CONNECT host:port once per connection, then requests go through as the origin would see them
+	};
+
+
+	struct HTTPProxy
+	{
+		std::string host; // Empty connects directly
+		std::string port = "8080";
+		HTTPProxyMode mode = HTTPProxyMode::Forward;
+		std::string authorization; // The Proxy-Authorization value, e.g. "Basic dXNlcjpwYXNz"
+
+		bool enabled() const { return !host.empty(); }
+	};
+
+
+	HTTPErr open_proxy_tunnel(HTTPSocket& socket, std::string_view host, std::string_view port, const HTTPProxy& proxy);
+	// Sends CONNECT over a connection to the proxy, after a 2xx answer the socket carries bytes to host:port untouched
+
+	std::string_view proxy_request_target(
+		std::string_view host,
+		std::string_view port,
+		std::string_view path,
+		const HTTPProxy& proxy,
+		std::string& buffer);
+	// The absolute form, built in buffer, when a forward proxy carries the request. path itself otherwise
+
+	const std::unordered_map<std::string, std::string>& proxy_request_headers(
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPProxy& proxy,
+		std::unordered_map<std::string, std::string>& buffer);
+	// headers with Proxy-Authorization added when a forward proxy needs it, copied into buffer only then
+
+}
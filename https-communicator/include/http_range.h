@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "http_enums.h"
+#include "http_headers.h"
+#include "http_socket.h"
+
+namespace communicator
+{
+
+	struct HTTPSegmentOptions
+	// A segmented download asks for the first segment, learns the size from its Content-Range and fetches
+	// the rest in parallel, each connection kept alive for the segments it takes after that
+	{
+		size_t connections = 4;
+		uint64_t segmentSize = 4ull * 1024 * 1024;
+		size_t attempts = 3; // Per segment, a failed segment is fetched again on its own
+		size_t connectTimeout = 10;
+		bool resume = true; // Files only. Keeps "<path>.ranges" next to "<path>.part" and skips the segments it lists
+	};
+
+
+	// --- Segmented Download Methods ---
+
+	std::expected<std::vector<uint8_t>, HTTPErr> get_bytes_segmented(
+		std::string_view url,
+		const HTTPSegmentOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {});
+
+	std::expected<std::vector<uint8_t>, HTTPErr> get_bytes_segmented(
+		// Fills a buffer sized from the first response, a server ignoring Range sends the whole body in that response instead
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPSegmentOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {},
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+	HTTPErr get_to_file_segmented(
+		std::string_view url,
+		const std::filesystem::path& file,
+		const HTTPSegmentOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {});
+
+	HTTPErr get_to_file_segmented(
+		// Segments are written in place into "<file>.part", which is renamed over file once all of them arrived.
+		// A failed download leaves both the part and its journal behind for the next call to resume from
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const HTTPSegmentOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {},
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+	bool parse_content_range(std::string_view value, uint64_t& first, uint64_t& last, uint64_t& total);
+	// "bytes first-last/total", false for anything else, including an unknown "*" total
+
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "http_communicator.h"
+
+namespace communicator
+{
+
+	struct HTTPRuntimeOptions
+	{
+		size_t shards = 0; // 0 runs one shard per CPU the process may use
+		bool pinThreads = true;
+		bool numaAware = false; // Orders shards by NUMA node so neighbouring shard indices share a memory node
+		size_t maxIdlePerHost = 8; // Kept-alive connections each shard holds on to per origin
+		size_t connectTimeout = 10;
+		std::chrono::milliseconds requestTimeout{ 30000 }; // A get, post or send still unanswered after this fails with RequestTimeout
+		HTTPSocketOptions socket; // For every connection the shards open
+		HTTPConcurrencyLimiter* limiter = nullptr; // Shards never queue on it, requests over a host's limit fail fast
+	};
+
+	struct HTTPBatchRequest
+	{
+		HTTPMethod method = HTTPMethod::GET;
+		std::string url;
+		HTTPContent content = HTTPContent::None;
+		std::string body;
+		std::unordered_map<std::string, std::string> headers;
+	};
+
+	struct HTTPBatchOptions
+	{
+		std::chrono::milliseconds deadline{ 10000 }; // For the whole batch, requests still running then fail with RequestTimeout
+		size_t firstN = 0; // Return once this many requests succeeded, the rest come back BatchCancelled. 0 waits for all
+		bool partialResults = true; // false stops the batch at the first failure and cancels everything still running
+	};
+
+	struct HTTPBatchJob
+	{
+		size_t index = 0; // Position in the caller's request list
+		std::string host;
+		std::string port;
+		std::string request; // Serialized head and body
+		HTTPMethod method = HTTPMethod::GET;
+	};
+
+
+	class HTTPRuntimeShard
+	// One core's slice of the runtime: an io_context, the thread running it and the connections it owns.
+	// Everything a shard owns is only touched from its own thread, so nothing in here takes a lock.
+	{
+	public:
+
+		using Exchange = std::function<std::expected<HTTPOutput, HTTPErr>(HTTPSocket& socket)>;
+
+		using Completion = std::function<void(std::expected<HTTPOutput, HTTPErr> result)>;
+
+		using BatchCompletion = std::function<bool(size_t index, std::expected<HTTPOutput, HTTPErr> result)>; // false ends the batch
+
+		HTTPRuntimeShard(size_t index, int cpu, int numaNode, const HTTPRuntimeOptions& options);
+
+		~HTTPRuntimeShard();
+
+		HTTPRuntimeShard(const HTTPRuntimeShard&) = delete;
+		HTTPRuntimeShard& operator=(const HTTPRuntimeShard&) = delete;
+
+		template <typename Fn>
+		auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn&, HTTPRuntimeShard&>>
+		// Runs fn on the shard thread, inline when the caller already is the shard thread
+		{
+			using Result = std::invoke_result_t<Fn&, HTTPRuntimeShard&>;
+
+			auto task = std::make_shared<std::packaged_task<Result()>>(
+				[this, fn = std::forward<Fn>(fn)]() mutable { return fn(*this); });
+
+			std::future<Result> future = task->get_future();
+
+			if (running_in_this_thread())
+				(*task)();
+			else
+				asio::post(_ioContext, [task]() { (*task)(); });
+
+			return future;
+		}
+
+		std::expected<HTTPOutput, HTTPErr> exchange(HTTPMethod method, std::string_view host, std::string_view port, const Exchange& send);
+		// Runs one request on a pooled connection to host:port, the connection goes back to the pool if the server keeps it alive.
+		// An idempotent request whose pooled connection closes before the response starts is sent again on a new connection.
+		// send is blocking, so the shard serves nothing else until it returns. start_exchange does not hold the shard up
+
+		void start_exchange(HTTPBatchJob job, std::vector<uint8_t> body, Completion done);
+		// On the shard thread. Sends the serialized request, then body when it is not empty, and reads the response
+		// asynchronously, so requests to one origin overlap on the pool and the limiter counts each one in flight.
+		// done is called on the shard thread. Only a Unix socket or proxy route is connected in place
+
+		void run_batch(
+			std::vector<HTTPBatchJob> jobs,
+			std::chrono::steady_clock::time_point deadline,
+			std::shared_ptr<const std::atomic<bool>> cancelled,
+			BatchCompletion complete);
+		// On the shard thread. Starts every job as start_exchange does and returns, complete is called as each one
+		// ends. The jobs still running at the deadline, once cancelled is set or once complete returned false are
+		// aborted, a Unix socket or proxy route is connected for at most the time left.
+
+		std::expected<HTTPSocket, HTTPErr> acquire(std::string_view host, std::string_view port);
+
+		void release(std::string_view host, std::string_view port, HTTPSocket socket);
+
+		const HTTPSocketOptions& socket_options() const; // The runtime's, every shard shares them
+
+		size_t idle_count() const;
+
+		size_t index() const;
+
+		int cpu() const; // -1 when the thread is not pinned
+
+		int numa_node() const; // -1 when unknown or numaAware is off
+
+		bool running_in_this_thread() const;
+
+		asio::io_context& io_context();
+
+		void stop(); // Lets queued work finish, then joins the thread
+
+	private:
+
+		size_t _index;
+		int _cpu;
+		int _numaNode;
+		HTTPRuntimeOptions _options;
+
+		asio::io_context _ioContext; // Pooled sockets belong to it, their asynchronous reads and writes run with the shard's other work
+		std::optional<asio::executor_work_guard<asio::io_context::executor_type>> _work;
+		asio::ip::tcp::resolver _resolver{ _ioContext };
+
+		// Only ever run inline on the shard thread, to time out a blocking connect. The socket moves to _ioContext for the pool
+		asio::io_context _socketContext;
+
+		std::unordered_map<std::string, std::vector<HTTPSocket>> _idle;
+
+		std::thread _thread;
+
+	private:
+
+		struct Request; // One request in flight, shared with the handlers still queued for it
+
+		struct Batch; // The requests a run_batch call started, until the last one ends
+
+		void run();
+
+		std::expected<HTTPOutput, HTTPErr> pooled_exchange(HTTPMethod method, std::string_view host, std::string_view port, const Exchange& send);
+
+		std::expected<HTTPOutput, HTTPErr> exchange_on(std::string_view host, std::string_view port, HTTPSocket socket, const Exchange& send);
+
+		std::optional<HTTPSocket> take_idle(std::string_view host, std::string_view port); // Closes the stale connections it finds on the way
+
+		void start_request(const std::shared_ptr<Request>& request);
+
+		void connect_request(const std::shared_ptr<Request>& request);
+
+		void write_request(const std::shared_ptr<Request>& request);
+
+		void read_response_head(const std::shared_ptr<Request>& request);
+
+		void read_response_body(const std::shared_ptr<Request>& request);
+
+		void read_sized_body(const std::shared_ptr<Request>& request); // The next step of a body with a length, straight into the body the caller ends up owning
+
+		void arm_timeout(const std::shared_ptr<Request>& request, std::chrono::steady_clock::time_point expiry, HTTPErr reason);
+		// Replaces the request's pending expiry, it fails with reason once expiry passes
+
+		void finish_request(Request& request, std::expected<HTTPOutput, HTTPErr> result); // Once, later calls are ignored
+
+		void watch_batch(const std::shared_ptr<Batch>& batch); // Every 20 ms, for the deadline and a cancellation from another shard
+
+		static std::string origin_key(std::string_view host, std::string_view port);
+	};
+
+
+	class HTTPRuntime
+	// Thread-per-core client runtime. Requests are sharded by origin, so a connection, its buffers and its pool stay on one core.
+	{
+	public:
+
+		explicit HTTPRuntime(const HTTPRuntimeOptions& options = {});
+
+		~HTTPRuntime();
+
+		HTTPRuntime(const HTTPRuntime&) = delete;
+		HTTPRuntime& operator=(const HTTPRuntime&) = delete;
+
+		size_t shard_count() const;
+
+		HTTPRuntimeShard& shard(size_t index);
+
+		HTTPRuntimeShard& shard_for(std::string_view host, std::string_view port);
+
+		static HTTPRuntimeShard* current_shard(); // The shard owning the calling thread, nullptr outside the runtime
+
+		template <typename Fn>
+		auto dispatch(std::string_view host, std::string_view port, Fn&& fn)
+		// Runs fn on the shard owning host:port
+		{
+			return shard_for(host, port).submit(std::forward<Fn>(fn));
+		}
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> get(
+			std::string_view url,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> post(
+			std::string_view url,
+			HTTPContent content,
+			std::string_view body,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> post(
+			std::string_view url,
+			HTTPContent content,
+			std::vector<uint8_t> body,
+			const std::unordered_map<std::string, std::string>& headers = {});
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> send(
+			HTTPMethod method,
+			HTTPContent content,
+			std::string_view url,
+			std::string_view body = "",
+			const std::unordered_map<std::string, std::string>& headers = {});
+		// Runs on the shard owning the URL's origin without blocking it, see start_exchange. Called on that shard's own
+		// thread, or with a body held back behind Expect: 100-continue, the exchange runs in place through exchange instead
+
+		std::vector<std::expected<HTTPOutput, HTTPErr>> batch(const std::vector<HTTPBatchRequest>& requests, const HTTPBatchOptions& options = {});
+		// Fans the requests out over the shards owning their hosts and waits for them together, so the wall
+		// time follows the slowest request instead of the sum. Results are in request order. Called on a shard
+		// thread it keeps running that shard while it waits, so other work queued there runs in between.
+
+	private:
+
+		std::vector<std::unique_ptr<HTTPRuntimeShard>> _shards;
+	};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "http_enums.h"
+#include "http_proxy.h"
+#include "http_stream.h"
+
+namespace communicator
+{
+
+	struct HTTPSocketOptions
+	// TCP tuning applied to every connection opened with it. Unset or zero values leave the system default,
+	// the options a platform lacks are skipped.
+	{
+		bool noDelay = true; // TCP_NODELAY, a head and body written separately would otherwise wait on delayed ACKs
+		std::optional<int> sendBufferSize; // SO_SNDBUF, set before connecting so the window scale can follow it
+		std::optional<int> receiveBufferSize; // SO_RCVBUF
+
+		bool keepAlive = false; // SO_KEEPALIVE, the three values below only apply with it on
+		std::chrono::seconds keepAliveIdle{ 0 }; // TCP_KEEPIDLE, silence before the first probe
+		std::chrono::seconds keepAliveInterval{ 0 }; // TCP_KEEPINTVL
+		int keepAliveProbes = 0; // TCP_KEEPCNT, unanswered probes before the connection is dropped
+
+		bool quickAck = false; // TCP_QUICKACK, Linux. The kernel leaves quick ACK mode by itself, so it is set again per request
+		std::chrono::milliseconds userTimeout{ 0 }; // TCP_USER_TIMEOUT, Linux. How long sent data may stay unacknowledged
+		bool fastOpen = false; // TCP_FASTOPEN_CONNECT, Linux. With a cookie from an earlier connection the request rides in the SYN
+
+		std::string unixSocketPath; // Connect to this Unix domain socket instead of host:port, the host still goes in the Host header
+		HTTPProxy proxy; // Ignored for Unix domain sockets
+
+		uint64_t expectContinueThreshold = 0;
+		// Bodies of at least this many bytes wait behind Expect: 100-continue, 0 never does. A server that refuses the
+		// upload before the body is sent answers with its own status, e.g. 413, which comes back in HTTPOutput::statusCode
+		std::chrono::milliseconds expectContinueTimeout{ 1000 }; // A server ignoring Expect gets the body after this
+	};
+
+	HTTPErr apply_socket_options(HTTPSocket& socket, const HTTPSocketOptions& options);
+	// The socket must be open. Fast Open and the buffer sizes only fully apply before connecting, the rest works on a live connection too.
+	// A connected Unix domain socket only takes the buffer sizes
+
+	void rearm_quick_ack(HTTPSocket& socket, const HTTPSocketOptions& options); // Called before each request on a reused connection
+
+	std::optional<HTTPSocket> move_socket(asio::io_context& context, HTTPSocket& socket);
+	// Hands a connected socket over to another io_context, nullopt when it could not. Pools keep their sockets on
+	// the context that runs their asynchronous operations, while blocking connects run on a context of their own
+
+}
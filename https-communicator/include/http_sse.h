@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http_enums.h"
+#include "http_headers.h"
+#include "http_socket.h"
+
+namespace communicator
+{
+
+	struct HTTPEvent
+	// Views into the parser, valid for the duration of the callback
+	{
+		std::string_view type; // "message" unless the event named one
+		std::string_view data; // The data lines joined with '\n'
+		std::string_view id; // The last event ID seen on the stream, sent as Last-Event-ID when reconnecting
+	};
+
+	using HTTPEventCallback = std::function<bool(const HTTPEvent&)>; // Returning false ends the stream
+
+
+	struct HTTPEventStreamOptions
+	{
+		std::string lastEventId; // Resumes a stream an earlier call was reading
+		std::chrono::milliseconds reconnectDelay{ 3000 }; // Replaced by the server's "retry:" field
+		std::chrono::milliseconds maxReconnectDelay{ 30000 }; // The delay doubles per failed attempt up to this, but never below retry
+		size_t maxReconnects = 10; // Failed attempts in a row before giving up, 0 never reconnects
+		size_t maxEventSize = 1024 * 1024; // Longer lines or events fail with MessageTooLarge, so a stream's memory stays bounded
+		size_t connectTimeout = 10;
+	};
+
+
+	class HTTPEventStreamParser
+	// Incremental text/event-stream parser. Bytes can be fed in pieces of any size, a line completed
+	// within one piece is parsed where it lies and only a line split across pieces is carried over
+	{
+	public:
+
+		explicit HTTPEventStreamParser(size_t maxEventSize = 1024 * 1024);
+
+		std::expected<bool, HTTPErr> feed(std::string_view bytes, const HTTPEventCallback& callback);
+		// Dispatches every event completed by bytes, false once the callback asked to stop
+
+		void reset(); // Drops a partially received event, as a lost connection does. The last dispatched event ID is kept
+
+		const std::string& last_event_id() const;
+
+		void set_last_event_id(std::string_view id);
+
+		std::optional<std::chrono::milliseconds> retry() const; // The last valid "retry:" field
+
+	private:
+
+		std::expected<bool, HTTPErr> process_line(std::string_view line, const HTTPEventCallback& callback);
+
+		bool dispatch(const HTTPEventCallback& callback);
+
+	private:
+
+		size_t _maxEventSize;
+
+		std::string _line; // A line split across feeds
+		bool _skipNewline = false; // The last feed ended on '\r', a '\n' starting the next one belongs to it
+
+		std::string _data;
+		std::string _type;
+		std::string _id; // Becomes the last event ID once its event is dispatched
+		std::string _lastEventId;
+		std::optional<std::chrono::milliseconds> _retry;
+	};
+
+
+	// --- Event Stream Methods ---
+
+	HTTPErr stream_events(
+		std::string_view url,
+		const HTTPEventCallback& callback,
+		const HTTPEventStreamOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {});
+
+	HTTPErr stream_events(
+		// Blocks while the stream lasts, handing each event to callback as soon as its blank line arrives. A dropped
+		// connection is opened again with Last-Event-ID. Returns None once the callback stops the stream, the error
+		// otherwise, including a 204 or any status but 200 that tells the client not to reconnect
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPEventCallback& callback,
+		const HTTPEventStreamOptions& options = {},
+		const std::unordered_map<std::string, std::string>& headers = {},
+		const HTTPHeaderBlock* defaultHeaders = nullptr,
+		const HTTPSocketOptions& socketOptions = {});
+
+}
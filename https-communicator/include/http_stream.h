@@ -0,0 +1,92 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+#include "http_uring.h"
+
+namespace communicator
+{
+
+	using HTTPSocket = asio::generic::stream_protocol::socket;
+	// A TCP or Unix domain connection. It keeps the protocol it was opened with, so its endpoints read back right
+	// and the TCP options are only set where they mean something
+
+
+	class HTTPStream
+	// The byte stream one exchange is written to and read from, usable with asio::write and asio::read_until like a socket.
+	// Built with --with-io-uring on Linux the I/O runs through the thread's ring, otherwise it goes straight to the socket.
+	{
+	public:
+
+		explicit HTTPStream(HTTPSocket& socket);
+
+		~HTTPStream() = default;
+
+		HTTPStream(const HTTPStream&) = delete;
+		HTTPStream& operator=(const HTTPStream&) = delete;
+
+		template <typename ConstBufferSequence>
+		size_t write_some(const ConstBufferSequence& buffers, asio::error_code& ec)
+		{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+			if (_channel)
+			{
+				std::array<iovec, MAX_IOVECS> iov;
+				size_t count = to_iovecs(buffers, iov);
+				return _channel->write(iov.data(), count, ec);
+			}
+#endif
+			return _socket.write_some(buffers, ec);
+		}
+
+		template <typename MutableBufferSequence>
+		size_t read_some(const MutableBufferSequence& buffers, asio::error_code& ec)
+		{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+			if (_channel)
+			{
+				std::array<iovec, MAX_IOVECS> iov;
+				size_t count = to_iovecs(buffers, iov);
+				return _channel->read(iov.data(), count, ec);
+			}
+#endif
+			return _socket.read_some(buffers, ec);
+		}
+
+		void wait_read(asio::error_code& ec); // Returns once read_some would not block
+
+		void wait_read(asio::error_code& ec, std::chrono::steady_clock::time_point deadline); // As above, asio::error::timed_out once deadline passes
+
+		bool direct() const; // True when the socket descriptor can be read from directly, e.g. by splice
+
+		HTTPSocket& socket();
+
+	private:
+
+		HTTPSocket& _socket;
+
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+		static constexpr size_t MAX_IOVECS = 16;
+
+		std::optional<HTTPUringChannel> _channel;
+
+		template <typename BufferSequence>
+		static size_t to_iovecs(const BufferSequence& buffers, std::array<iovec, MAX_IOVECS>& iov)
+		{
+			size_t count = 0;
+			for (auto it = asio::buffer_sequence_begin(buffers); it != asio::buffer_sequence_end(buffers) && count < iov.size(); ++it)
+			{
+				auto buffer = *it;
+				if (buffer.size() == 0)
+					continue;
+				iov[count++] = { const_cast<void*>(static_cast<const void*>(buffer.data())), buffer.size() };
+			}
+			return count;
+		}
+#endif
+	};
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace communicator
+{
+
+	struct HTTPTiming
+	// Monotonic nanosecond timestamps for each phase of one request, zero when a phase did not run
+	{
+		uint64_t start = 0;
+		uint64_t resolved = 0;
+		uint64_t connected = 0;
+		uint64_t requestSent = 0;
+		uint64_t firstByte = 0;
+		uint64_t headersReceived = 0;
+		uint64_t completed = 0;
+
+		uint64_t bytesSent = 0;
+		uint64_t bytesReceived = 0;
+
+		bool connectionReused = false;
+	};
+
+	inline uint64_t monotonic_ns()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+}
+
+
+// Timing is compiled in with the premake option --with-timing, otherwise every hook expands to nothing
+
+#ifdef HTTP_ENABLE_TIMING
+
+#define HTTP_TIMING_MARK(timing, phase) do { if (timing) (timing)->phase = ::communicator::monotonic_ns(); } while (0)
+
+#define HTTP_TIMING_ADD(timing, counter, amount) do { if (timing) (timing)->counter += (amount); } while (0)
+
+#define HTTP_TIMING_SET(timing, field, value) do { if (timing) (timing)->field = (value); } while (0)
+
+#define HTTP_TIMING_ATTACH(result, record) do { if ((record) && (result).has_value()) (result)->timing = *(record); } while (0)
+
+#else
+
+#define HTTP_TIMING_MARK(timing, phase) ((void)0)
+
+#define HTTP_TIMING_ADD(timing, counter, amount) ((void)0)
+
+#define HTTP_TIMING_SET(timing, field, value) ((void)0)
+
+#define HTTP_TIMING_ATTACH(result, record) ((void)0)
+
+#endif
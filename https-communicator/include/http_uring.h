@@ -0,0 +1,182 @@
+#pragma once
+
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+
+#include <asio.hpp>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <liburing.h>
+#include <sys/uio.h>
+
+namespace communicator
+{
+
+	constexpr unsigned URING_QUEUE_DEPTH = 64;
+	constexpr unsigned URING_FIXED_FILES = 64;
+	constexpr unsigned URING_RECV_BUFFERS = 64; // Must be a power of two
+	constexpr unsigned URING_RECV_BUFFER_SIZE = 16 * 1024;
+	constexpr uint16_t URING_BUFFER_GROUP = 0;
+
+
+	struct HTTPUringOperation
+	// Anything that waits on a completion, the sqe user data points back at it
+	{
+		virtual void complete(int result, uint32_t flags) = 0;
+
+	protected:
+		~HTTPUringOperation() = default;
+	};
+
+
+	class HTTPUring
+	// One ring per thread, shared by every HTTPStream the thread creates
+	{
+	public:
+
+		static HTTPUring* thread_instance(); // nullptr when the kernel refuses io_uring, streams then use the socket directly
+
+		HTTPUring() = default;
+
+		~HTTPUring();
+
+		HTTPUring(const HTTPUring&) = delete;
+		HTTPUring& operator=(const HTTPUring&) = delete;
+
+		bool open();
+
+		int acquire_file(int fd); // Fixed-file slot for the descriptor, -1 when the table is full
+
+		void release_file(int slot); // Queued, the slot is reused once the update completes
+
+		io_uring_sqe* next_sqe();
+
+		template <typename Done>
+		asio::error_code wait_until(Done done)
+		// Submits everything queued and reaps completions until the condition holds
+		{
+			while (!done())
+			{
+				int result = io_uring_submit_and_wait(&_ring, 1);
+				if (result < 0 && result != -EINTR && result != -EAGAIN && result != -EBUSY)
+					return asio::error_code(-result, asio::error::get_system_category());
+
+				reap();
+			}
+			return {};
+		}
+
+		template <typename Done>
+		asio::error_code wait_until(Done done, std::chrono::steady_clock::time_point deadline)
+		// As above, but gives up with asio::error::timed_out once deadline passes
+		{
+			while (!done())
+			{
+				auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+				if (remaining <= 0)
+					return asio::error::timed_out;
+
+				__kernel_timespec timeout{ remaining / 1000000000, remaining % 1000000000 };
+
+				io_uring_cqe* cqe = nullptr;
+				int result = io_uring_submit_and_wait_timeout(&_ring, &cqe, 1, &timeout, nullptr);
+				if (result < 0 && result != -ETIME && result != -EINTR && result != -EAGAIN && result != -EBUSY)
+					return asio::error_code(-result, asio::error::get_system_category());
+
+				reap();
+			}
+			return {};
+		}
+
+		void submit();
+
+		uint8_t* buffer(uint16_t id);
+
+		void recycle(uint16_t id);
+
+	private:
+
+		io_uring _ring{};
+		bool _open = false;
+
+		io_uring_buf_ring* _bufferRing = nullptr;
+		std::vector<uint8_t> _bufferMemory;
+
+		std::array<int, URING_FIXED_FILES> _freeSlots{};
+		unsigned _freeCount = 0;
+
+	private:
+
+		void reap();
+	};
+
+
+	class HTTPUringChannel final : private HTTPUringOperation
+	// The io_uring side of one HTTPStream: sends go out as sendmsg, receives come from a multishot recv into the ring's buffers
+	{
+	public:
+
+		HTTPUringChannel(HTTPUring& ring, int fd);
+
+		~HTTPUringChannel();
+
+		HTTPUringChannel(const HTTPUringChannel&) = delete;
+		HTTPUringChannel& operator=(const HTTPUringChannel&) = delete;
+
+		size_t write(const iovec* iov, size_t count, asio::error_code& ec);
+
+		size_t read(const iovec* iov, size_t count, asio::error_code& ec);
+
+		void wait_read(asio::error_code& ec);
+
+		void wait_read(asio::error_code& ec, std::chrono::steady_clock::time_point deadline);
+
+	private:
+
+		struct Received
+		{
+			uint16_t buffer;
+			uint32_t length;
+			uint32_t offset;
+		};
+
+		struct SendOperation final : HTTPUringOperation
+		{
+			int result = 0;
+			bool done = false;
+
+			void complete(int res, [[maybe_unused]] uint32_t flags) override
+			{
+				result = res;
+				done = true;
+			}
+		};
+
+		static constexpr int NO_RESULT = 1;
+
+		HTTPUring& _ring;
+		int _fd;
+		int _slot;
+
+		bool _armed = false;
+		int _terminal = NO_RESULT; // 0 on EOF, a negative errno once the peer or the kernel ends the stream
+
+		std::array<Received, URING_RECV_BUFFERS> _received{};
+		size_t _receivedHead = 0;
+		size_t _receivedCount = 0;
+
+	private:
+
+		void complete(int result, uint32_t flags) override;
+
+		void arm_recv();
+
+		void prepare_target(io_uring_sqe* sqe);
+	};
+
+}
+
+#endif
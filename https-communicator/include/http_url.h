@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+
+#include "http_enums.h"
+
+namespace communicator
+{
+
+	struct HTTPURLView
+	// An RFC 3986 URI split into views of the string it was parsed from, it must outlive the view
+	{
+		std::string_view scheme; // Lowercase is not enforced, compare with iequals_ascii
+		std::string_view userinfo;
+		std::string_view host; // IPv6 literals without their brackets
+		std::string_view port; // The scheme's default port when the URL names none
+		std::string_view path; // Empty when the URL has no path
+		std::string_view query; // Without the leading '?'
+		std::string_view fragment; // Without the leading '#'
+		std::string_view target; // Path and query as sent in the request line, write_str_request adds a missing leading '/'
+		std::string_view socketPath; // http+unix only, the percent-encoded authority. host is then "localhost" and port empty
+		uint16_t portNumber = 0;
+		bool ipv6 = false;
+	};
+
+
+	HTTPErr parse_url(std::string_view url, HTTPURLView& out);
+	// Single pass, never allocates. Requires a scheme and an authority, e.g. "http://host/path"
+
+	std::expected<HTTPURLView, HTTPErr> parse_url(std::string_view url);
+
+	std::expected<HTTPURLView, HTTPErr> parse_http_url(std::string_view url);
+	// Accepts http, and http+unix whose authority is a percent-encoded socket path, e.g. "http+unix://%2Frun%2Fapp.sock/health"
+
+	std::string_view default_port(std::string_view scheme); // Empty for schemes without one
+
+	bool iequals_ascii(std::string_view a, std::string_view b);
+
+	void percent_encode(std::string_view value, std::string& out); // Appends value with every byte outside the RFC 3986 unreserved set escaped
+
+	HTTPErr percent_decode(std::string_view value, std::string& out); // Appends value with its escapes resolved, InvalidURL on a broken one
+
+	void append_host(std::string_view host, std::string& out); // Appends host as an authority needs it, IPv6 literals in brackets
+
+
+	class HTTPURLBuilder
+	// Assembles a URL into one buffer that keeps its capacity across clear(), so steady-state building does not allocate
+	{
+	public:
+
+		HTTPURLBuilder() = default;
+
+		HTTPURLBuilder& clear();
+
+		HTTPURLBuilder& origin(std::string_view scheme, std::string_view host, std::string_view port = "");
+		// Brackets IPv6 hosts and leaves out the scheme's default port
+
+		HTTPURLBuilder& path(std::string_view path); // Appended as given, it must already be encoded
+
+		HTTPURLBuilder& segment(std::string_view segment); // Adds "/" and the percent-encoded segment
+
+		HTTPURLBuilder& query(std::string_view key, std::string_view value);
+
+		HTTPURLBuilder& fragment(std::string_view fragment);
+
+		std::string_view view() const;
+
+		std::string str() const;
+
+	private:
+
+		std::string _buffer;
+		bool _hasQuery = false;
+	};
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <asio.hpp>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "http_enums.h"
+#include "http_socket.h"
+
+namespace communicator
+{
+
+	enum class HTTPWebSocketOpcode : uint8_t
+	{
+		Continuation = 0x0,
+		Text = 0x1,
+		Binary = 0x2,
+		Close = 0x8,
+		Ping = 0x9,
+		Pong = 0xA
+	};
+
+	struct HTTPWebSocketOptions
+	{
+		std::string protocol; // Sent as Sec-WebSocket-Protocol when set
+		bool permessageDeflate = false; // Offered when built with --with-zlib, ignored otherwise
+		size_t maxMessageSize = 64 * 1024 * 1024; // Larger messages fail with MessageTooLarge
+		size_t connectTimeout = 10;
+	};
+
+	struct HTTPWebSocketMessage
+	{
+		HTTPWebSocketOpcode opcode = HTTPWebSocketOpcode::Binary; // Text, Binary or Close
+		std::span<const uint8_t> data; // Points into the receive buffer, valid until the next receive
+
+		std::string_view text() const { return std::string_view(reinterpret_cast<const char*>(data.data()), data.size()); }
+	};
+
+
+	class HTTPWebSocket
+	// RFC 6455 client over a connection upgraded from HTTP/1.1. Messages are parsed in the receive buffer and handed
+	// out as views into it, fragments are moved together in place, so only compressed messages are copied.
+	{
+	public:
+
+		HTTPWebSocket();
+
+		HTTPWebSocket(const HTTPWebSocket&) = delete;
+		HTTPWebSocket& operator=(const HTTPWebSocket&) = delete;
+
+		HTTPErr connect(
+			std::string_view url, // ws://host[:port]/path
+			const HTTPWebSocketOptions& options = {},
+			const std::unordered_map<std::string, std::string>& headers = {},
+			const HTTPSocketOptions& socketOptions = {});
+
+		HTTPErr send_text(std::string_view text);
+
+		HTTPErr send_binary(std::span<const uint8_t> data);
+
+		HTTPErr ping(std::span<const uint8_t> payload = {});
+
+		HTTPErr close(uint16_t code = 1000, std::string_view reason = "");
+		// Sends a Close frame and waits for the server's, the connection is gone afterwards either way
+
+		std::expected<HTTPWebSocketMessage, HTTPErr> receive();
+		// Blocks for the next whole message. Pings are answered and pongs dropped on the way,
+		// a Close from the server is answered and returned, later calls then fail with WebSocketClosed
+
+		bool is_open() const;
+
+		bool deflate_enabled() const; // The server accepted permessage-deflate
+
+		const std::string& protocol() const; // The subprotocol the server picked, empty for none
+
+		~HTTPWebSocket();
+
+	private:
+
+		asio::io_context _ioContext;
+		std::optional<HTTPSocket> _socket;
+
+		HTTPWebSocketOptions _options;
+		std::string _protocol;
+		bool _closeSent = false;
+
+		std::vector<uint8_t> _receive; // Frames are parsed in place, [_start, _size) is still unread
+		size_t _start = 0;
+		size_t _size = 0;
+
+		std::vector<uint8_t> _send;
+		std::array<uint8_t, 256> _maskKeys{}; // Unused random bytes from the system CSPRNG, 4 per frame from _maskKeyOffset
+		size_t _maskKeyOffset = 256;
+
+		struct Deflate;
+		std::unique_ptr<Deflate> _deflate; // Only set once the server accepted the extension
+
+	private:
+
+		HTTPErr send_frame(HTTPWebSocketOpcode opcode, std::span<const uint8_t> payload, bool compressed = false);
+
+		HTTPErr send_message(HTTPWebSocketOpcode opcode, std::span<const uint8_t> payload);
+
+		HTTPErr fill(size_t needed); // Reads until at least needed bytes from _start are buffered
+
+		void fail(); // Drops the connection after a protocol error
+	};
+
+
+	void mask_websocket_payload(std::span<uint8_t> payload, std::array<uint8_t, 4> key, size_t offset = 0);
+	// XORs payload with the masking key, 16 bytes per step where the platform has SIMD. offset is the
+	// position of payload[0] in the frame, so a frame can be masked in pieces
+
+}
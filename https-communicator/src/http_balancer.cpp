@@ -0,0 +1,393 @@
+#include "headers.h"
+#include "http_balancer.h"
+#include "http_limiter.h"
+#include "http_logger.h"
+
+#include <random>
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		size_t random_below(size_t bound)
+		{
+			thread_local std::minstd_rand engine(std::random_device{}());
+			return std::uniform_int_distribution<size_t>(0, bound - 1)(engine);
+		}
+
+		std::pair<std::string_view, std::string_view> split_endpoint(std::string_view entry)
+		// "address:port", with IPv6 addresses in brackets
+		{
+			size_t colon = entry.rfind(':');
+			if (colon == std::string_view::npos)
+				return { entry, "80" };
+
+			std::string_view address = entry.substr(0, colon);
+			if (address.size() >= 2 && address.front() == '[' && address.back() == ']')
+				address = address.substr(1, address.size() - 2);
+
+			return { address, entry.substr(colon + 1) };
+		}
+	}
+
+
+	// --- HTTPBalancer Implementation ---
+
+	HTTPBalancer::HTTPBalancer(std::string_view host, std::string_view port, const HTTPBalancerOptions& options)
+		: _options(options), _host(host), _port(port)
+	{
+		_options.socket.unixSocketPath.clear();
+		refresh();
+	}
+
+	HTTPBalancer::HTTPBalancer(std::string_view host, const std::vector<std::string>& endpoints, const HTTPBalancerOptions& options)
+		: _options(options), _host(host), _static(endpoints)
+	{
+		_options.socket.unixSocketPath.clear();
+		refresh();
+	}
+
+	HTTPErr HTTPBalancer::refresh()
+	{
+		asio::io_context ioContext;
+		asio::ip::tcp::resolver resolver(ioContext);
+
+		std::vector<asio::ip::tcp::endpoint> addresses;
+
+		auto resolve = [&](std::string_view host, std::string_view port)
+			{
+				asio::error_code ec;
+				auto results = resolver.resolve(host, port, ec);
+				if (ec)
+				{
+					HTTP_LOG_WARN("DNS resolution failed for {}:{}: {}:{}", host, port, ec.category().name(), ec.value());
+					return;
+				}
+
+				for (const auto& result : results)
+				{
+					if (std::find(addresses.begin(), addresses.end(), result.endpoint()) == addresses.end())
+						addresses.push_back(result.endpoint());
+				}
+			};
+
+		if (_static.empty())
+		{
+			resolve(_host, _port);
+		}
+		else
+		{
+			for (const std::string& entry : _static)
+			{
+				auto [address, port] = split_endpoint(entry);
+				resolve(address, port);
+			}
+		}
+
+		if (addresses.empty())
+		{
+			return HTTPErr::DNSResolutionFailed;
+		}
+
+		std::lock_guard lock(_mutex);
+
+		std::vector<Endpoint> endpoints;
+		endpoints.reserve(addresses.size());
+
+		for (const auto& address : addresses)
+		{
+			auto it = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const Endpoint& endpoint) { return endpoint.address == address; });
+			if (it != _endpoints.end())
+				endpoints.push_back(std::move(*it));
+			else
+				endpoints.emplace_back().address = address;
+		}
+
+		_endpoints = std::move(endpoints);
+
+		HTTP_LOG_DEBUG("Balancing {} over {} endpoints.", _host, _endpoints.size());
+		return HTTPErr::None;
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPBalancer::run(HTTPMethod method, const Exchange& send)
+	{
+		auto address = pick();
+		if (!address.has_value())
+		{
+			return std::unexpected(address.error());
+		}
+
+		Clock::time_point start = Clock::now();
+
+		auto idle = take_idle(*address);
+		if (idle)
+		{
+			rearm_quick_ack(*idle, _options.socket);
+
+			auto output = send(*idle);
+
+			// The server may still close a connection that passed the liveness check while the request is on its way
+			if (output.has_value() || output.error() != HTTPErr::ClosedBeforeResponse || !is_idempotent(method))
+			{
+				report(*address, output.has_value() ? HTTPErr::None : output.error(), Clock::now() - start);
+				if (output.has_value() && output->connection == HTTPConnection::Persistent)
+					release(*address, std::move(*idle));
+				return output;
+			}
+
+			HTTP_LOG_INFO("Pooled connection to {} closed before the {} response, retrying on a new connection.", _host, to_string(method));
+		}
+
+		asio::io_context ioContext;
+		auto socketResult = connect(ioContext, *address);
+		if (!socketResult.has_value())
+		{
+			report(*address, socketResult.error(), Clock::now() - start);
+			return std::unexpected(socketResult.error());
+		}
+
+		auto output = send(*socketResult);
+
+		report(*address, output.has_value() ? HTTPErr::None : output.error(), Clock::now() - start);
+
+		if (output.has_value() && output->connection == HTTPConnection::Persistent && _options.maxIdlePerEndpoint > 0)
+		{
+			// ioContext ends with this call, the pool keeps the descriptor on its own context
+			auto pooled = move_socket(_socketContext, *socketResult);
+			if (pooled)
+				release(*address, std::move(*pooled));
+		}
+
+		return output;
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPBalancer::get(std::string_view path, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return send(HTTPMethod::GET, HTTPContent::None, path, "", headers);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPBalancer::post(
+		std::string_view path,
+		HTTPContent content,
+		std::string_view body,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		return send(HTTPMethod::POST, content, path, body, headers);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPBalancer::send(
+		HTTPMethod method,
+		HTTPContent content,
+		std::string_view path,
+		std::string_view body,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		HTTPConnection connection = _options.maxIdlePerEndpoint > 0 ? HTTPConnection::Persistent : HTTPConnection::Close;
+
+		return run(method, [&](HTTPSocket& socket)
+			{
+				return send_http_request(method, content, _host, path, _port, body, headers, connection, &socket, nullptr, _options.socket);
+			});
+	}
+
+	std::vector<HTTPEndpointStats> HTTPBalancer::endpoints()
+	{
+		std::lock_guard lock(_mutex);
+
+		Clock::time_point now = Clock::now();
+
+		std::vector<HTTPEndpointStats> stats;
+		stats.reserve(_endpoints.size());
+
+		for (const Endpoint& endpoint : _endpoints)
+		{
+			stats.push_back(HTTPEndpointStats{
+				endpoint.address,
+				endpoint.outstanding,
+				std::chrono::microseconds(static_cast<int64_t>(endpoint.latencyUs)),
+				endpoint.requests,
+				endpoint.failures,
+				endpoint.ejectedUntil > now,
+				endpoint.idle.size()
+			});
+		}
+
+		return stats;
+	}
+
+	std::expected<asio::ip::tcp::endpoint, HTTPErr> HTTPBalancer::pick()
+	{
+		std::lock_guard lock(_mutex);
+
+		if (_endpoints.empty())
+		{
+			return std::unexpected(HTTPErr::DNSResolutionFailed);
+		}
+
+		Clock::time_point now = Clock::now();
+
+		std::vector<size_t> healthy;
+		healthy.reserve(_endpoints.size());
+		for (size_t i = 0; i < _endpoints.size(); i++)
+		{
+			if (_endpoints[i].ejectedUntil <= now)
+				healthy.push_back(i);
+		}
+
+		size_t chosen = 0;
+
+		if (healthy.empty())
+		{
+			// Everything is ejected, the endpoint due back first is the best guess
+			for (size_t i = 1; i < _endpoints.size(); i++)
+			{
+				if (_endpoints[i].ejectedUntil < _endpoints[chosen].ejectedUntil)
+					chosen = i;
+			}
+		}
+		else if (healthy.size() == 1)
+		{
+			chosen = healthy[0];
+		}
+		else
+		{
+			size_t first = random_below(healthy.size());
+			size_t second = random_below(healthy.size() - 1);
+			if (second >= first)
+				second++;
+
+			chosen = score(_endpoints[healthy[first]]) <= score(_endpoints[healthy[second]]) ? healthy[first] : healthy[second];
+		}
+
+		Endpoint& endpoint = _endpoints[chosen];
+		endpoint.outstanding++;
+		endpoint.requests++;
+
+		return endpoint.address;
+	}
+
+	std::expected<HTTPSocket, HTTPErr> HTTPBalancer::connect(asio::io_context& ioContext, const asio::ip::tcp::endpoint& address)
+	{
+		if (!_options.socket.proxy.enabled())
+		{
+			return create_and_connect_socket(
+				ioContext,
+				asio::ip::tcp::resolver::results_type::create(address, _host, _port),
+				_options.connectTimeout,
+				nullptr,
+				_options.socket);
+		}
+
+		// Through the proxy by address, so a tunnel still ends at the chosen endpoint
+		std::string host = address.address().to_string();
+		return create_and_connect_socket(ioContext, host, std::to_string(address.port()), _options.connectTimeout, nullptr, _options.socket);
+	}
+
+	std::optional<HTTPSocket> HTTPBalancer::take_idle(const asio::ip::tcp::endpoint& address)
+	{
+		std::lock_guard lock(_mutex);
+
+		auto it = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const Endpoint& endpoint) { return endpoint.address == address; });
+		if (it == _endpoints.end())
+		{
+			return std::nullopt;
+		}
+
+		// Servers close idle connections on their own timeout, which the pool only learns about here
+		while (!it->idle.empty())
+		{
+			HTTPSocket socket = std::move(it->idle.back());
+			it->idle.pop_back();
+
+			if (is_connection_alive(socket))
+				return socket;
+
+			HTTP_LOG_DEBUG("Dropping pooled connection to {} closed by the server.", _host);
+			asio::error_code ignored;
+			socket.close(ignored);
+		}
+
+		return std::nullopt;
+	}
+
+	void HTTPBalancer::release(const asio::ip::tcp::endpoint& address, HTTPSocket socket)
+	{
+		if (!socket.is_open())
+			return;
+
+		std::lock_guard lock(_mutex);
+
+		// Dropped by a refresh or ejected while the request ran, the connection closes here
+		auto it = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const Endpoint& endpoint) { return endpoint.address == address; });
+		if (it == _endpoints.end() || it->ejectedUntil > Clock::now() || it->idle.size() >= _options.maxIdlePerEndpoint)
+			return;
+
+		it->idle.push_back(std::move(socket));
+	}
+
+	void HTTPBalancer::report(const asio::ip::tcp::endpoint& address, HTTPErr err, Clock::duration latency)
+	{
+		std::lock_guard lock(_mutex);
+
+		// A refresh may have dropped the endpoint while the request was running
+		auto it = std::find_if(_endpoints.begin(), _endpoints.end(), [&](const Endpoint& endpoint) { return endpoint.address == address; });
+		if (it == _endpoints.end())
+			return;
+
+		Endpoint& endpoint = *it;
+		endpoint.outstanding--;
+
+		if (err == HTTPErr::None || HTTPConcurrencyLimiter::classify(err) != HTTPLimiterOutcome::Dropped)
+		{
+			double sample = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+			if (err == HTTPErr::None)
+			{
+				endpoint.latencyUs = endpoint.latencyUs == 0 ? sample : endpoint.latencyUs + (sample - endpoint.latencyUs) * _options.latencyDecay;
+				endpoint.ejections = 0;
+			}
+
+			endpoint.failuresInRow = 0;
+			return;
+		}
+
+		endpoint.failures++;
+		endpoint.failuresInRow++;
+
+		// A failure scores like a connect that ran into the timeout, so the two-choice pick steers away before any ejection
+		double penalty = static_cast<double>(_options.connectTimeout) * 1'000'000.0;
+		endpoint.latencyUs = endpoint.latencyUs == 0 ? penalty : endpoint.latencyUs + (penalty - endpoint.latencyUs) * _options.latencyDecay;
+
+		Clock::time_point now = Clock::now();
+		if (endpoint.ejectedUntil > now)
+			return;
+
+		if (err != HTTPErr::ConnectionTimeout && endpoint.failuresInRow < _options.consecutiveFailures)
+			return;
+
+		if (static_cast<double>(ejected_count(now) + 1) > _options.maxEjectedRatio * static_cast<double>(_endpoints.size()))
+			return;
+
+		auto duration = std::min(_options.baseEjection * (int64_t(1) << std::min<uint32_t>(endpoint.ejections, 16)), _options.maxEjection);
+
+		endpoint.ejectedUntil = now + duration;
+		endpoint.ejections++;
+		endpoint.failuresInRow = 0;
+		endpoint.idle.clear();
+
+		HTTP_LOG_WARN("Ejected endpoint {}:{} of {} for {} ms.", endpoint.address.address().to_string(), endpoint.address.port(), _host, duration.count());
+	}
+
+	double HTTPBalancer::score(const Endpoint& endpoint) const
+	{
+		// Untried endpoints count as the fastest, so each one is probed before latency takes over
+		return static_cast<double>(endpoint.outstanding + 1) * std::max(endpoint.latencyUs, 1.0);
+	}
+
+	size_t HTTPBalancer::ejected_count(Clock::time_point now) const
+	{
+		return static_cast<size_t>(std::count_if(_endpoints.begin(), _endpoints.end(), [&](const Endpoint& endpoint) { return endpoint.ejectedUntil > now; }));
+	}
+
+}
@@ -1,5 +1,11 @@
 #include "headers.h"
 #include "http_communicator.h"
+#include "http_logger.h"
+#include "http_file_io.h"
+
+#if !defined(_WIN32)
+#include <poll.h>
+#endif
 
 
 namespace communicator
@@ -9,7 +15,7 @@ namespace communicator
 	// --- HTTPCommunicator Implementation ---
 
 	HTTPCommunicator::HTTPCommunicator(std::string_view url, const std::unordered_map<std::string, std::string>& headers, size_t requestTimeout)
-		: _headers(headers), _requestTimeout(requestTimeout), _requestUrl(std::string(url))
+		: _defaultHeaders(headers), _requestTimeout(requestTimeout), _requestUrl(std::string(url))
 	{
 		make_persistent_connection(url);
 	}
@@ -18,51 +24,84 @@ namespace communicator
 	{
 		if (_socket && _socket->is_open())
 		{
-			std::cout << "Persistent connection already established." << std::endl;
+			HTTP_LOG_INFO("Persistent connection already established.");
 			return HTTPErr::None;
 		}
 
-		auto outputResult = decrypt_url_http(url);
+		auto outputResult = parse_http_url(url);
 		if (!outputResult.has_value())
 		{
-			std::cerr << "Invalid URL: " << url << std::endl;
+			HTTP_LOG_ERROR("Invalid URL: {}", url);
 			return HTTPErr::InvalidURL;
 		}
 
-		auto socketResult = create_and_connect_socket(_persistentIoContext, outputResult->host, outputResult->port, _requestTimeout);
+		// The URL routes the connection, a socket path an earlier http+unix URL set does not outlive it.
+		// One set through set_socket_options stays for plain http URLs
+		if (!outputResult->socketPath.empty() || _socketPathFromUrl)
+		{
+			_socketOptions.unixSocketPath.clear();
+			_socketPathFromUrl = !outputResult->socketPath.empty();
+			if (percent_decode(outputResult->socketPath, _socketOptions.unixSocketPath) != HTTPErr::None)
+			{
+				HTTP_LOG_ERROR("Invalid URL: {}", url);
+				return HTTPErr::InvalidURL;
+			}
+		}
+
+		auto socketResult = create_and_connect_socket(_persistentIoContext, outputResult->host, outputResult->port, _requestTimeout, nullptr, _socketOptions);
 		if (!socketResult.has_value())
 		{
 			return socketResult.error();
 		}
 
-		auto requestResult = this->write_headers(HTTPMethod::GET, HTTPConnection::Persistent, HTTPContent::None, outputResult->host, outputResult->path, "", extraHeaders);
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		auto requestResult = write_str_request(
+			HTTPMethod::GET,
+			HTTPContent::None,
+			HTTPConnection::Persistent,
+			outputResult->host,
+			proxy_request_target(outputResult->host, outputResult->port, outputResult->target, _socketOptions.proxy, proxiedTarget),
+			"",
+			proxy_request_headers(extraHeaders, _socketOptions.proxy, proxiedHeaders),
+			&_defaultHeaders);
 		if (!requestResult.has_value())
 		{
 			return requestResult.error();
 		}
 		
-		_socket = std::make_unique<asio::ip::tcp::socket>(std::move(socketResult.value()));
+		_socket = std::make_unique<HTTPSocket>(std::move(*socketResult));
 
 		// Send the HTTP request
-		asio::write(*_socket, asio::buffer(requestResult.value()));
+		asio::error_code ec;
+		asio::write(*_socket, asio::buffer(*requestResult), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending HTTP request: {}:{}", ec.category().name(), ec.value());
+			_socket.reset();
+			return to_http_err(ec, HTTPErr::SendFailed);
+		}
 
 		_requestPort = outputResult->port;
 		_requestHost = outputResult->host;
 
-		DEBUG_LN
-		std::cout << "Persistent connection established to: " << outputResult->host << ":" << outputResult->port << " with Path: " << outputResult->path << std::endl;
+		HTTP_LOG_DEBUG("Persistent connection established to: {}:{} with Path: {}", outputResult->host, outputResult->port, outputResult->target);
 
-		// Read the HTTP response
-		auto res = get_string();
+		// Read the HTTP response, get_string would send a second request and leave its response on the socket
+		auto res = read_http_response(*_socket);
 
 		if (!res.has_value())
 		{
-			DEBUG_LN
-				std::cerr << "Failed to read HTTP response: " << static_cast<int>(res.error()) << std::endl;
+			HTTP_LOG_WARN("Failed to read HTTP response: {}", static_cast<int>(res.error()));
+			_socket.reset();
 			return res.error();
 		}
-		DEBUG_LN
-			std::cout << "Persistent connection established successfully." << std::endl;
+
+		if (res->connection == HTTPConnection::Close)
+		{
+			attempt_to_close_socket(*_socket);
+		}
+		HTTP_LOG_DEBUG("Persistent connection established successfully.");
 		return HTTPErr::None;
 	}
 
@@ -77,12 +116,11 @@ namespace communicator
 		std::vector<uint8_t> body;
 		if (std::holds_alternative<std::vector<uint8_t>>(outputResult->body))
 		{
-			body = std::get<std::vector<uint8_t>>(outputResult->body);
+			body = std::move(std::get<std::vector<uint8_t>>(outputResult->body));
 		}
 		else
 		{
-			DEBUG_LN
-				std::cerr << "Expected string body, but got binary data." << std::endl;
+			HTTP_LOG_WARN("Expected string body, but got binary data.");
 			return std::unexpected(HTTPErr::InvalidReadingData);
 		}
 
@@ -103,8 +141,7 @@ namespace communicator
 
 		if (outputResult->connection == HTTPConnection::Close)
 		{
-			DEBUG_LN
-				std::cout << "Connection closed after request." << std::endl;
+			HTTP_LOG_DEBUG("Connection closed after request.");
 
 			HTTPErr err = attempt_to_close_socket(*_socket);
 			if (err != HTTPErr::None)
@@ -122,7 +159,177 @@ namespace communicator
 
 	void HTTPCommunicator::set_headers(const std::unordered_map<std::string, std::string>& headers)
 	{
-		_headers = headers;
+		_defaultHeaders.assign(headers);
+	}
+
+	void HTTPCommunicator::set_disk_cache(HTTPDiskCache* cache)
+	{
+		_diskCache = cache;
+	}
+
+	void HTTPCommunicator::set_concurrency_limiter(HTTPConcurrencyLimiter* limiter)
+	{
+		_limiter = limiter;
+	}
+
+	HTTPErr HTTPCommunicator::set_socket_options(const HTTPSocketOptions& options)
+	{
+		// A new socket path takes effect with the next connection. Options without one keep the path of an http+unix URL
+		bool rerouted = options.proxy.host != _socketOptions.proxy.host || options.proxy.port != _socketOptions.proxy.port || options.proxy.mode != _socketOptions.proxy.mode;
+		std::string urlSocketPath = _socketPathFromUrl && options.unixSocketPath.empty() ? std::move(_socketOptions.unixSocketPath) : std::string();
+		_socketOptions = options;
+
+		if (!urlSocketPath.empty())
+			_socketOptions.unixSocketPath = std::move(urlSocketPath);
+		else
+			_socketPathFromUrl = false;
+
+		if (rerouted)
+			return set_proxy(options.proxy);
+
+		if (_socket && _socket->is_open())
+			return apply_socket_options(*_socket, _socketOptions);
+
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPCommunicator::set_proxy(const HTTPProxy& proxy)
+	{
+		if (proxy.enabled() && proxy.port.empty())
+		{
+			HTTP_LOG_ERROR("Proxy {} has no port.", proxy.host);
+			return HTTPErr::InvalidURL;
+		}
+
+		_socketOptions.proxy = proxy;
+
+		// The open connection goes to the old route, the next request connects through the new one
+		if (_socket)
+		{
+			attempt_to_close_socket(*_socket);
+			_socket.reset();
+		}
+
+		if (proxy.enabled())
+			HTTP_LOG_INFO("Proxy set to: {}:{}", proxy.host, proxy.port);
+
+		return HTTPErr::None;
+	}
+
+	std::expected<HTTPPreparedRequest, HTTPErr> HTTPCommunicator::prepare(HTTPMethod method, std::string_view url, HTTPContent content, const std::unordered_map<std::string, std::string>& headers)
+	{
+		HTTPErr err = check_before_sending_request(method);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		return HTTPPreparedRequest::prepare(
+			method,
+			content,
+			_requestHost,
+			proxy_request_target(_requestHost, _requestPort, url, _socketOptions.proxy, proxiedTarget),
+			_requestPort,
+			proxy_request_headers(headers, _socketOptions.proxy, proxiedHeaders),
+			HTTPConnection::Persistent,
+			&_defaultHeaders);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::send_prepared(const HTTPPreparedRequest& request, std::string_view body)
+	{
+		HTTPErr err = check_before_sending_request(request.method());
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		return persistent_exchange(request.method(), [&]() { return send_prepared_request(request, body, _socket.get(), _socketOptions); });
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::send_prepared(const HTTPPreparedRequest& request, const std::vector<uint8_t>& body)
+	{
+		HTTPErr err = check_before_sending_request(request.method());
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		return persistent_exchange(request.method(), [&]() { return send_prepared_request(request, body, _socket.get(), _socketOptions); });
+	}
+
+	std::expected<HTTPCachedResponse, HTTPErr> HTTPCommunicator::get_cached(std::string_view url, const std::unordered_map<std::string, std::string>& headers)
+	// Serves the body from the disk cache, revalidating the stored entry with a conditional GET. A 200 the cache does not
+	// take is returned all the same, owned by the response
+	{
+		if (!(_diskCache && _diskCache->is_open()))
+		{
+			return std::unexpected(HTTPErr::CacheUnavailable);
+		}
+
+		std::string cacheUrl = "http://" + _requestHost + ":" + _requestPort + std::string(url);
+
+		auto cached = _diskCache->lookup(cacheUrl, headers);
+
+		auto requestHeaders = headers;
+		if (cached.has_value())
+		{
+			if (!cached->etag.empty())
+				requestHeaders["If-None-Match"] = std::string(cached->etag);
+			if (!cached->lastModified.empty())
+				requestHeaders["If-Modified-Since"] = std::string(cached->lastModified);
+		}
+
+		auto outputResult = get(url, requestHeaders);
+		if (!outputResult.has_value())
+		{
+			return std::unexpected(outputResult.error());
+		}
+
+		if (outputResult->connection == HTTPConnection::Close)
+		{
+			HTTPErr err = attempt_to_close_socket(*_socket);
+			if (err != HTTPErr::None)
+				return std::unexpected(err);
+		}
+
+		if (outputResult->statusCode == 304 && cached.has_value())
+		{
+			HTTP_LOG_DEBUG("Cache entry revalidated: {}", cacheUrl);
+			return cached;
+		}
+
+		if (outputResult->statusCode != 200)
+		{
+			return std::unexpected(HTTPErr::ResponseError);
+		}
+
+		auto stored = _diskCache->store(cacheUrl, headers, *outputResult);
+		if (stored.has_value())
+			return stored;
+
+		// A response the cache refuses, no-store or Vary: * among them, is still served
+		HTTP_LOG_DEBUG("Response not cached ({}): {}", to_string(stored.error()), cacheUrl);
+
+		auto output = std::make_shared<const HTTPOutput>(std::move(*outputResult));
+
+		std::span<const uint8_t> body;
+		if (const auto* text = std::get_if<std::string>(&output->body))
+			body = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text->data()), text->size());
+		else
+			body = std::get<std::vector<uint8_t>>(output->body);
+
+		return HTTPCachedResponse{
+			body,
+			output->contentType,
+			output->contentEncoding,
+			output->statusCode,
+			output->etag,
+			output->lastModified,
+			std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+			std::move(output)
+		};
 	}
 
 
@@ -137,12 +344,11 @@ namespace communicator
 		std::string body;
 		if (std::holds_alternative<std::string>(outputResult->body))
 		{
-			body = std::get<std::string>(outputResult->body);
+			body = std::move(std::get<std::string>(outputResult->body));
 		}
 		else
 		{
-			DEBUG_LN
-				std::cerr << "Expected string body, but got binary data." << std::endl;
+			HTTP_LOG_WARN("Expected string body, but got binary data.");
 			return std::unexpected(HTTPErr::InvalidReadingData);
 		}
 
@@ -163,8 +369,7 @@ namespace communicator
 
 		if (outputResult->connection == HTTPConnection::Close)
 		{
-			DEBUG_LN
-				std::cout << "Connection closed after request." << std::endl;
+			HTTP_LOG_DEBUG("Connection closed after request.");
 
 			HTTPErr err = attempt_to_close_socket(*_socket);
 			if (err != HTTPErr::None)
@@ -192,15 +397,29 @@ namespace communicator
 			return outputResult.error();
 		}
 
+		if (outputResult->connection == HTTPConnection::Close)
+		{
+			HTTP_LOG_DEBUG("Connection closed after request.");
+
+			HTTPErr err = attempt_to_close_socket(*_socket);
+			if (err != HTTPErr::None)
+				return err;
+		}
+
+		// Ahead of the body checks, the page of a refused upload can be of any type
+		if (outputResult->statusCode != 200)
+		{
+			return HTTPErr::ResponseError;
+		}
+
 		std::vector<uint8_t> trueBody;
 		if (std::holds_alternative<std::vector<uint8_t>>(outputResult->body))
 		{
-			trueBody = std::get<std::vector<uint8_t>>(outputResult->body);
+			trueBody = std::move(std::get<std::vector<uint8_t>>(outputResult->body));
 		}
 		else
 		{
-			DEBUG_LN
-				std::cerr << "Expected string body, but got binary data." << std::endl;
+			HTTP_LOG_WARN("Expected string body, but got binary data.");
 			return HTTPErr::InvalidReadingData;
 		}
 
@@ -219,40 +438,39 @@ namespace communicator
 			run_decrytion(trueBody, outputResult->contentEncoding);
 		}
 
+		return HTTPErr::None;
+	}
+	HTTPErr HTTPCommunicator::post_string(std::string_view url, HTTPContent content, std::string_view body, const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto outputResult = post(url, content, body, headers);
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
 		if (outputResult->connection == HTTPConnection::Close)
 		{
-			DEBUG_LN
-				std::cout << "Connection closed after request." << std::endl;
+			HTTP_LOG_DEBUG("Connection closed after request.");
 
 			HTTPErr err = attempt_to_close_socket(*_socket);
 			if (err != HTTPErr::None)
 				return err;
 		}
 
+		// Ahead of the body checks, the page of a refused upload can be of any type
 		if (outputResult->statusCode != 200)
 		{
 			return HTTPErr::ResponseError;
 		}
 
-		return HTTPErr::None;
-	}
-	HTTPErr HTTPCommunicator::post_string(std::string_view url, HTTPContent content, std::string_view body, const std::unordered_map<std::string, std::string>& headers)
-	{
-		auto outputResult = post(url, content, body, headers);
-		if (!outputResult.has_value())
-		{
-			return outputResult.error();
-		}
-
 		std::string trueBody;
 		if (std::holds_alternative<std::string>(outputResult->body))
 		{
-			trueBody = std::get<std::string>(outputResult->body);
+			trueBody = std::move(std::get<std::string>(outputResult->body));
 		}
 		else
 		{
-			DEBUG_LN
-				std::cerr << "Expected string body, but got binary data." << std::endl;
+			HTTP_LOG_WARN("Expected string body, but got binary data.");
 			return HTTPErr::InvalidReadingData;
 		}
 
@@ -271,12 +489,74 @@ namespace communicator
 			return HTTPErr::InvalidContentType;
 		}
 
+		return HTTPErr::None;
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::post_http_output(std::string_view url, HTTPContent content, std::string_view body, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return post(url, content, body, headers);
+	}
+
+	HTTPErr HTTPCommunicator::get_to_file(std::string_view url, const std::filesystem::path& file, const HTTPFileWriteOptions& options, const std::unordered_map<std::string, std::string>& headers)
+	{
+		HTTPErr err = check_before_sending_request(HTTPMethod::GET);
+		if (err != HTTPErr::None)
+		{
+			return err;
+		}
+
+		auto outputResult = persistent_exchange(HTTPMethod::GET, [&]() { return send_download_request(_requestHost, url, _requestPort, file, options, headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
 		if (outputResult->connection == HTTPConnection::Close)
 		{
-			DEBUG_LN
-				std::cout << "Connection closed after request." << std::endl;
+			HTTP_LOG_DEBUG("Connection closed after request.");
 
-			HTTPErr err = attempt_to_close_socket(*_socket);
+			err = attempt_to_close_socket(*_socket);
+			if (err != HTTPErr::None)
+				return err;
+		}
+
+		return HTTPErr::None;
+	}
+
+	std::expected<std::vector<uint8_t>, HTTPErr> HTTPCommunicator::get_bytes_segmented(std::string_view url, const HTTPSegmentOptions& options, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return communicator::get_bytes_segmented(_requestHost, url, _requestPort, options, headers, &_defaultHeaders, _socketOptions);
+	}
+
+	HTTPErr HTTPCommunicator::get_to_file_segmented(std::string_view url, const std::filesystem::path& file, const HTTPSegmentOptions& options, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return communicator::get_to_file_segmented(_requestHost, url, _requestPort, file, options, headers, &_defaultHeaders, _socketOptions);
+	}
+
+	HTTPErr HTTPCommunicator::stream_events(std::string_view url, const HTTPEventCallback& callback, const HTTPEventStreamOptions& options, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return communicator::stream_events(_requestHost, url, _requestPort, callback, options, headers, &_defaultHeaders, _socketOptions);
+	}
+
+	HTTPErr HTTPCommunicator::post_multipart(std::string_view url, const HTTPMultipartBody& body, const std::unordered_map<std::string, std::string>& headers)
+	{
+		HTTPErr err = check_before_sending_request(HTTPMethod::POST);
+		if (err != HTTPErr::None)
+		{
+			return err;
+		}
+
+		auto outputResult = persistent_exchange(HTTPMethod::POST, [&]() { return send_multipart_request(HTTPMethod::POST, _requestHost, url, _requestPort, body, headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
+		if (outputResult->connection == HTTPConnection::Close)
+		{
+			HTTP_LOG_DEBUG("Connection closed after request.");
+
+			err = attempt_to_close_socket(*_socket);
 			if (err != HTTPErr::None)
 				return err;
 		}
@@ -289,9 +569,45 @@ namespace communicator
 		return HTTPErr::None;
 	}
 
-	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::post_http_output(std::string_view url, HTTPContent content, std::string_view body, const std::unordered_map<std::string, std::string>& headers)
+	HTTPErr HTTPCommunicator::post_file(std::string_view url, HTTPContent content, const std::filesystem::path& file, const std::unordered_map<std::string, std::string>& headers)
 	{
-		return post(url, content, body, headers);
+		return upload_file(HTTPMethod::POST, url, content, file, headers);
+	}
+
+	HTTPErr HTTPCommunicator::put_file(std::string_view url, HTTPContent content, const std::filesystem::path& file, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return upload_file(HTTPMethod::PUT, url, content, file, headers);
+	}
+
+	HTTPErr HTTPCommunicator::upload_file(HTTPMethod method, std::string_view url, HTTPContent content, const std::filesystem::path& file, const std::unordered_map<std::string, std::string>& headers)
+	{
+		HTTPErr err = check_before_sending_request(method);
+		if (err != HTTPErr::None)
+		{
+			return err;
+		}
+
+		auto outputResult = persistent_exchange(method, [&]() { return send_file_request(method, content, _requestHost, url, _requestPort, file, headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
+		if (outputResult->connection == HTTPConnection::Close)
+		{
+			HTTP_LOG_DEBUG("Connection closed after request.");
+
+			err = attempt_to_close_socket(*_socket);
+			if (err != HTTPErr::None)
+				return err;
+		}
+
+		if (outputResult->statusCode != 200)
+		{
+			return HTTPErr::ResponseError;
+		}
+
+		return HTTPErr::None;
 	}
 
 	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::get(std::string_view url, const std::unordered_map<std::string, std::string>& headers)
@@ -302,9 +618,8 @@ namespace communicator
 			return std::unexpected(err);
 		}
 
-		DEBUG_LN
-			std::cout << "Using persistent connection for GET request." << std::endl;
-		return ::communicator::get(_requestHost, url, _requestPort, headers, HTTPConnection::Persistent, _socket.get());
+		HTTP_LOG_DEBUG("Using persistent connection for GET request.");
+		return persistent_exchange(HTTPMethod::GET, [&]() { return send_http_request(HTTPMethod::GET, HTTPContent::None, _requestHost, url, _requestPort, "", headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
 
 	}
 
@@ -317,14 +632,12 @@ namespace communicator
 		HTTPErr err = check_before_sending_request(HTTPMethod::POST);
 		if (err != HTTPErr::None)
 		{
-			DEBUG_LN
-				std::cerr << "Failed to check before sending POST request: " << static_cast<int>(err) << std::endl;
+			HTTP_LOG_WARN("Failed to check before sending POST request: {}", static_cast<int>(err));
 			return std::unexpected(err);
 		}
 
-		DEBUG_LN
-			std::cout << "Using persistent connection for POST request." << std::endl;
-		return ::communicator::post(_requestHost, url, _requestPort, content, body, headers, HTTPConnection::Persistent, _socket.get());
+		HTTP_LOG_DEBUG("Using persistent connection for POST request.");
+		return persistent_exchange(HTTPMethod::POST, [&]() { return send_http_request(HTTPMethod::POST, content, _requestHost, url, _requestPort, body, headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
 	}
 
 	std::expected<HTTPOutput, HTTPErr> HTTPCommunicator::post(
@@ -337,26 +650,35 @@ namespace communicator
 		HTTPErr err = check_before_sending_request(HTTPMethod::POST);
 			if (err != HTTPErr::None)
 			{
-				DEBUG_LN
-					std::cerr << "Failed to check before sending POST request: " << static_cast<int>(err) << std::endl;
+				HTTP_LOG_WARN("Failed to check before sending POST request: {}", static_cast<int>(err));
 				return std::unexpected(err);
 			}
-		DEBUG_LN
-			std::cout << "Using persistent connection for POST request." << std::endl;
-		return ::communicator::post(_requestHost, url, _requestPort, content, body, headers, HTTPConnection::Persistent, _socket.get());
+		HTTP_LOG_DEBUG("Using persistent connection for POST request.");
+		return persistent_exchange(HTTPMethod::POST, [&]() { return send_http_request(content, _requestHost, url, _requestPort, body, headers, HTTPConnection::Persistent, _socket.get(), &_defaultHeaders, _socketOptions); });
 	}
 
 	HTTPErr HTTPCommunicator::check_before_sending_request(HTTPMethod method)
 	{
-		if (!(_socket && _socket->is_open()))
+		_connectionReused = _socket && is_connection_alive(*_socket);
+
+		if (_connectionReused)
+		{
+			rearm_quick_ack(*_socket, _socketOptions);
+		}
+		else if (_socket)
+		{
+			HTTP_LOG_DEBUG("Persistent connection was closed by the server while idle, replacing it.");
+			attempt_to_close_socket(*_socket);
+			_socket.reset();
+		}
+
+		if (!_socket)
 		{
-			DEBUG_LN
-				std::cout << "Creating new connection for " << to_string(method) << " request." << std::endl;
+			HTTP_LOG_DEBUG("Creating new connection for {} request.", to_string(method));
 			HTTPErr err = make_persistent_connection(_requestUrl);
 			if (err != HTTPErr::None)
 			{
-				DEBUG_LN
-					std::cerr << "Failed to make persistent connection: " << static_cast<int>(err) << std::endl;
+				HTTP_LOG_WARN("Failed to make persistent connection: {}", static_cast<int>(err));
 				return err;
 			}
 		}
@@ -364,7 +686,19 @@ namespace communicator
 		return HTTPErr::None;
 	}
 
-	HTTPErr HTTPCommunicator::attempt_to_close_socket(asio::ip::tcp::socket& socket)
+	bool HTTPCommunicator::replace_stale_connection(HTTPMethod method, HTTPErr err)
+	{
+		if (err != HTTPErr::ClosedBeforeResponse || !_connectionReused || !is_idempotent(method))
+			return false;
+
+		// The server closed the kept-alive connection while the request was on its way, nothing was answered
+		HTTP_LOG_INFO("Reused connection closed before the {} response, retrying on a new connection.", to_string(method));
+		_socket.reset();
+
+		return check_before_sending_request(method) == HTTPErr::None;
+	}
+
+	HTTPErr HTTPCommunicator::attempt_to_close_socket(HTTPSocket& socket)
 	{
 		if (_socket && _socket->is_open())
 		{
@@ -373,8 +707,7 @@ namespace communicator
 			_socket->close(ec);
 			if (ec)
 			{
-				DEBUG_LN
-					std::cerr << "Error closing socket: " << ec.message() << std::endl;
+				HTTP_LOG_WARN("Error closing socket: {}:{}", ec.category().name(), ec.value());
 				return HTTPErr::FailedToCloseSocket;
 			}
 		}
@@ -387,36 +720,14 @@ namespace communicator
 		return ::communicator::send_raw_http_request(_requestHost, path, _requestPort, request, _socket.get());
 	}
 
-	std::expected<std::string, HTTPErr> HTTPCommunicator::write_headers(HTTPMethod method, HTTPConnection connection, HTTPContent contentType, std::string_view host, std::string_view path, std::string_view body, const std::unordered_map<std::string, std::string>& extraHeaders)
-	{
-		auto headers = extraHeaders;
-
-		headers.insert(_headers.begin(), _headers.end());
-
-		for (const auto& extraHeader : headers)
-		{
-			auto it = _headers.find(extraHeader.first);
-			if (it != _headers.end())
-			{
-				headers.erase(it);
-			}
-		}
-
-
-		return ::communicator::write_str_request(method, contentType, connection, host, path, body, headers);
-	}
-
-
 	HTTPCommunicator::~HTTPCommunicator()
 	{
 		if (_socket && _socket->is_open())
 		{
-			DEBUG_LN
-				std::cout << "Closing persistent connection." << std::endl;
-
-			std::string req = "GET / HTTP/1.1\r\nHost: " + _requestHost + "\r\nConnection: close\r\n\r\n";
+			HTTP_LOG_DEBUG("Closing persistent connection.");
 
-			send_close_http_request(*_socket, _requestHost, _requestPort);
+			std::string proxiedTarget;
+			send_close_http_request(*_socket, _requestHost, _requestPort, proxy_request_target(_requestHost, _requestPort, "/", _socketOptions.proxy, proxiedTarget));
 
 			attempt_to_close_socket(*_socket);
 		}
@@ -430,51 +741,68 @@ namespace communicator
 		std::string_view url,
 		const std::unordered_map<std::string, std::string>& headers,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket) 
+		HTTPSocket* socket) 
 	{
-		auto outputResult = decrypt_url_http(url);
+		auto outputResult = parse_http_url(url);
 		if (!outputResult.has_value())
 		{
 			return std::unexpected(outputResult.error());
 		}
 
-		return send_http_request(HTTPMethod::GET, HTTPContent::None, outputResult->host, outputResult->path, outputResult->port, "", headers, connection, socket);
+		return send_http_request(HTTPMethod::GET, HTTPContent::None, outputResult->host, outputResult->target, outputResult->port, "", headers, connection, socket, nullptr, socket_options_for(*outputResult));
 	}
 
-	std::expected<HTTPOutput, HTTPErr> get(std::string_view host, std::string_view path, std::string_view port, const std::unordered_map<std::string, std::string>& headers, HTTPConnection connection, asio::ip::tcp::socket* socket)
+	std::expected<HTTPOutput, HTTPErr> get(std::string_view host, std::string_view path, std::string_view port, const std::unordered_map<std::string, std::string>& headers, HTTPConnection connection, HTTPSocket* socket)
 	{
 		return send_http_request(HTTPMethod::GET, HTTPContent::None, host, path, port, "", headers, connection, socket);
 	}
 
-
-
-	// --- POST Methods ---
-
-	std::expected<HTTPOutput, HTTPErr> post(
+	std::expected<HTTPOutput, HTTPErr> get_to_file(
 		std::string_view url,
-		HTTPContent content,
-		std::string_view body,
+		const std::filesystem::path& file,
+		const HTTPFileWriteOptions& options,
 		const std::unordered_map<std::string, std::string>& headers,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket)
 	{
-		auto outputResult = decrypt_url_http(url);
+		auto outputResult = parse_http_url(url);
 		if (!outputResult.has_value())
 		{
 			return std::unexpected(outputResult.error());
 		}
 
-		return send_http_request(HTTPMethod::POST, content, outputResult->host, outputResult->path, outputResult->port, body, headers, connection, socket);
+		return send_download_request(outputResult->host, outputResult->target, outputResult->port, file, options, headers, connection, socket, nullptr, socket_options_for(*outputResult));
 	}
 
-	std::expected<HTTPOutput, HTTPErr> post(std::string_view host,
-		std::string_view path,
-		std::string_view port,
+
+
+	// --- POST Methods ---
+
+	std::expected<HTTPOutput, HTTPErr> post(
+		std::string_view url,
+		HTTPContent content,
+		std::string_view body,
+		const std::unordered_map<std::string, std::string>& headers,
+		HTTPConnection connection,
+		HTTPSocket* socket)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
+		{
+			return std::unexpected(outputResult.error());
+		}
+
+		return send_http_request(HTTPMethod::POST, content, outputResult->host, outputResult->target, outputResult->port, body, headers, connection, socket, nullptr, socket_options_for(*outputResult));
+	}
+
+	std::expected<HTTPOutput, HTTPErr> post(std::string_view host,
+		std::string_view path,
+		std::string_view port,
 		HTTPContent content,
 		std::string_view body,
 		const std::unordered_map<std::string, std::string>& headers,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket)
 	{
 		return send_http_request(HTTPMethod::POST, content, host, path, port, body, headers, connection, socket);
 	}
@@ -485,7 +813,7 @@ namespace communicator
 		std::string_view port, HTTPConnection connection, 
 		HTTPContent content, const std::vector<uint8_t>& body, 
 		const std::unordered_map<std::string, std::string>& headers, 
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket)
 	{
 		return send_http_request(content, host, path, port, body, headers, connection, socket);
 	}
@@ -493,6 +821,68 @@ namespace communicator
 
 	// --- HTTP Request Sending Methods ---
 
+	namespace
+	{
+		template <typename WriteBody>
+		std::expected<HTTPOutput, HTTPErr> send_expecting_continue(
+			// Sends the head alone and the body only once the server lets it, so a refused upload costs a round trip
+			HTTPStream& stream,
+			std::string_view head,
+			uint64_t bodySize,
+			const HTTPSocketOptions& socketOptions,
+			HTTPTiming* timing,
+			WriteBody&& write_body)
+		{
+			asio::error_code ec;
+			asio::write(stream, asio::buffer(head.data(), head.size()), ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error sending HTTP request head: {}:{}", ec.category().name(), ec.value());
+				return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+			}
+
+			asio::streambuf responseBuffer;
+
+			auto proceed = await_continue(stream, responseBuffer, socketOptions.expectContinueTimeout);
+			if (!proceed.has_value())
+			{
+				return std::unexpected(proceed.error());
+			}
+
+			if (!*proceed)
+			{
+				HTTP_TIMING_ADD(timing, bytesSent, head.size());
+				HTTP_TIMING_MARK(timing, requestSent);
+
+				// A refusal is usually a 401, 413 or 417, it comes back with its status rather than as ResponseError
+				auto response = read_http_response(stream, responseBuffer, timing, true);
+
+				// The server still expects the body it announced, the connection cannot carry another request
+				asio::error_code ignored;
+				stream.socket().shutdown(HTTPSocket::shutdown_both, ignored);
+				stream.socket().close(ignored);
+
+				if (response.has_value())
+					response->connection = HTTPConnection::Close;
+
+				return response;
+			}
+
+			HTTPErr err = write_body();
+			if (err != HTTPErr::None)
+			{
+				return std::unexpected(err);
+			}
+
+			HTTP_TIMING_ADD(timing, bytesSent, head.size() + bodySize);
+			HTTP_TIMING_MARK(timing, requestSent);
+
+			HTTP_LOG_DEBUG("HTTP request sent after 100 Continue: {}<{} bytes>", head, bodySize);
+
+			return read_http_response(stream, responseBuffer, timing);
+		}
+	}
+
 	std::expected<HTTPOutput, HTTPErr> send_http_request(
 		HTTPMethod method,
 		HTTPContent content,
@@ -502,56 +892,75 @@ namespace communicator
 		std::string_view body,
 		const std::unordered_map<std::string, std::string>& extraHeaders,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
 	{
-		try
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
+
+		bool expectContinue = expects_continue(socketOptions, body.size());
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		std::string_view target = proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget);
+		const auto& headers = proxy_request_headers(extraHeaders, socketOptions.proxy, proxiedHeaders);
+
+		// Held back behind Expect the body cannot ride in the same string as the head
+		auto requestResult = expectContinue
+			? write_str_request(method, content, connection, host, target, static_cast<uint64_t>(body.size()), headers, defaultHeaders, true)
+			: write_str_request(method, content, connection, host, target, body, headers, defaultHeaders);
+		if (!requestResult.has_value())
 		{
-			auto requestResult = write_str_request(method, content, connection, host, path, body, extraHeaders);
-			if (!requestResult.has_value())
-			{
-				return std::unexpected(requestResult.error());
-			}
-			if (socket && socket->is_open())
-			{
-				// Send the HTTP request
-				asio::error_code ec;
-				asio::write(*socket, asio::buffer(requestResult.value()), ec);
+			return std::unexpected(requestResult.error());
+		}
 
-				if (ec)
-				{
-					DEBUG_LN
-						std::cerr << "Error sending HTTP request: " << ec.message() << std::endl;
-					return std::unexpected(HTTPErr::ConnectionFailed);
-				}
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
 
-				DEBUG_LN
-					std::cout << "HTTP request sent: " << requestResult.value() << std::endl;
-				return read_http_response(*socket);
-			}
-			else
+		if (socket && socket->is_open())
+		{
+			HTTP_TIMING_SET(&timing, connectionReused, true);
+		}
+		else
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing, socketOptions);
+			if (!socketResult.has_value())
 			{
-				asio::io_context ioContext;
-				auto socketResult = create_and_connect_socket(ioContext, host, port, 10);
-				if (!socketResult.has_value())
-				{
-					return std::unexpected(socketResult.error());
-				}
-
-				asio::write(socketResult.value(), asio::buffer(requestResult.value()));
+				return std::unexpected(socketResult.error());
+			}
 
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
+		}
 
-				DEBUG_LN
-					std::cout << "Raw HTTP request sent: " << requestResult.value() << std::endl;
+		HTTPStream stream(*socket);
 
-				return read_http_response(socketResult.value());
-			}
+		if (expectContinue)
+		{
+			return send_expecting_continue(stream, *requestResult, body.size(), socketOptions, &timing, [&]()
+				{
+					asio::error_code ec;
+					asio::write(stream, asio::buffer(body.data(), body.size()), ec);
+					return ec ? to_http_err(ec, HTTPErr::SendFailed) : HTTPErr::None;
+				});
 		}
-		catch (const std::exception& e)
+
+		// Send the HTTP request
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(*requestResult), ec);
+		if (ec)
 		{
-			std::cerr << "Error: " << e.what() << std::endl;
-			return std::unexpected(HTTPErr::ConnectionFailed);
+			HTTP_LOG_WARN("Error sending HTTP request: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
 		}
 
+		HTTP_TIMING_ADD(&timing, bytesSent, requestResult->size());
+		HTTP_TIMING_MARK(&timing, requestSent);
+
+		HTTP_LOG_DEBUG("HTTP request sent: {}", *requestResult);
+
+		return read_http_response(stream, &timing);
 	}
 
 	std::expected<HTTPOutput, HTTPErr> send_http_request(
@@ -562,184 +971,657 @@ namespace communicator
 		const std::vector<uint8_t>& body, 
 		const std::unordered_map<std::string, std::string>& extraHeaders,
 		HTTPConnection connection, 
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
 	{
-		try
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
+
+		bool expectContinue = expects_continue(socketOptions, body.size());
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		auto requestResult = write_str_request(HTTPMethod::POST, content, connection, host, proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget), static_cast<uint64_t>(body.size()), proxy_request_headers(extraHeaders, socketOptions.proxy, proxiedHeaders), defaultHeaders, expectContinue);
+		if (!requestResult.has_value())
 		{
-			auto requestResult = write_str_request(HTTPMethod::POST, content, connection, host, path, "", extraHeaders);
-			if (!requestResult.has_value())
-			{
-				return std::unexpected(requestResult.error());
-			}
-			if (socket && socket->is_open())
+			return std::unexpected(requestResult.error());
+		}
+
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
+
+		if (socket && socket->is_open())
+		{
+			HTTP_TIMING_SET(&timing, connectionReused, true);
+		}
+		else
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing, socketOptions);
+			if (!socketResult.has_value())
 			{
-				// Send the HTTP request
-				asio::write(*socket, asio::buffer(requestResult.value()));
-				asio::write(*socket, asio::buffer(body));
-				DEBUG_LN
-					std::cout << "HTTP request sent: " << requestResult.value() << std::endl;
-				return read_http_response(*socket);
+				return std::unexpected(socketResult.error());
 			}
-			else
-			{
-				asio::io_context ioContext;
-				auto socketResult = create_and_connect_socket(ioContext, host, port, 10);
-				if (!socketResult.has_value())
+
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
+		}
+
+		HTTPStream stream(*socket);
+
+		if (expectContinue)
+		{
+			return send_expecting_continue(stream, *requestResult, body.size(), socketOptions, &timing, [&]()
 				{
-					return std::unexpected(socketResult.error());
-				}
+					asio::error_code ec;
+					asio::write(stream, asio::buffer(body), ec);
+					return ec ? to_http_err(ec, HTTPErr::SendFailed) : HTTPErr::None;
+				});
+		}
 
-				asio::write(socketResult.value(), asio::buffer(requestResult.value()));
-				asio::write(socketResult.value(), asio::buffer(body));
+		// Send the HTTP request, head and body in one gathered write
+		std::array<asio::const_buffer, 2> buffers = { asio::buffer(*requestResult), asio::buffer(body) };
 
+		asio::error_code ec;
+		asio::write(stream, buffers, ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending HTTP request: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+		}
+
+		HTTP_TIMING_ADD(&timing, bytesSent, requestResult->size() + body.size());
+		HTTP_TIMING_MARK(&timing, requestSent);
 
-				DEBUG_LN
-					std::cout << "Raw HTTP request sent: " << requestResult.value() << std::endl;
+		HTTP_LOG_DEBUG("HTTP request sent: {}", *requestResult);
+
+		return read_http_response(stream, &timing);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> send_file_request(
+		HTTPMethod method,
+		HTTPContent content,
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& extraHeaders,
+		HTTPConnection connection,
+		HTTPSocket* socket,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
+	{
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
 
-				return read_http_response(socketResult.value());
+		std::error_code fsError;
+		uint64_t fileSize = std::filesystem::file_size(file, fsError);
+		if (fsError)
+		{
+			HTTP_LOG_WARN("Failed to stat upload file: {}:{}", fsError.category().name(), fsError.value());
+			return std::unexpected(HTTPErr::FileIOFailed);
+		}
+
+		bool expectContinue = expects_continue(socketOptions, fileSize);
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		auto requestResult = write_str_request(method, content, connection, host, proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget), fileSize, proxy_request_headers(extraHeaders, socketOptions.proxy, proxiedHeaders), defaultHeaders, expectContinue);
+		if (!requestResult.has_value())
+		{
+			return std::unexpected(requestResult.error());
+		}
+
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
+
+		HTTP_TIMING_SET(&timing, connectionReused, socket && socket->is_open());
+
+		if (!(socket && socket->is_open()))
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing, socketOptions);
+			if (!socketResult.has_value())
+			{
+				return std::unexpected(socketResult.error());
 			}
+
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
+		}
+
+		HTTPStream stream(*socket);
+
+		if (expectContinue)
+		{
+			return send_expecting_continue(stream, *requestResult, fileSize, socketOptions, &timing, [&]() { return send_file_body(*socket, file, fileSize); });
 		}
-		catch (const std::exception& e)
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(*requestResult), ec);
+		if (ec)
 		{
-			std::cerr << "Error: " << e.what() << std::endl;
-			return std::unexpected(HTTPErr::ConnectionFailed);
+			HTTP_LOG_WARN("Error sending HTTP request head: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
 		}
+
+		HTTPErr err = send_file_body(*socket, file, fileSize);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		HTTP_TIMING_ADD(&timing, bytesSent, requestResult->size() + fileSize);
+		HTTP_TIMING_MARK(&timing, requestSent);
+
+		HTTP_LOG_DEBUG("File request sent: {}<{} bytes from {}>", *requestResult, fileSize, file.string());
+
+		return read_http_response(stream, &timing);
 	}
 
-	std::expected<HTTPOutput, HTTPErr> send_raw_http_request(std::string_view host, std::string_view path, std::string_view port, std::string_view request, asio::ip::tcp::socket* socket)
+	std::expected<HTTPOutput, HTTPErr> send_multipart_request(
+		HTTPMethod method,
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPMultipartBody& body,
+		const std::unordered_map<std::string, std::string>& extraHeaders,
+		HTTPConnection connection,
+		HTTPSocket* socket,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
 	{
-		try
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
+
+		auto headers = extraHeaders;
+		headers["Content-Type"] = body.content_type();
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		// A chunked body has no size to hold against the threshold
+		bool expectContinue = body.content_length().has_value() && expects_continue(socketOptions, *body.content_length());
+
+		auto requestResult = write_str_request(method, HTTPContent::MultipartFormData, connection, host, proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget), body.content_length(), proxy_request_headers(headers, socketOptions.proxy, proxiedHeaders), defaultHeaders, expectContinue);
+		if (!requestResult.has_value())
 		{
-			asio::io_context ioContext;
-			if (socket && socket->is_open())
-			{
-				auto result = is_valid_http_request(request);
-				if (result != HTTPErr::None)
-				{
-					return std::unexpected(result);
-				}
+			return std::unexpected(requestResult.error());
+		}
 
-				asio::write(*socket, asio::buffer(request));
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
 
-				DEBUG_LN
-					std::cout << "Raw HTTP request sent: " << request << std::endl;
+		HTTP_TIMING_SET(&timing, connectionReused, socket && socket->is_open());
 
-				return read_http_response(*socket);
+		if (!(socket && socket->is_open()))
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing, socketOptions);
+			if (!socketResult.has_value())
+			{
+				return std::unexpected(socketResult.error());
 			}
-			else
+
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
+		}
+
+		HTTPStream stream(*socket);
+
+		if (expectContinue)
+		{
+			return send_expecting_continue(stream, *requestResult, *body.content_length(), socketOptions, &timing, [&]() { return body.write_to(*socket); });
+		}
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(*requestResult), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending HTTP request head: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+		}
+
+		HTTPErr err = body.write_to(*socket);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		HTTP_TIMING_ADD(&timing, bytesSent, requestResult->size() + body.content_length().value_or(0));
+		HTTP_TIMING_MARK(&timing, requestSent);
+
+		HTTP_LOG_DEBUG("Multipart request sent: {}<multipart body>", *requestResult);
+
+		return read_http_response(stream, &timing);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> send_download_request(
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const HTTPFileWriteOptions& options,
+		const std::unordered_map<std::string, std::string>& extraHeaders,
+		HTTPConnection connection,
+		HTTPSocket* socket,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
+	{
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
+
+		std::string proxiedTarget;
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		auto requestResult = write_str_request(HTTPMethod::GET, HTTPContent::None, connection, host, proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget), "", proxy_request_headers(extraHeaders, socketOptions.proxy, proxiedHeaders), defaultHeaders);
+		if (!requestResult.has_value())
+		{
+			return std::unexpected(requestResult.error());
+		}
+
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
+
+		HTTP_TIMING_SET(&timing, connectionReused, socket && socket->is_open());
+
+		if (!(socket && socket->is_open()))
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing, socketOptions);
+			if (!socketResult.has_value())
 			{
-				auto socketResult = create_and_connect_socket(ioContext, host, port, 10);
-				if (!socketResult.has_value())
-				{
-					return std::unexpected(socketResult.error());
-				}
-			
-				asio::write(socketResult.value(), asio::buffer(request));
+				return std::unexpected(socketResult.error());
+			}
+
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
+		}
+
+		HTTPStream stream(*socket);
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(*requestResult), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending HTTP request: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+		}
+
+		HTTP_TIMING_ADD(&timing, bytesSent, requestResult->size());
+		HTTP_TIMING_MARK(&timing, requestSent);
+
+		asio::streambuf responseBuffer;
+
+		auto headResult = read_http_head(stream, responseBuffer, &timing);
+		if (!headResult.has_value())
+		{
+			return headResult;
+		}
+
+		if (headResult->statusCode != 200)
+		{
+			return std::unexpected(HTTPErr::ResponseError);
+		}
+
+		HTTPFileSink sink;
+
+		HTTPErr err = sink.open(file, options, headResult->contentLength);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		err = read_body_to_file(stream, responseBuffer, *headResult, sink);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		err = sink.commit();
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		HTTP_LOG_DEBUG("HTTP Response Body written to {}: {} bytes.", file.string(), sink.bytes_written());
 
-				DEBUG_LN
-					std::cout << "Raw HTTP request sent: " << request << std::endl;
+		headResult->contentLength = static_cast<size_t>(sink.bytes_written());
 
-				return read_http_response(socketResult.value());
+		HTTP_TIMING_ADD(&timing, bytesReceived, sink.bytes_written());
+		HTTP_TIMING_MARK(&timing, completed);
+		HTTP_TIMING_ATTACH(headResult, &timing);
+
+		return headResult;
+	}
+
+	std::expected<HTTPOutput, HTTPErr> send_raw_http_request(std::string_view host, std::string_view path, std::string_view port, std::string_view request, HTTPSocket* socket)
+	{
+		HTTPTiming timing;
+		HTTP_TIMING_MARK(&timing, start);
+
+		asio::io_context ioContext;
+		std::optional<HTTPSocket> ownedSocket;
+
+		if (socket && socket->is_open())
+		{
+			auto result = is_valid_http_request(request);
+			if (result != HTTPErr::None)
+			{
+				return std::unexpected(result);
 			}
+
+			HTTP_TIMING_SET(&timing, connectionReused, true);
+		}
+		else
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, 10, &timing);
+			if (!socketResult.has_value())
+			{
+				return std::unexpected(socketResult.error());
+			}
+
+			ownedSocket.emplace(std::move(*socketResult));
+			socket = &*ownedSocket;
 		}
-		catch (const std::exception& e)
+
+		HTTPStream stream(*socket);
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(request), ec);
+		if (ec)
 		{
-			std::cerr << "Error: " << e.what() << std::endl;
-			return std::unexpected(HTTPErr::ConnectionFailed);
+			HTTP_LOG_WARN("Error sending HTTP request: {}:{}", ec.category().name(), ec.value());
+			return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
 		}
+
+		HTTP_TIMING_ADD(&timing, bytesSent, request.size());
+		HTTP_TIMING_MARK(&timing, requestSent);
+
+		HTTP_LOG_DEBUG("Raw HTTP request sent: {}", request);
+
+		return read_http_response(stream, &timing);
 	}
 
-	void send_close_http_request(asio::ip::tcp::socket& socket, std::string_view host, std::string_view port, std::string_view path)
+	void send_close_http_request(HTTPSocket& socket, std::string_view host, std::string_view port, std::string_view path)
 	{
 		if (!socket.is_open())
 		{
-			DEBUG_LN
-			std::cerr << "Socket is not open or valid." << std::endl;
+			HTTP_LOG_WARN("Socket is not open or valid.");
 			return;
 		}
-		std::string request = "GET " + std::string(path) + " HTTP/1.1\r\n"
-			"Host: " + std::string(host) + "\r\n"
-			"Connection: close\r\n"
-			"\r\n";
-		try
-		{
-			asio::write(socket, asio::buffer(request));
-			DEBUG_LN
-				std::cout << "Close HTTP request sent." << std::endl;
-		}
-		catch (const std::exception& e)
+		std::string request = "GET " + std::string(path) + " HTTP/1.1\r\nHost: ";
+		append_host(host, request);
+		request.append("\r\nConnection: close\r\n\r\n");
+		asio::error_code ec;
+		asio::write(socket, asio::buffer(request), ec);
+		if (ec)
 		{
-			DEBUG_LN
-			std::cerr << "Error sending close request: " << e.what() << std::endl;
+			HTTP_LOG_WARN("Error sending close request: {}:{}", ec.category().name(), ec.value());
+			return;
 		}
+
+		HTTP_LOG_DEBUG("Close HTTP request sent.");
 	}
 
 
 	// --- Request Writing Methods ---
 
-	std::expected<std::string, HTTPErr> write_str_request(HTTPMethod method, HTTPContent contentType, HTTPConnection connection, std::string_view host, std::string_view path, std::string_view body, const std::unordered_map<std::string, std::string>& headers)
+	std::expected<std::string, HTTPErr> write_str_request(HTTPMethod method, HTTPContent contentType, HTTPConnection connection, std::string_view host, std::string_view path, std::string_view body, const std::unordered_map<std::string, std::string>& headers, const HTTPHeaderBlock* defaultHeaders)
+	{
+		if (body.empty() && (method == HTTPMethod::POST || method == HTTPMethod::PUT))
+		{
+			return std::unexpected(HTTPErr::NoBodyForMethod);
+		}
+
+		auto requestResult = write_str_request(method, contentType, connection, host, path, static_cast<uint64_t>(body.size()), headers, defaultHeaders);
+		if (!requestResult.has_value())
+		{
+			return std::unexpected(requestResult.error());
+		}
+
+		requestResult->append(body);
+
+		return requestResult;
+	}
+
+	std::expected<std::string, HTTPErr> write_str_request(HTTPMethod method, HTTPContent contentType, HTTPConnection connection, std::string_view host, std::string_view path, std::optional<uint64_t> contentLength, const std::unordered_map<std::string, std::string>& headers, const HTTPHeaderBlock* defaultHeaders, bool expectContinue)
 	{
-		std::ostringstream requestStream;
-		requestStream << to_string(method) << " " << path << " HTTP/1.1\r\n";
-		requestStream << "Host: " << host << "\r\n";
+		std::string methodText = to_string(method);
+		std::string connectionText = to_string(connection);
+
+		size_t size = methodText.size() + path.size() + host.size() + connectionText.size() + 96;
+		if (defaultHeaders)
+			size += defaultHeaders->wire().size();
+		for (const auto& header : headers)
+			size += header.first.size() + header.second.size() + 4;
+
+		std::string request;
+		request.reserve(size);
+
+		request.append(methodText).append(" ");
+		if (path.empty() || (path.front() != '/' && !path.starts_with("http://"))) // Absolute form goes to a forward proxy as is
+			request.append("/");
+		request.append(path).append(" HTTP/1.1\r\n");
+		request.append("Host: ");
+		append_host(host, request);
+		request.append("\r\n");
+
+		// Defaults first, minus any a per-request header replaces
+		if (defaultHeaders)
+			defaultHeaders->append_to(request, headers);
 
 		for (const auto& header : headers)
 		{
-			requestStream << header.first << ": " << header.second << "\r\n";
+			request.append(header.first).append(": ").append(header.second).append("\r\n");
 		}
 
-		requestStream << "Connection: " << to_string(connection) << "\r\n";
+		request.append("Connection: ").append(connectionText).append("\r\n");
 
-		if (!body.empty())
-		{
-			requestStream << "Content-Length: " << body.size() << "\r\n";
+		bool hasBody = !contentLength.has_value() || *contentLength > 0 || method == HTTPMethod::POST || method == HTTPMethod::PUT;
 
-			requestStream << "Content-Type: " << to_string(contentType) << "\r\n";
-		}
-		else if (method == HTTPMethod::POST || method == HTTPMethod::PUT)
+		if (hasBody)
 		{
-			return std::unexpected(HTTPErr::NoBodyForMethod);
-		}
+			if (contentLength.has_value())
+				request.append("Content-Length: ").append(std::to_string(*contentLength)).append("\r\n");
+			else
+				request.append("Transfer-Encoding: chunked\r\n");
+
+			// An explicit Content-Type header, e.g. one carrying a multipart boundary, wins over the enum
+			if (!has_header(headers, "Content-Type") && !(defaultHeaders && defaultHeaders->contains("Content-Type")))
+				request.append("Content-Type: ").append(to_string(contentType)).append("\r\n");
 
-		requestStream << "\r\n";
+			if (expectContinue)
+				request.append("Expect: 100-continue\r\n");
+		}
 
-		if (!body.empty())
-		requestStream << body;
+		request.append("\r\n");
 
-		return requestStream.str();
+		return request;
 	}
 
 
 	// --- HTTP Response Reading Method ---
 
-	std::expected<HTTPOutput, HTTPErr> read_http_response(asio::ip::tcp::socket& socket)
+	namespace
+	{
+		template <typename Body>
+		HTTPErr read_body(HTTPStream& stream, asio::streambuf& responseBuffer, const HTTPOutput& head, Body& body)
+		// Only the bytes that arrived together with the head are copied out of responseBuffer, the rest is read in place
+		{
+			using Byte = typename Body::value_type;
+
+			auto take_buffered = [&](size_t limit)
+				{
+					size_t available = std::min(responseBuffer.size(), limit);
+					const Byte* data = static_cast<const Byte*>(responseBuffer.data().data());
+					body.insert(body.end(), data, data + available);
+					responseBuffer.consume(available);
+					return available;
+				};
+
+			auto read_exactly = [&](size_t size)
+				{
+					// The size came from the server, the body only grows by what actually arrives
+					while (size > 0)
+					{
+						size_t offset = body.size();
+						size_t step = std::min(size, HTTP_BODY_RESERVE_SIZE);
+						body.resize(offset + step);
+
+						asio::error_code ec;
+						asio::read(stream, asio::buffer(body.data() + offset, step), ec);
+						if (ec)
+							return to_http_err(ec, HTTPErr::ReceiveFailed);
+
+						size -= step;
+					}
+
+					return HTTPErr::None;
+				};
+
+			if (head.statusCode == 204 || head.statusCode == 304 || head.statusCode < 200)
+			{
+				return HTTPErr::None;
+			}
+
+			asio::error_code ec;
+
+			if (head.transferEncoding != HTTPTransferEncoding::Chunked)
+			{
+				if (head.contentLength > 0)
+				{
+					if (head.contentLength > HTTP_MAX_BODY_SIZE)
+					{
+						HTTP_LOG_WARN("Content-Length {} is over the {} byte limit.", head.contentLength, HTTP_MAX_BODY_SIZE);
+						return HTTPErr::InvalidContentLength;
+					}
+
+					body.reserve(std::min(head.contentLength, HTTP_BODY_RESERVE_SIZE));
+
+					size_t buffered = take_buffered(head.contentLength);
+					return buffered < head.contentLength ? read_exactly(head.contentLength - buffered) : HTTPErr::None;
+				}
+
+				if (head.connection != HTTPConnection::Close)
+				{
+					return HTTPErr::None;
+				}
+
+				// No length and the server closes the connection, the body runs until EOF
+				take_buffered(responseBuffer.size());
+
+				constexpr size_t readSize = 64 * 1024;
+				while (true)
+				{
+					size_t offset = body.size();
+					body.resize(offset + readSize);
+
+					size_t received = stream.read_some(asio::buffer(body.data() + offset, readSize), ec);
+					body.resize(offset + received);
+
+					if (ec == asio::error::eof)
+						return HTTPErr::None;
+					if (ec)
+						return to_http_err(ec, HTTPErr::ReceiveFailed);
+					if (body.size() > HTTP_MAX_BODY_SIZE)
+						return HTTPErr::MessageTooLarge;
+				}
+			}
+
+			std::istream responseStream(&responseBuffer);
+			std::string line;
+
+			while (true)
+			{
+				asio::read_until(stream, responseBuffer, "\r\n", ec);
+				if (ec)
+					return to_http_err(ec, HTTPErr::ReceiveFailed);
+
+				std::getline(responseStream, line);
+
+				size_t chunkSize = 0;
+				auto [end, errc] = std::from_chars(line.data(), line.data() + line.size(), chunkSize, 16);
+				if (errc != std::errc())
+					return HTTPErr::InvalidChunkSize;
+
+				if (chunkSize > HTTP_MAX_BODY_SIZE - body.size())
+				{
+					HTTP_LOG_WARN("Chunked body is over the {} byte limit.", HTTP_MAX_BODY_SIZE);
+					return HTTPErr::MessageTooLarge;
+				}
+
+				if (chunkSize == 0)
+				{
+					// Skip trailers up to the terminating empty line
+					do
+					{
+						asio::read_until(stream, responseBuffer, "\r\n", ec);
+						if (ec)
+							return to_http_err(ec, HTTPErr::ReceiveFailed);
+						std::getline(responseStream, line);
+					} while (line != "\r" && !line.empty());
+
+					return HTTPErr::None;
+				}
+
+				size_t buffered = take_buffered(chunkSize);
+				if (buffered < chunkSize)
+				{
+					HTTPErr err = read_exactly(chunkSize - buffered);
+					if (err != HTTPErr::None)
+						return err;
+				}
+
+				// The CRLF closing the chunk data
+				asio::read_until(stream, responseBuffer, "\r\n", ec);
+				if (ec)
+					return to_http_err(ec, HTTPErr::ReceiveFailed);
+				std::getline(responseStream, line);
+			}
+		}
+	}
+
+
+	std::expected<HTTPOutput, HTTPErr> read_http_head(HTTPStream& stream, asio::streambuf& responseBuffer, [[maybe_unused]] HTTPTiming* timing, bool anyStatus)
 	{
 		// Read the HTTP response
-		asio::streambuf responseBuffer;
 		asio::error_code ec;
-		std::size_t bytes = asio::read_until(socket, responseBuffer, "\r\n\r\n", ec);
 
-		if (ec == asio::error::eof)
+#ifdef HTTP_ENABLE_TIMING
+		if (timing && responseBuffer.size() == 0)
+		{
+			// Wait separately so the first byte is told apart from the rest of the head
+			stream.wait_read(ec);
+			HTTP_TIMING_MARK(timing, firstByte);
+		}
+#endif
+
+		while (true)
 		{
-			// EOF reached, but we might have data
-			if (bytes > 0)
+			[[maybe_unused]] std::size_t bytes = asio::read_until(stream, responseBuffer, "\r\n\r\n", ec);
+
+			HTTP_TIMING_MARK(timing, headersReceived);
+			HTTP_TIMING_ADD(timing, bytesReceived, bytes);
+
+			if (ec && responseBuffer.size() == 0 && to_http_err(ec, HTTPErr::ReceiveFailed) == HTTPErr::ConnectionClosed)
 			{
-				std::istream responseStream(&responseBuffer);
-				std::string response(bytes, '\0');
-				responseStream.read(&response[0], bytes);
-				DEBUG_LN
-					std::cout << "Partial response before EOF:\n" << response << std::endl;
+				// Nothing of the response arrived, typically a kept-alive connection the server had already timed out
+				HTTP_LOG_DEBUG("Connection closed with no data.");
+				return std::unexpected(HTTPErr::ClosedBeforeResponse);
 			}
-			else
+			else if (ec == asio::error::eof)
 			{
-				DEBUG_LN
-					std::cerr << "Connection closed with no data.\n";
-				return std::unexpected(HTTPErr::InvalidData);
+				HTTP_LOG_DEBUG("Partial response before EOF:\n{}", std::string_view(static_cast<const char*>(responseBuffer.data().data()), responseBuffer.size()));
+				return std::unexpected(HTTPErr::ConnectionClosed);
 			}
-		}
-		else if (ec)
-		{
-			std::cerr << "Read error: " << ec.message() << std::endl;
+			else if (ec)
+			{
+				HTTP_LOG_ERROR("Read error: {}:{}", ec.category().name(), ec.value());
+				return std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed));
+			}
+
+			// Interim answers come before the final one, e.g. a 100 Continue that arrives after the body was sent anyway
+			std::string_view head(static_cast<const char*>(responseBuffer.data().data()), bytes);
+			if (head.size() < 12 || !head.starts_with("HTTP/") || head[9] != '1' || head.substr(9, 3) == "101")
+				break;
+
+			responseBuffer.consume(bytes);
 		}
 
 
@@ -762,7 +1644,9 @@ namespace communicator
 		responseStream >> httpVersion >> statusCode;
 		std::getline(responseStream, statusMessage);
 
-		if (statusCode != 200)
+		if (!responseStream || statusCode == 0)
+			return std::unexpected(HTTPErr::InvalidStatusLine);
+		if (!anyStatus && statusCode != 200 && statusCode != 206 && statusCode != 304)
 			return std::unexpected(HTTPErr::ResponseError);
 		if (httpVersion != "HTTP/1.1" && httpVersion != "HTTP/2.0")
 			return std::unexpected(HTTPErr::HTTPVersionUndefined);
@@ -775,127 +1659,331 @@ namespace communicator
 		HTTPContentEncoding contentEncoding = HTTPContentEncoding::None;
 		HTTPConnection connection = HTTPConnection::Close;
 		HTTPLanguage language = HTTPLanguage::None;
+		std::string etag, lastModified, vary, cacheControl, contentRange;
+		bool hasConnection = false;
+		bool hasContentLength = false;
+
+		while (std::getline(responseStream, header) && header != "\r")
+		{
+
+			if (header.starts_with("Transfer-Encoding:"))
+			{
+				transferEncoding = static_cast<HTTPTransferEncoding>(to_uint32<HTTPTransferEncoding>(header.substr(19)));
+			}
+
+			if (header.starts_with("Content-Encoding:"))
+			{
+				contentEncoding = static_cast<HTTPContentEncoding>(to_uint32<HTTPContentEncoding>(header.substr(18)));
+			}
+
+			if (header.starts_with("Content-Type:"))
+			{				
+				contentType = static_cast<HTTPContent>(to_uint32<HTTPContent>(header.substr(14)));
+			}
+
+			if (header.starts_with("Content-Length:"))
+			{
+				std::string_view value = trim_header_value(std::string_view(header).substr(15));
+				auto [end, errc] = std::from_chars(value.data(), value.data() + value.size(), contentLength);
+				if (errc != std::errc() || end != value.data() + value.size())
+					return std::unexpected(HTTPErr::InvalidContentLength);
+				hasContentLength = true;
+			}
+
+			if (header.starts_with("Content-Language:"))
+			{
+				language = static_cast<HTTPLanguage>(to_uint32<HTTPLanguage>(header.substr(17)));
+			}
+
+			if (header.starts_with("Connection:"))
+			{
+				connection = static_cast<HTTPConnection>(to_uint32<HTTPConnection>((header.substr(12))));
+				hasConnection = true;
+			}
+
+			if (header.starts_with("ETag:"))
+			{
+				etag = trim_header_value(std::string_view(header).substr(5));
+			}
+
+			if (header.starts_with("Last-Modified:"))
+			{
+				lastModified = trim_header_value(std::string_view(header).substr(14));
+			}
+
+			if (header.starts_with("Vary:"))
+			{
+				vary = trim_header_value(std::string_view(header).substr(5));
+			}
+
+			if (header.starts_with("Cache-Control:"))
+			{
+				cacheControl = trim_header_value(std::string_view(header).substr(14));
+			}
+
+			if (header.starts_with("Content-Range:"))
+			{
+				contentRange = trim_header_value(std::string_view(header).substr(14));
+			}
+
+			if (header.empty())
+				break; 
+		}
+
+		// HTTP/1.1 connections stay open by default, unless the body is delimited by the server closing it
+		if (!hasConnection && httpVersion == "HTTP/1.1" && (hasContentLength || transferEncoding == HTTPTransferEncoding::Chunked || statusCode == 304))
+			connection = HTTPConnection::Persistent;
+
+		return HTTPOutput{
+			{},
+			contentType,
+			connection,
+			transferEncoding,
+			contentEncoding,
+			language,
+			contentLength,
+			statusCode,
+			statusMessage,
+			etag,
+			lastModified,
+			vary,
+			cacheControl,
+			contentRange,
+#ifdef HTTP_ENABLE_TIMING
+			HTTPTiming{},
+#endif
+		};
+	}
+
+	std::expected<HTTPOutput, HTTPErr> read_http_response(HTTPSocket& socket, HTTPTiming* timing)
+	{
+		HTTPStream stream(socket);
+		return read_http_response(stream, timing);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> read_http_response(HTTPStream& stream, HTTPTiming* timing)
+	{
+		asio::streambuf responseBuffer;
+		return read_http_response(stream, responseBuffer, timing);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> read_http_response(HTTPStream& stream, asio::streambuf& responseBuffer, HTTPTiming* timing, bool anyStatus)
+	{
+		auto headResult = read_http_head(stream, responseBuffer, timing, anyStatus);
+		if (!headResult.has_value())
+		{
+			return headResult;
+		}
+
+		HTTPErr err = read_http_body(stream, responseBuffer, *headResult, timing);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		HTTP_TIMING_ATTACH(headResult, timing);
+
+		return headResult;
+	}
+
+	HTTPErr read_http_body(HTTPStream& stream, asio::streambuf& responseBuffer, HTTPOutput& head, [[maybe_unused]] HTTPTiming* timing)
+	{
+		// Bodies go straight from the socket into the buffer the caller ends up owning
+		if (is_binary_data(head.contentType))
+		{
+			std::vector<uint8_t> body;
+
+			HTTPErr err = read_body(stream, responseBuffer, head, body);
+			if (err != HTTPErr::None)
+			{
+				return err;
+			}
+
+			HTTP_LOG_DEBUG("HTTP Response Body (Binary Data): Size = {} bytes.", body.size());
+			head.body = std::move(body);
+		}
+		else
+		{
+			std::string body;
+
+			HTTPErr err = read_body(stream, responseBuffer, head, body);
+			if (err != HTTPErr::None)
+			{
+				return err;
+			}
+
+			HTTP_LOG_DEBUG("HTTP Response Body:\n{}", body);
+			head.body = std::move(body);
+		}
+
+		size_t contentLength = std::visit([](const auto& body) { return body.size(); }, head.body);
+		head.contentLength = contentLength;
+
+		HTTP_TIMING_ADD(timing, bytesReceived, contentLength);
+		HTTP_TIMING_MARK(timing, completed);
+
+		return HTTPErr::None;
+	}
+
+	std::optional<size_t> buffered_head_size(std::string_view bytes)
+	{
+		size_t offset = 0;
+
+		while (true)
+		{
+			size_t end = bytes.find("\r\n\r\n", offset);
+			if (end == std::string_view::npos)
+				return std::nullopt;
+			end += 4;
+
+			// The same interim answers read_http_head skips
+			std::string_view head = bytes.substr(offset, end - offset);
+			if (head.size() < 12 || !head.starts_with("HTTP/") || head[9] != '1' || head.substr(9, 3) == "101")
+				return end;
+
+			offset = end;
+		}
+	}
 
-		while (std::getline(responseStream, header) && header != "\r")
+	std::optional<size_t> buffered_body_size(std::string_view bytes, const HTTPOutput& head)
+	{
+		if (head.statusCode == 204 || head.statusCode == 304 || head.statusCode < 200)
+			return 0;
+
+		if (head.transferEncoding != HTTPTransferEncoding::Chunked)
 		{
+			if (head.contentLength > 0)
+				return bytes.size() >= head.contentLength ? std::optional<size_t>(head.contentLength) : std::nullopt;
 
-			if (header.starts_with("Transfer-Encoding:"))
-			{
-				transferEncoding = static_cast<HTTPTransferEncoding>(to_uint32<HTTPTransferEncoding>(header.substr(19)));
-			}
+			// Without a length the body is empty on a kept-alive connection and runs until EOF otherwise
+			return head.connection != HTTPConnection::Close ? std::optional<size_t>(0) : std::nullopt;
+		}
 
-			if (header.starts_with("Content-Encoding:"))
-			{
-				contentEncoding = static_cast<HTTPContentEncoding>(to_uint32<HTTPContentEncoding>(header.substr(18)));
-			}
+		size_t offset = 0;
 
-			if (header.starts_with("Content-Type:"))
-			{				
-				contentType = static_cast<HTTPContent>(to_uint32<HTTPContent>(header.substr(14)));
-			}
+		while (true)
+		{
+			size_t lineEnd = bytes.find("\r\n", offset);
+			if (lineEnd == std::string_view::npos)
+				return std::nullopt;
 
-			if (header.starts_with("Content-Length:"))
+			size_t chunkSize = 0;
+			auto [end, errc] = std::from_chars(bytes.data() + offset, bytes.data() + lineEnd, chunkSize, 16);
+			if (errc != std::errc())
+				return lineEnd; // read_body rejects the line without reading further
+
+			offset = lineEnd + 2;
+
+			if (chunkSize == 0)
 			{
-				try
+				// Trailers up to the terminating empty line
+				while (true)
 				{
-					contentLength = std::stoul(header.substr(15));
+					lineEnd = bytes.find("\r\n", offset);
+					if (lineEnd == std::string_view::npos)
+						return std::nullopt;
+
+					bool last = lineEnd == offset;
+					offset = lineEnd + 2;
+					if (last)
+						return offset;
 				}
-				catch (...) 
-				{
-					return std::unexpected(HTTPErr::InvalidContentSize);
-				}
-			}
-
-			if (header.starts_with("Content-Language:"))
-			{
-				language = static_cast<HTTPLanguage>(to_uint32<HTTPLanguage>(header.substr(17)));
 			}
 
-			if (header.starts_with("Connection:"))
-			{
-				connection = static_cast<HTTPConnection>(to_uint32<HTTPConnection>((header.substr(12))));
-			}
+			if (bytes.size() - offset < chunkSize || bytes.size() - offset - chunkSize < 2)
+				return std::nullopt;
 
-			if (header.empty())
-				break; 
+			offset += chunkSize + 2;
 		}
+	}
 
-		
-		std::variant<std::string, std::vector<uint8_t>> body;
+	HTTPErr read_body_to_bytes(HTTPStream& stream, asio::streambuf& responseBuffer, const HTTPOutput& head, std::vector<uint8_t>& body)
+	{
+		return read_body(stream, responseBuffer, head, body);
+	}
 
-		if (transferEncoding == HTTPTransferEncoding::Chunked && contentLength == 0 && is_str_data(contentType))
-		{
-			std::ostringstream bodyStream;
-			while (true)
+	HTTPErr read_body_to_file(HTTPStream& stream, asio::streambuf& responseBuffer, const HTTPOutput& head, HTTPFileSink& sink)
+	{
+		auto drain_buffered = [&](uint64_t limit) -> std::expected<uint64_t, HTTPErr>
 			{
-				std::string chunkSizeStr;
-				std::getline(responseStream, chunkSizeStr);
+				uint64_t available = std::min<uint64_t>(responseBuffer.size(), limit);
+				if (available == 0)
+					return 0;
 
-				if (chunkSizeStr.empty())
-					continue;
+				const uint8_t* data = static_cast<const uint8_t*>(responseBuffer.data().data());
+				HTTPErr err = sink.write(std::span<const uint8_t>(data, static_cast<size_t>(available)));
+				if (err != HTTPErr::None)
+					return std::unexpected(err);
 
-				size_t chunkSize = std::stoul(chunkSizeStr, nullptr, 16);
+				responseBuffer.consume(static_cast<size_t>(available));
+				return available;
+			};
 
-				if (chunkSize == 0)
-					break;
+		if (head.transferEncoding != HTTPTransferEncoding::Chunked)
+		{
+			bool untilEof = head.contentLength == 0 && head.connection == HTTPConnection::Close;
+			uint64_t limit = untilEof ? UINT64_MAX : head.contentLength;
 
-				asio::read(socket, responseBuffer, asio::transfer_exactly(chunkSize));
-				bodyStream << &responseBuffer; 
+			auto buffered = drain_buffered(limit);
+			if (!buffered.has_value())
+				return buffered.error();
 
-				contentLength += chunkSize;
+			if (untilEof)
+				return sink.write_from_stream(stream, 0, true);
 
-				std::string crlf;
-				std::getline(responseStream, crlf);
-			}
-			DEBUG_LN
-				std::cout << "HTTP Response Body:\n" << bodyStream.str() << std::endl;
-			body = bodyStream.str();
+			if (limit > *buffered)
+				return sink.write_from_stream(stream, limit - *buffered);
+
+			return HTTPErr::None;
 		}
-		else if (contentLength > 0 && (contentType == HTTPContent::None || is_str_data(contentType)))
-		{
-			std::ostringstream bodyStream;
-			std::string bodyContent;
-			if (responseBuffer.size() > 0)
-				bodyStream << &responseBuffer;
 
-			size_t remaining = contentLength - bodyStream.str().size();
+		std::istream responseStream(&responseBuffer);
+		std::string line;
+		asio::error_code ec;
 
-			if (remaining > 0)
-				asio::read(socket, responseBuffer, asio::transfer_exactly(remaining));
+		while (true)
+		{
+			asio::read_until(stream, responseBuffer, "\r\n", ec);
+			if (ec)
+				return to_http_err(ec, HTTPErr::ReceiveFailed);
 
-			bodyStream << &responseBuffer;
+			std::getline(responseStream, line);
 
-			DEBUG_LN
-				std::cout << "HTTP Response Body:\n" << bodyStream.str() << std::endl;
-			body = bodyStream.str();
+			uint64_t chunkSize = 0;
+			auto [end, errc] = std::from_chars(line.data(), line.data() + line.size(), chunkSize, 16);
+			if (errc != std::errc())
+				return HTTPErr::InvalidChunkSize;
 
-		}
-		else if (is_binary_data(contentType) && responseBuffer.size() > 0)
-		{
-			
-			std::vector<uint8_t> binaryBody(
-				asio::buffers_begin(responseBuffer.data()),
-				asio::buffers_end(responseBuffer.data())
-			);
+			if (chunkSize == 0)
+			{
+				// Skip trailers up to the terminating empty line
+				do
+				{
+					asio::read_until(stream, responseBuffer, "\r\n", ec);
+					if (ec)
+						return to_http_err(ec, HTTPErr::ReceiveFailed);
+					std::getline(responseStream, line);
+				} while (line != "\r" && !line.empty());
 
-			DEBUG_LN
-				std::cout << "HTTP Response Body (Binary Data): Size = " << binaryBody.size() << " bytes." << std::endl;
+				return HTTPErr::None;
+			}
 
-			body = std::move(binaryBody);	
-		}
+			auto buffered = drain_buffered(chunkSize);
+			if (!buffered.has_value())
+				return buffered.error();
 
+			if (chunkSize > *buffered)
+			{
+				HTTPErr err = sink.write_from_stream(stream, chunkSize - *buffered);
+				if (err != HTTPErr::None)
+					return err;
+			}
 
-		return HTTPOutput{
-			body,
-			contentType,
-			connection,
-			transferEncoding,
-			contentEncoding,
-			language,
-			contentLength,
-			statusCode,
-			statusMessage
-		};
+			asio::read_until(stream, responseBuffer, "\r\n", ec);
+			if (ec)
+				return to_http_err(ec, HTTPErr::ReceiveFailed);
+			std::getline(responseStream, line);
+		}
 	}
 
 	void run_decrytion(std::string& body, HTTPContentEncoding algorithm)
@@ -920,7 +2008,7 @@ namespace communicator
 			// Implement Brotli decompression -- In Process
 			break;
 		default:
-			std::cerr << "Unsupported content encoding: " << static_cast<int>(algorithm) << std::endl;
+			HTTP_LOG_ERROR("Unsupported content encoding: {}", static_cast<int>(algorithm));
 			break;
 		}
 	}
@@ -946,7 +2034,7 @@ namespace communicator
 			// Implement Brotli decompression -- In Process
 			break;
 		default:
-			std::cerr << "Unsupported content encoding: " << static_cast<int>(algorithm) << std::endl;
+			HTTP_LOG_ERROR("Unsupported content encoding: {}", static_cast<int>(algorithm));
 			break;
 		}
 	}
@@ -955,59 +2043,220 @@ namespace communicator
 
 	// --- Socket Creation and Connection Methods ---
 
-	std::expected<asio::ip::tcp::socket, HTTPErr> create_and_connect_socket(
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_socket(
 		asio::io_context& ioContext,
 		std::string_view host,
 		std::string_view port,
-		size_t requestTimeout)		
+		size_t requestTimeout,
+		HTTPTiming* timing,
+		const HTTPSocketOptions& socketOptions)
 		// Remember to move the result into the socket variable
 	{
+		if (!socketOptions.unixSocketPath.empty())
+			return create_and_connect_local_socket(ioContext, socketOptions.unixSocketPath, requestTimeout, timing, socketOptions);
+
+		if (socketOptions.proxy.enabled())
+		{
+			const HTTPProxy& proxy = socketOptions.proxy;
+
+			HTTPSocketOptions proxyOptions = socketOptions;
+			proxyOptions.proxy = {};
+
+			auto socketResult = create_and_connect_socket(ioContext, proxy.host, proxy.port, requestTimeout, timing, proxyOptions);
+			if (!socketResult.has_value() || proxy.mode != HTTPProxyMode::Tunnel)
+				return socketResult;
+
+			HTTPErr err = open_proxy_tunnel(*socketResult, host, port, proxy);
+			if (err != HTTPErr::None)
+			{
+				asio::error_code ec;
+				socketResult->close(ec);
+				return std::unexpected(err);
+			}
+
+			return socketResult;
+		}
 
-		asio::steady_timer timer(ioContext);
-		bool connectStatus = false;
 		asio::ip::tcp::resolver resolver(ioContext);
 
 		asio::error_code ec;
-		asio::ip::tcp::resolver::results_type endpoint = resolver.resolve(host, port, ec);
+		asio::ip::tcp::resolver::results_type endpoints = resolver.resolve(host, port, ec);
 
 		if (ec)
 		{
-			std::cerr << "DNS resolution failed: " << ec.message() << std::endl;
+			HTTP_LOG_ERROR("DNS resolution failed: {}:{}", ec.category().name(), ec.value());
 			return std::unexpected(HTTPErr::DNSResolutionFailed);
 		}
 
-		asio::ip::tcp::socket socket(ioContext);
+		HTTP_TIMING_MARK(timing, resolved);
+
+		return create_and_connect_socket(ioContext, endpoints, requestTimeout, timing, socketOptions);
+	}
+
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_local_socket(
+		asio::io_context& ioContext,
+		std::string_view socketPath,
+		size_t requestTimeout,
+		[[maybe_unused]] HTTPTiming* timing,
+		const HTTPSocketOptions& socketOptions)
+	{
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+		// Checked here, asio would report an overlong path by throwing
+		if (socketPath.empty() || socketPath.size() >= sizeof(asio::detail::sockaddr_un_type::sun_path))
+		{
+			HTTP_LOG_ERROR("Invalid Unix socket path: {}", socketPath);
+			return std::unexpected(HTTPErr::InvalidURL);
+		}
+
+		asio::steady_timer timer(ioContext);
+		bool timedOut = false;
+		asio::error_code connectError;
+
+		asio::local::stream_protocol::socket local(ioContext);
+
+		local.open(asio::local::stream_protocol(), connectError);
+		if (connectError)
+		{
+			return std::unexpected(to_http_err(connectError, HTTPErr::ConnectionFailed));
+		}
+
+		// The TCP options have no meaning here, only the buffer sizes carry over
+		asio::error_code ignored;
+		if (socketOptions.sendBufferSize)
+			local.set_option(asio::socket_base::send_buffer_size(*socketOptions.sendBufferSize), ignored);
+		if (socketOptions.receiveBufferSize)
+			local.set_option(asio::socket_base::receive_buffer_size(*socketOptions.receiveBufferSize), ignored);
 
-		asio::async_connect(socket, endpoint,
-			[&connectStatus, &timer](const asio::error_code& ec, const asio::ip::tcp::endpoint& endpoint)
+		bool attempted = false;
+		local.async_connect(asio::local::stream_protocol::endpoint(std::string(socketPath)), [&connectError, &attempted, &timer](const asio::error_code& ec)
 			{
-				if (!ec)
+				connectError = ec;
+				attempted = true;
+				timer.cancel();
+			});
+
+		timer.expires_after(std::chrono::seconds(requestTimeout));
+
+		timer.async_wait([&timedOut, &attempted, &local](const asio::error_code& ec)
+			{
+				if (ec != asio::error::operation_aborted && !attempted)
 				{
-					connectStatus = true;
-					timer.cancel();
+					HTTP_LOG_ERROR("Connection timed out.");
+					timedOut = true;
+					asio::error_code closeError;
+					local.close(closeError);
 				}
-			}
-		);
+			});
+
+		ioContext.run();
+		ioContext.restart();
+
+		if (timedOut)
+		{
+			return std::unexpected(HTTPErr::ConnectionTimeout);
+		}
+
+		if (connectError)
+		{
+			HTTP_LOG_WARN("Failed to connect to Unix socket {}: {}:{}", socketPath, connectError.category().name(), connectError.value());
+			return std::unexpected(to_http_err(connectError, HTTPErr::ConnectionFailed));
+		}
+
+		HTTP_TIMING_MARK(timing, connected);
+
+		return HTTPSocket(std::move(local));
+#else
+		HTTP_LOG_ERROR("Unix domain sockets are not available on this platform.");
+		return std::unexpected(HTTPErr::LocalSocketUnsupported);
+#endif
+	}
+
+	std::expected<HTTPSocket, HTTPErr> create_and_connect_socket(
+		asio::io_context& ioContext,
+		const asio::ip::tcp::resolver::results_type& endpoints,
+		size_t requestTimeout,
+		[[maybe_unused]] HTTPTiming* timing,
+		const HTTPSocketOptions& socketOptions)
+	{
+		asio::steady_timer timer(ioContext);
+		bool timedOut = false;
+		asio::error_code connectError = asio::error::host_not_found;
+
+		HTTPSocket socket(ioContext);
 
 		timer.expires_after(std::chrono::seconds(requestTimeout));
 
-		timer.async_wait([&connectStatus, &socket](const asio::error_code& ec)
+		timer.async_wait([&timedOut, &socket](const asio::error_code& ec)
 			{
-				if (!connectStatus)
+				if (ec != asio::error::operation_aborted)
 				{
-					std::cerr << "Connection timed out." << std::endl;
-					socket.close();
+					HTTP_LOG_ERROR("Connection timed out.");
+					timedOut = true;
+					asio::error_code closeError;
+					socket.close(closeError);
 				}
 			});
 
+		// Each endpoint gets a socket opened here rather than by async_connect, so the options are in place before the SYN
+		for (const auto& entry : endpoints)
+		{
+			asio::error_code closeError;
+			socket.close(closeError);
+
+			socket.open(entry.endpoint().protocol(), connectError);
+			if (connectError)
+				continue;
+
+			apply_socket_options(socket, socketOptions);
+
+			bool attempted = false;
+			socket.async_connect(entry.endpoint(), [&connectError, &attempted](const asio::error_code& ec)
+				{
+					connectError = ec;
+					attempted = true;
+				});
+
+			while (!attempted)
+				ioContext.run_one();
+
+			if (!connectError || timedOut)
+				break;
+		}
+
+		timer.cancel();
 		ioContext.run();
+		ioContext.restart();
+
+		if (timedOut)
+		{
+			return std::unexpected(HTTPErr::ConnectionTimeout);
+		}
 
-		if (!connectStatus)
+		if (connectError)
 		{
-			return std::unexpected(HTTPErr::ConnectionFailed);
+			return std::unexpected(to_http_err(connectError, HTTPErr::ConnectionFailed));
 		}
 
-		return std::move(socket);
+		HTTP_TIMING_MARK(timing, connected);
+
+		return socket;
+	}
+
+
+
+	HTTPSocketOptions socket_options_for(const HTTPURLView& url)
+	{
+		HTTPSocketOptions options;
+
+		if (!url.socketPath.empty())
+			percent_decode(url.socketPath, options.unixSocketPath);
+
+		return options;
+	}
+
+	bool expects_continue(const HTTPSocketOptions& options, uint64_t contentLength)
+	{
+		return options.expectContinueThreshold > 0 && contentLength >= options.expectContinueThreshold;
 	}
 
 
@@ -1018,7 +2267,7 @@ namespace communicator
 	{
 		if (request.empty())
 		{
-			std::cerr << "HTTP request is empty." << std::endl;
+			HTTP_LOG_ERROR("HTTP request is empty.");
 			return HTTPErr::EmptyRequest;
 		}
 
@@ -1059,6 +2308,113 @@ namespace communicator
 		return HTTPErr::None;
 	}
 
+	HTTPErr to_http_err(const asio::error_code& ec, HTTPErr fallback)
+	{
+		if (!ec)
+			return HTTPErr::None;
+
+		if (ec == asio::error::eof || ec == asio::error::connection_reset || ec == asio::error::broken_pipe || ec == asio::error::connection_aborted)
+			return HTTPErr::ConnectionClosed;
+
+		if (ec == asio::error::timed_out)
+			return HTTPErr::RequestTimeout;
+
+		if (ec == asio::error::connection_refused || ec == asio::error::network_unreachable || ec == asio::error::host_unreachable)
+			return HTTPErr::ConnectionFailed;
+
+		if (ec == asio::error::host_not_found || ec == asio::error::host_not_found_try_again)
+			return HTTPErr::DNSResolutionFailed;
+
+		return fallback;
+	}
+
+	bool is_connection_alive(HTTPSocket& socket)
+	{
+		if (!socket.is_open())
+			return false;
+
+#if defined(__linux__)
+		// POLLRDHUP also reports a server that has only shut down its sending side
+		pollfd fd{ socket.native_handle(), POLLIN | POLLRDHUP, 0 };
+		int ready = ::poll(&fd, 1, 0);
+
+		// Nothing is owed on an idle connection, so anything readable is a close, a reset or bytes that would corrupt the next response
+		return ready == 0;
+#else
+		bool nonBlocking = socket.non_blocking();
+
+		asio::error_code ec;
+		socket.non_blocking(true, ec);
+		if (ec)
+			return false;
+
+		char byte = 0;
+		socket.receive(asio::buffer(&byte, 1), asio::socket_base::message_peek, ec);
+
+		asio::error_code ignored;
+		socket.non_blocking(nonBlocking, ignored);
+
+		return ec == asio::error::would_block;
+#endif
+	}
+
+	std::expected<bool, HTTPErr> await_continue(HTTPStream& stream, asio::streambuf& responseBuffer, std::chrono::milliseconds timeout)
+	{
+		// One deadline for the whole wait, interim answers such as 103 Early Hints do not extend it
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		while (true)
+		{
+			std::string_view buffered(static_cast<const char*>(responseBuffer.data().data()), responseBuffer.size());
+			size_t headEnd = buffered.find("\r\n\r\n");
+
+			if (headEnd == std::string_view::npos)
+			{
+				// Read through the stream, with io_uring the armed receive takes the bytes before the socket would report them
+				asio::error_code ec;
+				stream.wait_read(ec, deadline);
+				if (ec == asio::error::timed_out)
+				{
+					HTTP_LOG_DEBUG("No answer to Expect: 100-continue within {}ms, sending the body.", timeout.count());
+					return true;
+				}
+
+				if (!ec)
+				{
+					size_t received = stream.read_some(responseBuffer.prepare(4096), ec);
+					responseBuffer.commit(received);
+				}
+
+				if (ec)
+				{
+					HTTP_LOG_WARN("Error waiting for 100 Continue: {}:{}", ec.category().name(), ec.value());
+					return std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed));
+				}
+				continue;
+			}
+
+			std::string_view statusLine = buffered.substr(0, buffered.find("\r\n"));
+
+			// "HTTP/1.1 1xx", anything else is the final answer
+			if (statusLine.size() < 12 || statusLine[9] != '1')
+			{
+				HTTP_LOG_INFO("Answered before the body was sent: {}", statusLine);
+				return false;
+			}
+
+			bool proceed = statusLine.substr(9, 3) == "100";
+			responseBuffer.consume(headEnd + 4);
+
+			if (proceed)
+				return true;
+		}
+	}
+
+	bool is_idempotent(HTTPMethod method)
+	{
+		return method != HTTPMethod::POST && method != HTTPMethod::PATCH;
+	}
+
 	std::string istream_to_string(std::istream& stream)
 	{
 		std::streampos currentPos = stream.tellg();
@@ -1086,6 +2442,50 @@ namespace communicator
 		return content;
 	}
 
+	std::string_view trim_header_value(std::string_view value)
+	{
+		constexpr std::string_view whitespace = " \t\r\n";
+
+		size_t start = value.find_first_not_of(whitespace);
+		if (start == std::string_view::npos)
+			return {};
+
+		size_t end = value.find_last_not_of(whitespace);
+		return value.substr(start, end - start + 1);
+	}
+
+	bool has_header(const std::unordered_map<std::string, std::string>& headers, std::string_view name)
+	{
+		for (const auto& header : headers)
+		{
+			if (header.first.size() == name.size() &&
+				std::equal(name.begin(), name.end(), header.first.begin(), [](char a, char b)
+					{
+						return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+					}))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::expected<HTTPJSONValue, HTTPErr> json_view(const HTTPOutput& output)
+	{
+		std::string_view body = std::visit([](const auto& data)
+			{
+				return std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+			}, output.body);
+
+		HTTPJSONValue root(body);
+		if (root.type() == HTTPJSONType::Invalid)
+		{
+			return std::unexpected(HTTPErr::InvalidJSON);
+		}
+
+		return root;
+	}
+
 	bool is_str_data(HTTPContent content)
 	{
 		return content == HTTPContent::TextPlain ||
@@ -1094,7 +2494,8 @@ namespace communicator
 			content == HTTPContent::ApplicationXML ||
 			content == HTTPContent::ApplicationFormUrlEncoded ||
 			content == HTTPContent::ApplicationJavaScript ||
-			content == HTTPContent::TextCSS;
+			content == HTTPContent::TextCSS ||
+			content == HTTPContent::TextEventStream;
 	}
 
 	bool is_binary_data(HTTPContent content)
@@ -1114,7 +2515,7 @@ namespace communicator
 		const std::vector<uint8_t>& body,
 		const std::unordered_map<std::string, std::string>& headers,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket)
 	{
 		return send_http_request(content, host, path, port, body, headers, connection, socket);
 	}
@@ -1126,57 +2527,86 @@ namespace communicator
 		const std::vector<uint8_t>& body,
 		const std::unordered_map<std::string, std::string>& headers,
 		HTTPConnection connection,
-		asio::ip::tcp::socket* socket)
+		HTTPSocket* socket)
 	{
-		auto outputResult = decrypt_url_http(url);
+		auto outputResult = parse_http_url(url);
 		if (!outputResult.has_value())
 		{
 			return std::unexpected(outputResult.error());
 		}
-		return send_http_request(content, outputResult->host, outputResult->path, outputResult->port, body, headers, connection, socket);
+		return send_http_request(content, outputResult->host, outputResult->target, outputResult->port, body, headers, connection, socket, nullptr, socket_options_for(*outputResult));
 	}
 
 
-	std::expected<URLDescriptorOutput, HTTPErr> decrypt_url_http(std::string_view url)
+	std::expected<HTTPOutput, HTTPErr> post_multipart(
+		std::string_view url,
+		const HTTPMultipartBody& body,
+		const std::unordered_map<std::string, std::string>& headers,
+		HTTPConnection connection,
+		HTTPSocket* socket)
 	{
-		std::string_view host;
-		std::string path, port = "80";
-		size_t pos = url.find("http://");
-
-		if (pos == std::string::npos)
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
 		{
-			return std::unexpected(HTTPErr::InvalidURL);
+			return std::unexpected(outputResult.error());
 		}
+		return send_multipart_request(HTTPMethod::POST, outputResult->host, outputResult->target, outputResult->port, body, headers, connection, socket, nullptr, socket_options_for(*outputResult));
+	}
 
-		pos += 7;
-
-		size_t slashPos = url.find('/', pos);
-		if (slashPos != std::string::npos)
+	std::expected<HTTPOutput, HTTPErr> post_file(
+		std::string_view url,
+		HTTPContent content,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& headers,
+		HTTPConnection connection,
+		HTTPSocket* socket)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
 		{
-			host = url.substr(pos, slashPos - pos);
-			path = url.substr(slashPos);
+			return std::unexpected(outputResult.error());
 		}
-		else
+		return send_file_request(HTTPMethod::POST, content, outputResult->host, outputResult->target, outputResult->port, file, headers, connection, socket, nullptr, socket_options_for(*outputResult));
+	}
+
+	std::expected<HTTPOutput, HTTPErr> put_file(
+		std::string_view url,
+		HTTPContent content,
+		const std::filesystem::path& file,
+		const std::unordered_map<std::string, std::string>& headers,
+		HTTPConnection connection,
+		HTTPSocket* socket)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
 		{
-			host = url.substr(pos);
-			path = "/";
+			return std::unexpected(outputResult.error());
 		}
+		return send_file_request(HTTPMethod::PUT, content, outputResult->host, outputResult->target, outputResult->port, file, headers, connection, socket, nullptr, socket_options_for(*outputResult));
+	}
 
-		if (host.empty())
+
+	std::expected<URLDescriptorOutput, HTTPErr> decrypt_url_http(std::string_view url)
+	{
+		auto parsed = parse_http_url(url);
+		if (!parsed.has_value())
 		{
-			return std::unexpected(HTTPErr::InvalidURL);
+			return std::unexpected(parsed.error());
 		}
 
-		std::string hostStr(host);
+		std::string path;
+		if (parsed->target.empty() || parsed->target.front() != '/')
+			path = "/";
+		path.append(parsed->target);
 
-		size_t colonPos = host.find(':');
+		URLDescriptorOutput output{ std::string(parsed->host), std::move(path), std::string(parsed->port), std::string() };
 
-		if (colonPos != std::string::npos)
+		if (!parsed->socketPath.empty() && percent_decode(parsed->socketPath, output.socketPath) != HTTPErr::None)
 		{
-			hostStr = host.substr(0, colonPos);
-			port = host.substr(colonPos + 1);
+			return std::unexpected(HTTPErr::InvalidURL);
 		}
-		return URLDescriptorOutput{ hostStr, path, port };
+
+		return output;
 	}
 
 
@@ -1233,16 +2663,4 @@ namespace communicator
 		}
 		return {};
 	}
-
-	//void HTTPCommunicator::set_proxy(std::string_view proxyHost, uint16_t proxyPort)
-	//{
-	//	_proxyHost = std::string(proxyHost);
-	//	_proxyPort = proxyPort;
-	//	if (_proxyHost.empty() || _proxyPort == 0)
-	//	{
-	//		std::cerr << "Invalid proxy settings." << std::endl;
-	//		return;
-	//	}
-	//	std::cout << "Proxy set to: " << _proxyHost << ":" << _proxyPort << std::endl;
-	//}
 }
\ No newline at end of file
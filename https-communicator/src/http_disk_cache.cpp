@@ -0,0 +1,631 @@
+#include "headers.h"
+#include "http_disk_cache.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr uint32_t CACHE_RECORD_MAGIC = 0x31524348; // "HCR1"
+		constexpr uint64_t CACHE_INITIAL_CAPACITY = 1ull << 20;
+		constexpr uint32_t CACHE_MAX_FIELD_SIZE = 1u << 20;
+
+		struct CacheRecordHeader
+		{
+			uint32_t magic;
+			uint32_t urlSize;
+			uint32_t keySize; // The key starts with the URL
+			uint32_t varySize;
+			uint32_t etagSize;
+			uint32_t lastModifiedSize;
+			uint32_t contentType;
+			uint32_t contentEncoding;
+			uint32_t statusCode;
+			uint32_t headerChecksum;
+			uint64_t bodySize;
+			int64_t storedAt;
+		};
+
+		uint64_t align8(uint64_t value)
+		{
+			return (value + 7) & ~uint64_t(7);
+		}
+
+		uint64_t fnv1a(std::string_view data)
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (unsigned char c : data)
+			{
+				hash ^= c;
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+
+		uint32_t header_checksum(CacheRecordHeader header)
+		{
+			header.headerChecksum = 0;
+			uint64_t hash = fnv1a(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+			return static_cast<uint32_t>(hash ^ (hash >> 32));
+		}
+
+		uint64_t fields_size(const CacheRecordHeader& header)
+		{
+			return uint64_t(header.keySize) + header.varySize + header.etagSize + header.lastModifiedSize;
+		}
+
+		uint64_t record_size(const CacheRecordHeader& header)
+		{
+			return align8(sizeof(CacheRecordHeader) + fields_size(header)) + align8(header.bodySize);
+		}
+
+		std::string normalize_vary(std::string_view vary)
+		// Lowercases and trims the Vary header names, one per line
+		{
+			std::string names;
+			size_t start = 0;
+			while (start <= vary.size())
+			{
+				size_t end = vary.find(',', start);
+				if (end == std::string_view::npos)
+					end = vary.size();
+
+				std::string_view name = trim_header_value(vary.substr(start, end - start));
+				if (!name.empty())
+				{
+					for (char c : name)
+						names.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+					names.push_back('\n');
+				}
+
+				start = end + 1;
+			}
+			return names;
+		}
+
+		bool same_record(const uint8_t* record, std::span<const uint8_t> head, std::span<const uint8_t> body)
+		// Everything but the time it was stored
+		{
+			CacheRecordHeader stored;
+			CacheRecordHeader fresh;
+			std::memcpy(&stored, record, sizeof(stored));
+			std::memcpy(&fresh, head.data(), sizeof(fresh));
+
+			stored.storedAt = fresh.storedAt;
+			stored.headerChecksum = fresh.headerChecksum;
+			if (std::memcmp(&stored, &fresh, sizeof(fresh)) != 0)
+				return false;
+
+			return std::equal(head.begin() + sizeof(CacheRecordHeader), head.end(), record + sizeof(CacheRecordHeader)) &&
+				std::equal(body.begin(), body.end(), record + head.size());
+		}
+
+		bool iequals(std::string_view a, std::string_view b)
+		{
+			return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y)
+				{
+					return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+				});
+		}
+	}
+
+
+	HTTPDiskCache::HTTPDiskCache(const std::filesystem::path& directory, uint64_t maxSize)
+	{
+		open(directory, maxSize);
+	}
+
+	HTTPErr HTTPDiskCache::open(const std::filesystem::path& directory, uint64_t maxSize)
+	{
+		close();
+
+		std::error_code fsError;
+		std::filesystem::create_directories(directory, fsError);
+		if (fsError)
+		{
+			HTTP_LOG_WARN("Failed to create cache directory: {}:{}", fsError.category().name(), fsError.value());
+			return HTTPErr::CacheUnavailable;
+		}
+
+		_filePath = directory / "responses.cache";
+		_maxSize = maxSize;
+
+		HTTPErr err = open_file();
+		if (err == HTTPErr::None)
+			err = compact();
+
+		if (err != HTTPErr::None)
+		{
+			close();
+			return err;
+		}
+
+		HTTP_LOG_DEBUG("Disk cache opened with {} entries ({} bytes).", _index.size(), _logicalSize);
+
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPDiskCache::open_file()
+	{
+		uint64_t fileSize = 0;
+
+#ifdef PLATFORM_WINDOWS
+		HANDLE file = CreateFileW(_filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return HTTPErr::CacheUnavailable;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return HTTPErr::CacheUnavailable;
+		}
+
+		_fileHandle = reinterpret_cast<intptr_t>(file);
+		fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+		int fd = ::open(_filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return HTTPErr::CacheUnavailable;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			return HTTPErr::CacheUnavailable;
+		}
+
+		_fileHandle = fd;
+		fileSize = static_cast<uint64_t>(st.st_size);
+#endif
+
+		_capacity = fileSize;
+
+		HTTPErr err = ensure_capacity(std::max<uint64_t>(fileSize, CACHE_INITIAL_CAPACITY));
+		if (err != HTTPErr::None)
+			return err;
+
+		return scan_records();
+	}
+
+	HTTPErr HTTPDiskCache::compact()
+	// Copies the records still indexed, oldest first, into a new file that then replaces the cache file
+	{
+		std::vector<uint64_t> offsets;
+		offsets.reserve(_index.size());
+		for (const auto& entry : _index)
+			offsets.push_back(entry.second);
+		std::sort(offsets.begin(), offsets.end());
+
+		// The newest records that fit in the size limit are kept
+		size_t first = offsets.size();
+		uint64_t liveSize = 0;
+		while (first > 0)
+		{
+			CacheRecordHeader header;
+			std::memcpy(&header, record_at(offsets[first - 1]), sizeof(header));
+
+			if (liveSize + record_size(header) > _maxSize)
+				break;
+
+			liveSize += record_size(header);
+			--first;
+		}
+
+		if (liveSize == _logicalSize)
+			return HTTPErr::None;
+
+		std::filesystem::path compactPath = _filePath;
+		compactPath += ".compact";
+
+		{
+			std::ofstream out(compactPath, std::ios::binary | std::ios::trunc);
+			for (size_t i = first; i < offsets.size(); ++i)
+			{
+				CacheRecordHeader header;
+				std::memcpy(&header, record_at(offsets[i]), sizeof(header));
+				out.write(reinterpret_cast<const char*>(record_at(offsets[i])), static_cast<std::streamsize>(record_size(header)));
+			}
+
+			out.flush();
+			if (!out)
+			{
+				HTTP_LOG_WARN("Failed to compact disk cache, keeping it as it is.");
+				out.close();
+
+				std::error_code fsError;
+				std::filesystem::remove(compactPath, fsError);
+				return HTTPErr::None;
+			}
+		}
+
+		HTTP_LOG_DEBUG("Compacting disk cache from {} to {} bytes.", _logicalSize, liveSize);
+
+		close();
+
+		std::error_code fsError;
+		std::filesystem::rename(compactPath, _filePath, fsError);
+		if (fsError)
+		{
+			HTTP_LOG_WARN("Failed to replace disk cache file: {}:{}", fsError.category().name(), fsError.value());
+			std::filesystem::remove(compactPath, fsError);
+		}
+
+		return open_file();
+	}
+
+	void HTTPDiskCache::close()
+	{
+		if (!is_open())
+			return;
+
+		release_regions();
+
+#ifdef PLATFORM_WINDOWS
+		HANDLE file = reinterpret_cast<HANDLE>(_fileHandle);
+
+		// Drop the preallocated tail so the file only holds complete records
+		LARGE_INTEGER end;
+		end.QuadPart = static_cast<LONGLONG>(_logicalSize);
+		if (SetFilePointerEx(file, end, nullptr, FILE_BEGIN))
+			SetEndOfFile(file);
+
+		CloseHandle(file);
+#else
+		if (ftruncate(static_cast<int>(_fileHandle), static_cast<off_t>(_logicalSize)) != 0)
+		{
+			HTTP_LOG_WARN("Failed to trim disk cache file.");
+		}
+
+		::close(static_cast<int>(_fileHandle));
+#endif
+
+		_fileHandle = -1;
+		_logicalSize = 0;
+		_capacity = 0;
+		_index.clear();
+		_urlIndex.clear();
+	}
+
+	bool HTTPDiskCache::is_open() const
+	{
+		return _fileHandle != -1;
+	}
+
+	std::expected<HTTPCachedResponse, HTTPErr> HTTPDiskCache::lookup(std::string_view url, const std::unordered_map<std::string, std::string>& requestHeaders)
+	{
+		if (!is_open())
+			return std::unexpected(HTTPErr::CacheUnavailable);
+
+		auto urlIt = _urlIndex.find(fnv1a(url));
+		if (urlIt == _urlIndex.end())
+			return std::unexpected(HTTPErr::CacheMiss);
+
+		const uint8_t* newest = record_at(urlIt->second);
+		CacheRecordHeader newestHeader;
+		std::memcpy(&newestHeader, newest, sizeof(newestHeader));
+
+		const char* newestFields = reinterpret_cast<const char*>(newest + sizeof(CacheRecordHeader));
+		if (std::string_view(newestFields, newestHeader.urlSize) != url)
+			return std::unexpected(HTTPErr::CacheMiss);
+
+		std::string_view varyNames(newestFields + newestHeader.keySize, newestHeader.varySize);
+		std::string key = build_key(url, varyNames, requestHeaders);
+
+		auto it = _index.find(fnv1a(key));
+		if (it == _index.end())
+			return std::unexpected(HTTPErr::CacheMiss);
+
+		const uint8_t* record = record_at(it->second);
+		CacheRecordHeader header;
+		std::memcpy(&header, record, sizeof(header));
+
+		if (std::string_view(reinterpret_cast<const char*>(record + sizeof(CacheRecordHeader)), header.keySize) != key)
+			return std::unexpected(HTTPErr::CacheMiss);
+
+		return make_response(it->second);
+	}
+
+	std::expected<HTTPCachedResponse, HTTPErr> HTTPDiskCache::store(std::string_view url, const std::unordered_map<std::string, std::string>& requestHeaders, const HTTPOutput& output)
+	{
+		if (!is_open())
+			return std::unexpected(HTTPErr::CacheUnavailable);
+
+		if (output.cacheControl.find("no-store") != std::string::npos || output.vary.find('*') != std::string::npos)
+			return std::unexpected(HTTPErr::NotCacheable);
+
+		std::span<const uint8_t> body;
+		if (const auto* text = std::get_if<std::string>(&output.body))
+			body = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text->data()), text->size());
+		else
+			body = std::get<std::vector<uint8_t>>(output.body);
+
+		std::string varyNames = normalize_vary(output.vary);
+		std::string key = build_key(url, varyNames, requestHeaders);
+
+		if (key.size() > CACHE_MAX_FIELD_SIZE || output.etag.size() > CACHE_MAX_FIELD_SIZE || output.lastModified.size() > CACHE_MAX_FIELD_SIZE)
+			return std::unexpected(HTTPErr::NotCacheable);
+
+		CacheRecordHeader header{};
+		header.magic = CACHE_RECORD_MAGIC;
+		header.urlSize = static_cast<uint32_t>(url.size());
+		header.keySize = static_cast<uint32_t>(key.size());
+		header.varySize = static_cast<uint32_t>(varyNames.size());
+		header.etagSize = static_cast<uint32_t>(output.etag.size());
+		header.lastModifiedSize = static_cast<uint32_t>(output.lastModified.size());
+		header.contentType = static_cast<uint32_t>(output.contentType);
+		header.contentEncoding = static_cast<uint32_t>(output.contentEncoding);
+		header.statusCode = output.statusCode;
+		header.bodySize = body.size();
+		header.storedAt = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		header.headerChecksum = header_checksum(header);
+
+		// Header and small fields go out in one write, the body in a second one straight from the response
+		std::vector<uint8_t> head(align8(sizeof(CacheRecordHeader) + fields_size(header)), 0);
+		uint8_t* cursor = head.data();
+
+		std::memcpy(cursor, &header, sizeof(header));
+		cursor += sizeof(header);
+		for (std::string_view field : { std::string_view(key), std::string_view(varyNames), std::string_view(output.etag), std::string_view(output.lastModified) })
+		{
+			std::memcpy(cursor, field.data(), field.size());
+			cursor += field.size();
+		}
+
+		// A repeated 200, as a server without validators sends on every request, is not appended again
+		auto existing = _index.find(fnv1a(key));
+		if (existing != _index.end() && same_record(record_at(existing->second), head, body))
+		{
+			_urlIndex[fnv1a(url)] = existing->second;
+			return make_response(existing->second);
+		}
+
+		uint64_t offset = _logicalSize;
+		uint64_t end = offset + record_size(header);
+
+		if (end > _maxSize)
+		{
+			HTTP_LOG_DEBUG("Disk cache full, not storing: {}", url);
+			return std::unexpected(HTTPErr::CacheFull);
+		}
+
+		HTTPErr err = ensure_capacity(end);
+		if (err != HTTPErr::None)
+			return std::unexpected(err);
+
+		err = write_at(offset + head.size(), body);
+		if (err != HTTPErr::None)
+			return std::unexpected(err);
+
+		// The header is written last so a torn write never leaves a record that looks complete
+		err = write_at(offset, head);
+		if (err != HTTPErr::None)
+			return std::unexpected(err);
+
+		_logicalSize = end;
+		_index[fnv1a(key)] = offset;
+		_urlIndex[fnv1a(url)] = offset;
+
+		return make_response(offset);
+	}
+
+	size_t HTTPDiskCache::entry_count() const
+	{
+		return _index.size();
+	}
+
+	HTTPDiskCache::~HTTPDiskCache()
+	{
+		close();
+	}
+
+	HTTPErr HTTPDiskCache::scan_records()
+	{
+		const MappedRegion& region = _regions.back();
+		uint64_t offset = 0;
+
+		while (offset + sizeof(CacheRecordHeader) <= region.size)
+		{
+			CacheRecordHeader header;
+			std::memcpy(&header, region.data + offset, sizeof(header));
+
+			if (header.magic != CACHE_RECORD_MAGIC || header.headerChecksum != header_checksum(header))
+				break;
+
+			if (header.urlSize > header.keySize || header.keySize > CACHE_MAX_FIELD_SIZE ||
+				header.varySize > CACHE_MAX_FIELD_SIZE || header.etagSize > CACHE_MAX_FIELD_SIZE ||
+				header.lastModifiedSize > CACHE_MAX_FIELD_SIZE || header.bodySize > region.size)
+				break;
+
+			uint64_t size = record_size(header);
+			if (offset + size > region.size)
+				break;
+
+			const char* fields = reinterpret_cast<const char*>(region.data + offset + sizeof(CacheRecordHeader));
+			_index[fnv1a(std::string_view(fields, header.keySize))] = offset;
+			_urlIndex[fnv1a(std::string_view(fields, header.urlSize))] = offset;
+
+			offset += size;
+		}
+
+		_logicalSize = offset;
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPDiskCache::ensure_capacity(uint64_t size)
+	{
+		if (size <= _capacity && !_regions.empty())
+			return HTTPErr::None;
+
+		uint64_t capacity = std::max<uint64_t>(_capacity, CACHE_INITIAL_CAPACITY);
+		while (capacity < size)
+			capacity *= 2;
+
+		if (capacity != _capacity)
+		{
+#ifdef PLATFORM_WINDOWS
+			HANDLE file = reinterpret_cast<HANDLE>(_fileHandle);
+			LARGE_INTEGER end;
+			end.QuadPart = static_cast<LONGLONG>(capacity);
+			if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+				return HTTPErr::CacheUnavailable;
+#else
+			if (ftruncate(static_cast<int>(_fileHandle), static_cast<off_t>(capacity)) != 0)
+				return HTTPErr::CacheUnavailable;
+#endif
+			_capacity = capacity;
+		}
+
+		return map_file();
+	}
+
+	HTTPErr HTTPDiskCache::map_file()
+	{
+		MappedRegion region;
+		region.size = static_cast<size_t>(_capacity);
+
+#ifdef PLATFORM_WINDOWS
+		HANDLE mapping = CreateFileMappingW(reinterpret_cast<HANDLE>(_fileHandle), nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+			return HTTPErr::CacheUnavailable;
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, region.size);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			return HTTPErr::CacheUnavailable;
+		}
+
+		region.data = static_cast<const uint8_t*>(view);
+		region.mappingHandle = mapping;
+#else
+		void* view = mmap(nullptr, region.size, PROT_READ, MAP_SHARED, static_cast<int>(_fileHandle), 0);
+		if (view == MAP_FAILED)
+			return HTTPErr::CacheUnavailable;
+
+		region.data = static_cast<const uint8_t*>(view);
+#endif
+
+		_regions.push_back(region);
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPDiskCache::write_at(uint64_t offset, std::span<const uint8_t> data)
+	{
+		while (!data.empty())
+		{
+#ifdef PLATFORM_WINDOWS
+			OVERLAPPED overlapped{};
+			overlapped.Offset = static_cast<DWORD>(offset);
+			overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD toWrite = static_cast<DWORD>(std::min<size_t>(data.size(), 1u << 30));
+			DWORD written = 0;
+			if (!WriteFile(reinterpret_cast<HANDLE>(_fileHandle), data.data(), toWrite, &written, &overlapped))
+				return HTTPErr::CacheUnavailable;
+#else
+			ssize_t written = pwrite(static_cast<int>(_fileHandle), data.data(), data.size(), static_cast<off_t>(offset));
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return HTTPErr::CacheUnavailable;
+			}
+#endif
+			data = data.subspan(static_cast<size_t>(written));
+			offset += static_cast<uint64_t>(written);
+		}
+
+		return HTTPErr::None;
+	}
+
+	const uint8_t* HTTPDiskCache::record_at(uint64_t offset) const
+	{
+		return _regions.back().data + offset;
+	}
+
+	HTTPCachedResponse HTTPDiskCache::make_response(uint64_t offset) const
+	{
+		const uint8_t* record = record_at(offset);
+
+		CacheRecordHeader header;
+		std::memcpy(&header, record, sizeof(header));
+
+		const char* fields = reinterpret_cast<const char*>(record + sizeof(CacheRecordHeader));
+		const char* etag = fields + header.keySize + header.varySize;
+		const char* lastModified = etag + header.etagSize;
+
+		const uint8_t* body = record + align8(sizeof(CacheRecordHeader) + fields_size(header));
+
+		return HTTPCachedResponse{
+			std::span<const uint8_t>(body, static_cast<size_t>(header.bodySize)),
+			static_cast<HTTPContent>(header.contentType),
+			static_cast<HTTPContentEncoding>(header.contentEncoding),
+			header.statusCode,
+			std::string_view(etag, header.etagSize),
+			std::string_view(lastModified, header.lastModifiedSize),
+			header.storedAt,
+			nullptr
+		};
+	}
+
+	std::string HTTPDiskCache::build_key(std::string_view url, std::string_view varyNames, const std::unordered_map<std::string, std::string>& requestHeaders) const
+	// The key is the URL followed by "name=value" for every request header the response varies on
+	{
+		std::string key(url);
+
+		size_t start = 0;
+		while (start < varyNames.size())
+		{
+			size_t end = varyNames.find('\n', start);
+			if (end == std::string_view::npos)
+				end = varyNames.size();
+
+			std::string_view name = varyNames.substr(start, end - start);
+
+			key.push_back('\n');
+			key.append(name);
+			key.push_back('=');
+
+			for (const auto& header : requestHeaders)
+			{
+				if (iequals(header.first, name))
+				{
+					key.append(header.second);
+					break;
+				}
+			}
+
+			start = end + 1;
+		}
+
+		return key;
+	}
+
+	void HTTPDiskCache::release_regions()
+	{
+		for (auto& region : _regions)
+		{
+#ifdef PLATFORM_WINDOWS
+			UnmapViewOfFile(region.data);
+			CloseHandle(static_cast<HANDLE>(region.mappingHandle));
+#else
+			munmap(const_cast<uint8_t*>(region.data), region.size);
+#endif
+		}
+		_regions.clear();
+	}
+
+}
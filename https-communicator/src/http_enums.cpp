@@ -43,6 +43,9 @@ namespace communicator
 		case HTTPContent::ImagePNG: return "image/png";
 		case HTTPContent::ImageJPEG: return "image/jpeg";
 		case HTTPContent::ImageGIF: return "image/gif";
+		case HTTPContent::ApplicationOctetStream: return "application/octet-stream";
+		case HTTPContent::MultipartFormData: return "multipart/form-data";
+		case HTTPContent::TextEventStream: return "text/event-stream";
 		default: return "";
 		}
 	}
@@ -62,6 +65,35 @@ namespace communicator
 		case HTTPErr::UnsupportedTransferEncoding: return "Unsupported Transfer Encoding";
 		case HTTPErr::NoBodyForMethod: return "No Body For Method";
 		case HTTPErr::ChunkedEncodingNotSupported: return "Chunked Encoding Not Supported";
+		case HTTPErr::CacheMiss: return "Cache Miss";
+		case HTTPErr::CacheUnavailable: return "Cache Unavailable";
+		case HTTPErr::NotCacheable: return "Not Cacheable";
+		case HTTPErr::FileIOFailed: return "File IO Failed";
+		case HTTPErr::SendFailed: return "Send Failed";
+		case HTTPErr::ReceiveFailed: return "Receive Failed";
+		case HTTPErr::ConnectionClosed: return "Connection Closed";
+		case HTTPErr::ConnectionTimeout: return "Connection Timeout";
+		case HTTPErr::InvalidStatusLine: return "Invalid Status Line";
+		case HTTPErr::InvalidContentLength: return "Invalid Content Length";
+		case HTTPErr::InvalidChunkSize: return "Invalid Chunk Size";
+		case HTTPErr::ConcurrencyLimited: return "Concurrency Limited";
+		case HTTPErr::InvalidHeader: return "Invalid Header";
+		case HTTPErr::InvalidJSON: return "Invalid JSON";
+		case HTTPErr::JSONTypeMismatch: return "JSON Type Mismatch";
+		case HTTPErr::JSONFieldNotFound: return "JSON Field Not Found";
+		case HTTPErr::BatchCancelled: return "Batch Cancelled";
+		case HTTPErr::ClosedBeforeResponse: return "Closed Before Response";
+		case HTTPErr::SocketOptionFailed: return "Socket Option Failed";
+		case HTTPErr::LocalSocketUnsupported: return "Local Socket Unsupported";
+		case HTTPErr::ProxyConnectFailed: return "Proxy Connect Failed";
+		case HTTPErr::InvalidContentRange: return "Invalid Content Range";
+		case HTTPErr::ResourceChanged: return "Resource Changed";
+		case HTTPErr::WebSocketHandshakeFailed: return "WebSocket Handshake Failed";
+		case HTTPErr::WebSocketProtocolError: return "WebSocket Protocol Error";
+		case HTTPErr::WebSocketClosed: return "WebSocket Closed";
+		case HTTPErr::MessageTooLarge: return "Message Too Large";
+		case HTTPErr::RandomSourceFailed: return "Random Source Failed";
+		case HTTPErr::CacheFull: return "Cache Full";
 		default: return "Unknown Error";
 		}
 	}
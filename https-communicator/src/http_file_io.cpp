@@ -0,0 +1,446 @@
+#include "headers.h"
+#include "http_file_io.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+
+namespace communicator
+{
+
+	// --- HTTPFileSink Implementation ---
+
+	HTTPErr HTTPFileSink::open(const std::filesystem::path& path, const HTTPFileWriteOptions& options, uint64_t expectedSize)
+	{
+		abort();
+
+		_targetPath = path;
+		_options = options;
+		_writePath = path;
+		if (options.atomicRename)
+			_writePath += ".part";
+
+		_written = 0;
+		_preallocated = 0;
+		_lastSync = 0;
+
+#if defined(__linux__)
+		_fd = ::open(_writePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (_fd < 0)
+		{
+			HTTP_LOG_WARN("Failed to open download file: {}", _writePath.string());
+			_writePath.clear();
+			return HTTPErr::FileIOFailed;
+		}
+
+		if (options.preallocate && expectedSize > 0)
+		{
+			if (fallocate(_fd, 0, 0, static_cast<off_t>(expectedSize)) == 0)
+			{
+				_preallocated = expectedSize;
+			}
+			else if (errno == ENOSPC)
+			{
+				abort();
+				return HTTPErr::FileIOFailed;
+			}
+		}
+#else
+		_stream.open(_writePath, std::ios::binary | std::ios::trunc);
+		if (!_stream)
+		{
+			HTTP_LOG_WARN("Failed to open download file: {}", _writePath.string());
+			_writePath.clear();
+			return HTTPErr::FileIOFailed;
+		}
+#endif
+
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPFileSink::write(std::span<const uint8_t> data)
+	{
+#if defined(__linux__)
+		while (!data.empty())
+		{
+			ssize_t written = pwrite(_fd, data.data(), data.size(), static_cast<off_t>(_written));
+			if (written < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return HTTPErr::FileIOFailed;
+			}
+
+			data = data.subspan(static_cast<size_t>(written));
+			_written += static_cast<uint64_t>(written);
+		}
+#else
+		_stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!_stream)
+			return HTTPErr::FileIOFailed;
+
+		_written += data.size();
+#endif
+
+		return maybe_sync();
+	}
+
+	HTTPErr HTTPFileSink::write_from_stream(HTTPStream& stream, uint64_t length, bool untilEof)
+	{
+		uint64_t remaining = untilEof ? UINT64_MAX : length;
+
+#if defined(__linux__)
+		// Splicing reads the descriptor itself, which only works when no other reader sits in front of it
+		if (_spliceSupported && stream.direct())
+		{
+			HTTPErr err = splice_from_socket(stream.socket(), remaining, untilEof);
+			if (err != HTTPErr::None || remaining == 0)
+				return err;
+		}
+#endif
+
+		if (_buffer.empty())
+			_buffer.resize(FILE_IO_CHUNK_SIZE);
+
+		while (remaining > 0)
+		{
+			size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, _buffer.size()));
+
+			asio::error_code ec;
+			size_t received = stream.read_some(asio::buffer(_buffer.data(), chunk), ec);
+
+			if (ec == asio::error::eof && untilEof)
+				return HTTPErr::None;
+
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error reading response body: {}:{}", ec.category().name(), ec.value());
+				return to_http_err(ec, HTTPErr::ReceiveFailed);
+			}
+
+			HTTPErr err = write(std::span<const uint8_t>(_buffer.data(), received));
+			if (err != HTTPErr::None)
+				return err;
+
+			remaining -= received;
+		}
+
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPFileSink::commit()
+	{
+		if (_writePath.empty())
+			return HTTPErr::FileIOFailed;
+
+#if defined(__linux__)
+		if (_preallocated > _written && ftruncate(_fd, static_cast<off_t>(_written)) != 0)
+		{
+			abort();
+			return HTTPErr::FileIOFailed;
+		}
+
+		if (_options.sync != HTTPFileSync::None && fdatasync(_fd) != 0)
+		{
+			abort();
+			return HTTPErr::FileIOFailed;
+		}
+#else
+		_stream.flush();
+		if (!_stream)
+		{
+			abort();
+			return HTTPErr::FileIOFailed;
+		}
+#endif
+
+		close_handles();
+
+		if (_options.atomicRename)
+		{
+			std::error_code fsError;
+			std::filesystem::rename(_writePath, _targetPath, fsError);
+			if (fsError)
+			{
+				HTTP_LOG_WARN("Failed to move download into place: {}:{}", fsError.category().name(), fsError.value());
+				abort();
+				return HTTPErr::FileIOFailed;
+			}
+
+#if defined(__linux__)
+			// Persist the rename itself, not just the file contents
+			if (_options.sync != HTTPFileSync::None)
+			{
+				std::filesystem::path directory = _targetPath.parent_path();
+				int dirFd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+				if (dirFd >= 0)
+				{
+					fsync(dirFd);
+					::close(dirFd);
+				}
+			}
+#endif
+		}
+
+		_writePath.clear();
+		return HTTPErr::None;
+	}
+
+	void HTTPFileSink::abort()
+	{
+		close_handles();
+
+		if (!_writePath.empty())
+		{
+			std::error_code fsError;
+			std::filesystem::remove(_writePath, fsError);
+			_writePath.clear();
+		}
+	}
+
+	uint64_t HTTPFileSink::bytes_written() const
+	{
+		return _written;
+	}
+
+	HTTPFileSink::~HTTPFileSink()
+	{
+		abort();
+
+#if defined(__linux__)
+		if (_pipe[0] >= 0)
+		{
+			::close(_pipe[0]);
+			::close(_pipe[1]);
+		}
+#endif
+	}
+
+	HTTPErr HTTPFileSink::splice_from_socket(HTTPSocket& socket, uint64_t& remaining, bool untilEof)
+	// Moves socket pages into the file through a pipe without copying them into user space
+	{
+#if defined(__linux__)
+		if (_pipe[0] < 0)
+		{
+			if (pipe2(_pipe, O_CLOEXEC) != 0)
+			{
+				_spliceSupported = false;
+				return HTTPErr::None;
+			}
+			fcntl(_pipe[1], F_SETPIPE_SZ, static_cast<int>(FILE_IO_CHUNK_SIZE));
+		}
+
+		int socketFd = socket.native_handle();
+
+		while (remaining > 0)
+		{
+			size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, FILE_IO_CHUNK_SIZE));
+
+			ssize_t received = splice(socketFd, nullptr, _pipe[1], nullptr, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (received == 0)
+			{
+				if (untilEof)
+				{
+					remaining = 0;
+					return HTTPErr::None;
+				}
+				return HTTPErr::ConnectionClosed;
+			}
+
+			if (received < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				if (errno == EAGAIN)
+				{
+					asio::error_code ec;
+					socket.wait(HTTPSocket::wait_read, ec);
+					if (ec)
+						return to_http_err(ec, HTTPErr::ReceiveFailed);
+					continue;
+				}
+
+				if (errno == EINVAL)
+				{
+					// Nothing was moved yet, so the buffered path can take over
+					_spliceSupported = false;
+					return HTTPErr::None;
+				}
+
+				return HTTPErr::ReceiveFailed;
+			}
+
+			size_t pending = static_cast<size_t>(received);
+			while (pending > 0)
+			{
+				loff_t offset = static_cast<loff_t>(_written);
+				ssize_t moved = splice(_pipe[0], nullptr, _fd, &offset, pending, SPLICE_F_MOVE);
+
+				if (moved < 0 && errno == EINTR)
+					continue;
+
+				if (moved < 0 && errno == EINVAL)
+				{
+					// The file system cannot take spliced pages, drain the pipe by hand
+					_spliceSupported = false;
+					if (_buffer.empty())
+						_buffer.resize(FILE_IO_CHUNK_SIZE);
+
+					ssize_t drained = read(_pipe[0], _buffer.data(), std::min(pending, _buffer.size()));
+					if (drained <= 0)
+						return HTTPErr::FileIOFailed;
+
+					uint64_t before = _written;
+					HTTPErr err = write(std::span<const uint8_t>(_buffer.data(), static_cast<size_t>(drained)));
+					if (err != HTTPErr::None)
+						return err;
+
+					_written = before;
+					moved = drained;
+				}
+
+				if (moved < 0)
+					return HTTPErr::FileIOFailed;
+
+				pending -= static_cast<size_t>(moved);
+				_written += static_cast<uint64_t>(moved);
+			}
+
+			remaining -= static_cast<uint64_t>(received);
+
+			HTTPErr err = maybe_sync();
+			if (err != HTTPErr::None)
+				return err;
+
+			if (!_spliceSupported)
+				return HTTPErr::None;
+		}
+
+		return HTTPErr::None;
+#else
+		return HTTPErr::None;
+#endif
+	}
+
+	HTTPErr HTTPFileSink::maybe_sync()
+	{
+#if defined(__linux__)
+		if (_options.sync == HTTPFileSync::Periodic && _written - _lastSync >= _options.syncInterval)
+		{
+			if (fdatasync(_fd) != 0)
+				return HTTPErr::FileIOFailed;
+			_lastSync = _written;
+		}
+#else
+		if (_options.sync == HTTPFileSync::Periodic && _written - _lastSync >= _options.syncInterval)
+		{
+			_stream.flush();
+			_lastSync = _written;
+		}
+#endif
+		return HTTPErr::None;
+	}
+
+	void HTTPFileSink::close_handles()
+	{
+#if defined(__linux__)
+		if (_fd >= 0)
+		{
+			::close(_fd);
+			_fd = -1;
+		}
+#else
+		if (_stream.is_open())
+			_stream.close();
+#endif
+	}
+
+
+	// --- File Transfer Methods ---
+
+	HTTPErr send_file_body(HTTPSocket& socket, const std::filesystem::path& path, uint64_t length)
+	{
+#if defined(__linux__)
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			HTTP_LOG_WARN("Failed to open upload file: {}", path.string());
+			return HTTPErr::FileIOFailed;
+		}
+
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		HTTPErr err = HTTPErr::None;
+		off_t offset = 0;
+
+		while (static_cast<uint64_t>(offset) < length)
+		{
+			size_t chunk = static_cast<size_t>(std::min<uint64_t>(length - static_cast<uint64_t>(offset), 1ull << 30));
+
+			ssize_t sent = ::sendfile(socket.native_handle(), fd, &offset, chunk);
+			if (sent > 0)
+				continue;
+
+			if (sent == 0)
+			{
+				// The file shrank after Content-Length was written
+				err = HTTPErr::InvalidContentSize;
+				break;
+			}
+
+			if (errno == EINTR)
+				continue;
+
+			if (errno == EAGAIN)
+			{
+				// asio leaves the descriptor non-blocking once async operations have run on it
+				asio::error_code ec;
+				socket.wait(HTTPSocket::wait_write, ec);
+				if (!ec)
+					continue;
+			}
+
+			err = HTTPErr::SendFailed;
+			break;
+		}
+
+		::close(fd);
+		return err;
+#else
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			HTTP_LOG_WARN("Failed to open upload file: {}", path.string());
+			return HTTPErr::FileIOFailed;
+		}
+
+		std::vector<char> buffer(FILE_IO_CHUNK_SIZE);
+		uint64_t remaining = length;
+
+		while (remaining > 0)
+		{
+			size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+
+			file.read(buffer.data(), static_cast<std::streamsize>(chunk));
+			if (static_cast<size_t>(file.gcount()) != chunk)
+				return HTTPErr::InvalidContentSize;
+
+			asio::error_code ec;
+			asio::write(socket, asio::buffer(buffer.data(), chunk), ec);
+			if (ec)
+				return to_http_err(ec, HTTPErr::SendFailed);
+
+			remaining -= chunk;
+		}
+
+		return HTTPErr::None;
+#endif
+	}
+
+}
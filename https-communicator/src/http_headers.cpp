@@ -0,0 +1,106 @@
+#include "headers.h"
+#include "http_headers.h"
+#include "http_url.h"
+
+
+namespace communicator
+{
+
+	// --- HTTPHeaderBlock Implementation ---
+
+	HTTPHeaderBlock::HTTPHeaderBlock(const std::unordered_map<std::string, std::string>& headers)
+	{
+		assign(headers);
+	}
+
+	void HTTPHeaderBlock::assign(const std::unordered_map<std::string, std::string>& headers)
+	{
+		clear();
+
+		size_t size = 0;
+		for (const auto& header : headers)
+			size += header.first.size() + header.second.size() + 4;
+
+		_wire.reserve(size);
+		_entries.reserve(headers.size());
+
+		for (const auto& header : headers)
+		{
+			Entry entry;
+			entry.offset = static_cast<uint32_t>(_wire.size());
+			entry.nameLength = static_cast<uint32_t>(header.first.size());
+
+			_wire.append(header.first).append(": ").append(header.second).append("\r\n");
+
+			entry.length = static_cast<uint32_t>(_wire.size()) - entry.offset;
+			_entries.push_back(entry);
+		}
+	}
+
+	void HTTPHeaderBlock::clear()
+	{
+		_wire.clear();
+		_entries.clear();
+	}
+
+	bool HTTPHeaderBlock::empty() const
+	{
+		return _entries.empty();
+	}
+
+	bool HTTPHeaderBlock::contains(std::string_view name) const
+	{
+		for (const Entry& entry : _entries)
+		{
+			if (iequals_ascii(name_of(entry), name))
+				return true;
+		}
+		return false;
+	}
+
+	std::string_view HTTPHeaderBlock::wire() const
+	{
+		return _wire;
+	}
+
+	void HTTPHeaderBlock::append_to(std::string& out, const std::unordered_map<std::string, std::string>& overrides) const
+	{
+		if (overrides.empty())
+		{
+			out.append(_wire);
+			return;
+		}
+
+		// Copy the block in runs, breaking only around the lines an override replaces
+		size_t runStart = 0;
+
+		for (const Entry& entry : _entries)
+		{
+			std::string_view name = name_of(entry);
+
+			bool replaced = false;
+			for (const auto& header : overrides)
+			{
+				if (iequals_ascii(header.first, name))
+				{
+					replaced = true;
+					break;
+				}
+			}
+
+			if (!replaced)
+				continue;
+
+			out.append(_wire, runStart, entry.offset - runStart);
+			runStart = entry.offset + entry.length;
+		}
+
+		out.append(_wire, runStart);
+	}
+
+	std::string_view HTTPHeaderBlock::name_of(const Entry& entry) const
+	{
+		return std::string_view(_wire).substr(entry.offset, entry.nameLength);
+	}
+
+}
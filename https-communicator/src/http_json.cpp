@@ -0,0 +1,542 @@
+#include "headers.h"
+#include "http_json.h"
+
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HTTP_JSON_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define HTTP_JSON_NEON
+#include <arm_neon.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr size_t npos = std::string_view::npos;
+
+		bool is_whitespace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		size_t skip_whitespace(std::string_view json, size_t pos)
+		{
+			while (pos < json.size() && is_whitespace(json[pos]))
+				pos++;
+			return pos;
+		}
+
+		template <char... Targets>
+		size_t find_any(std::string_view json, size_t pos)
+		// The first of Targets at or after pos, 16 bytes per step where the platform has SIMD
+		{
+			const char* data = json.data();
+			size_t size = json.size();
+
+#if defined(HTTP_JSON_SSE2)
+			for (; pos + 16 <= size; pos += 16)
+			{
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+
+				__m128i hits = _mm_setzero_si128();
+				((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Targets)))), ...);
+
+				uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+				if (mask != 0)
+					return pos + static_cast<size_t>(std::countr_zero(mask));
+			}
+#elif defined(HTTP_JSON_NEON)
+			for (; pos + 16 <= size; pos += 16)
+			{
+				uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(data + pos));
+
+				uint8x16_t hits = vdupq_n_u8(0);
+				((hits = vorrq_u8(hits, vceqq_u8(chunk, vdupq_n_u8(static_cast<uint8_t>(Targets))))), ...);
+
+				if (vmaxvq_u8(hits) != 0)
+					break; // The scalar loop below finds the exact byte inside this block
+			}
+#endif
+
+			for (; pos < size; pos++)
+			{
+				if (((data[pos] == Targets) || ...))
+					return pos;
+			}
+			return size;
+		}
+
+		size_t skip_string(std::string_view json, size_t pos)
+		// pos is on the opening quote, returns the position after the closing one
+		{
+			pos++;
+			while (true)
+			{
+				pos = find_any<'"', '\\'>(json, pos);
+				if (pos >= json.size())
+					return npos;
+
+				if (json[pos] == '"')
+					return pos + 1;
+
+				pos += 2;
+			}
+		}
+
+		size_t skip_scalar(std::string_view json, size_t pos)
+		{
+			size_t start = pos;
+			while (pos < json.size() && !is_whitespace(json[pos]) && json[pos] != ',' && json[pos] != '}' && json[pos] != ']')
+				pos++;
+			return pos == start ? npos : pos;
+		}
+
+		size_t skip_value(std::string_view json, size_t pos)
+		// Returns the position after the value, brackets are only counted, not matched
+		{
+			if (pos >= json.size())
+				return npos;
+
+			char c = json[pos];
+			if (c == '"')
+				return skip_string(json, pos);
+
+			if (c != '{' && c != '[')
+				return skip_scalar(json, pos);
+
+			size_t depth = 0;
+			while (true)
+			{
+				pos = find_any<'"', '{', '}', '[', ']'>(json, pos);
+				if (pos >= json.size())
+					return npos;
+
+				switch (json[pos])
+				{
+				case '"':
+					pos = skip_string(json, pos);
+					if (pos == npos)
+						return npos;
+					break;
+				case '{':
+				case '[':
+					depth++;
+					pos++;
+					break;
+				default:
+					depth--;
+					pos++;
+					if (depth == 0)
+						return pos;
+					break;
+				}
+			}
+		}
+
+		void append_utf8(std::string& out, uint32_t codePoint)
+		{
+			if (codePoint < 0x80)
+			{
+				out.push_back(static_cast<char>(codePoint));
+			}
+			else if (codePoint < 0x800)
+			{
+				out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+				out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+			else if (codePoint < 0x10000)
+			{
+				out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+				out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+			else
+			{
+				out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+				out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+				out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+			}
+		}
+
+		bool read_hex4(std::string_view text, size_t pos, uint32_t& value)
+		{
+			if (pos + 4 > text.size())
+				return false;
+
+			auto [end, errc] = std::from_chars(text.data() + pos, text.data() + pos + 4, value, 16);
+			return errc == std::errc() && end == text.data() + pos + 4;
+		}
+
+		HTTPErr unescape(std::string_view raw, std::string& out)
+		// Copies the runs between escapes in bulk
+		{
+			size_t pos = 0;
+			while (pos < raw.size())
+			{
+				size_t escape = find_any<'\\'>(raw, pos);
+				out.append(raw, pos, escape - pos);
+				if (escape >= raw.size())
+					break;
+
+				if (escape + 1 >= raw.size())
+					return HTTPErr::InvalidJSON;
+
+				pos = escape + 2;
+				switch (raw[escape + 1])
+				{
+				case '"': out.push_back('"'); break;
+				case '\\': out.push_back('\\'); break;
+				case '/': out.push_back('/'); break;
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'n': out.push_back('\n'); break;
+				case 'r': out.push_back('\r'); break;
+				case 't': out.push_back('\t'); break;
+				case 'u':
+				{
+					uint32_t codePoint = 0;
+					if (!read_hex4(raw, pos, codePoint))
+						return HTTPErr::InvalidJSON;
+					pos += 4;
+
+					// A high surrogate must be followed by an escaped low one
+					if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+					{
+						uint32_t low = 0;
+						if (pos + 1 >= raw.size() || raw[pos] != '\\' || raw[pos + 1] != 'u' || !read_hex4(raw, pos + 2, low) || low < 0xDC00 || low > 0xDFFF)
+							return HTTPErr::InvalidJSON;
+
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+						pos += 6;
+					}
+					else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+					{
+						return HTTPErr::InvalidJSON;
+					}
+
+					append_utf8(out, codePoint);
+					break;
+				}
+				default:
+					return HTTPErr::InvalidJSON;
+				}
+			}
+
+			return HTTPErr::None;
+		}
+
+		bool key_equals(std::string_view rawKey, std::string_view key)
+		{
+			if (rawKey.find('\\') == std::string_view::npos)
+				return rawKey == key;
+
+			std::string decoded;
+			return unescape(rawKey, decoded) == HTTPErr::None && decoded == key;
+		}
+	}
+
+
+	// --- HTTPJSONValue Implementation ---
+
+	HTTPJSONValue::HTTPJSONValue(std::string_view document)
+		: _json(document.substr(std::min(skip_whitespace(document, 0), document.size())))
+	{
+	}
+
+	HTTPJSONType HTTPJSONValue::type() const
+	{
+		if (_json.empty())
+			return HTTPJSONType::Invalid;
+
+		switch (_json.front())
+		{
+		case '{': return HTTPJSONType::Object;
+		case '[': return HTTPJSONType::Array;
+		case '"': return HTTPJSONType::String;
+		case 't':
+		case 'f': return HTTPJSONType::Bool;
+		case 'n': return HTTPJSONType::Null;
+		default:
+			if (_json.front() == '-' || (_json.front() >= '0' && _json.front() <= '9'))
+				return HTTPJSONType::Number;
+			return HTTPJSONType::Invalid;
+		}
+	}
+
+	std::expected<HTTPJSONValue, HTTPErr> HTTPJSONValue::find(std::string_view key) const
+	{
+		size_t pos = 0;
+		bool done = false;
+
+		HTTPErr err = open_container('{', pos, done);
+		while (err == HTTPErr::None && !done)
+		{
+			std::string_view rawKey;
+			HTTPJSONValue value;
+
+			err = next_item(pos, &rawKey, value, done);
+			if (err == HTTPErr::None && !done && key_equals(rawKey, key))
+				return value;
+		}
+
+		return std::unexpected(err != HTTPErr::None ? err : HTTPErr::JSONFieldNotFound);
+	}
+
+	std::expected<HTTPJSONValue, HTTPErr> HTTPJSONValue::at(size_t index) const
+	{
+		size_t pos = 0;
+		bool done = false;
+
+		HTTPErr err = open_container('[', pos, done);
+		for (size_t i = 0; err == HTTPErr::None && !done; i++)
+		{
+			HTTPJSONValue value;
+
+			err = next_item(pos, nullptr, value, done);
+			if (err == HTTPErr::None && !done && i == index)
+				return value;
+		}
+
+		return std::unexpected(err != HTTPErr::None ? err : HTTPErr::JSONFieldNotFound);
+	}
+
+	std::expected<HTTPJSONValue, HTTPErr> HTTPJSONValue::at_pointer(std::string_view pointer) const
+	{
+		if (!pointer.empty() && pointer.front() != '/')
+		{
+			return std::unexpected(HTTPErr::InvalidJSON);
+		}
+
+		HTTPJSONValue current = *this;
+		std::string decoded;
+
+		while (!pointer.empty())
+		{
+			pointer.remove_prefix(1);
+
+			size_t slash = pointer.find('/');
+			std::string_view token = pointer.substr(0, slash);
+			pointer = slash == std::string_view::npos ? std::string_view() : pointer.substr(slash);
+
+			if (token.find('~') != std::string_view::npos)
+			{
+				decoded.clear();
+				for (size_t i = 0; i < token.size(); i++)
+				{
+					if (token[i] == '~' && i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1'))
+					{
+						decoded.push_back(token[i + 1] == '0' ? '~' : '/');
+						i++;
+					}
+					else
+					{
+						decoded.push_back(token[i]);
+					}
+				}
+				token = decoded;
+			}
+
+			std::expected<HTTPJSONValue, HTTPErr> next = std::unexpected(HTTPErr::JSONTypeMismatch);
+
+			if (current.type() == HTTPJSONType::Object)
+			{
+				next = current.find(token);
+			}
+			else if (current.type() == HTTPJSONType::Array)
+			{
+				size_t index = 0;
+				auto [end, errc] = std::from_chars(token.data(), token.data() + token.size(), index);
+				if (errc != std::errc() || end != token.data() + token.size())
+					return std::unexpected(HTTPErr::JSONFieldNotFound);
+
+				next = current.at(index);
+			}
+
+			if (!next.has_value())
+			{
+				return next;
+			}
+
+			current = *next;
+		}
+
+		return current;
+	}
+
+	std::expected<std::string_view, HTTPErr> HTTPJSONValue::get_raw_string() const
+	{
+		if (type() != HTTPJSONType::String)
+		{
+			return std::unexpected(HTTPErr::JSONTypeMismatch);
+		}
+
+		size_t end = skip_string(_json, 0);
+		if (end == npos)
+		{
+			return std::unexpected(HTTPErr::InvalidJSON);
+		}
+
+		return _json.substr(1, end - 2);
+	}
+
+	HTTPErr HTTPJSONValue::get_string(std::string& out) const
+	{
+		auto raw = get_raw_string();
+		if (!raw.has_value())
+		{
+			return raw.error();
+		}
+
+		out.clear();
+		return unescape(*raw, out);
+	}
+
+	std::expected<int64_t, HTTPErr> HTTPJSONValue::get_int64() const
+	{
+		if (type() != HTTPJSONType::Number)
+		{
+			return std::unexpected(HTTPErr::JSONTypeMismatch);
+		}
+
+		std::string_view text = scalar();
+
+		int64_t value = 0;
+		auto [end, errc] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (errc != std::errc() || end != text.data() + text.size())
+		{
+			// Fractions, exponents and values out of range do not fit
+			return std::unexpected(HTTPErr::JSONTypeMismatch);
+		}
+
+		return value;
+	}
+
+	std::expected<double, HTTPErr> HTTPJSONValue::get_double() const
+	{
+		if (type() != HTTPJSONType::Number)
+		{
+			return std::unexpected(HTTPErr::JSONTypeMismatch);
+		}
+
+		std::string_view text = scalar();
+
+		double value = 0;
+		auto [end, errc] = std::from_chars(text.data(), text.data() + text.size(), value);
+		if (errc != std::errc() || end != text.data() + text.size())
+		{
+			return std::unexpected(HTTPErr::InvalidJSON);
+		}
+
+		return value;
+	}
+
+	std::expected<bool, HTTPErr> HTTPJSONValue::get_bool() const
+	{
+		std::string_view text = scalar();
+
+		if (text == "true")
+			return true;
+		if (text == "false")
+			return false;
+
+		return std::unexpected(type() == HTTPJSONType::Bool ? HTTPErr::InvalidJSON : HTTPErr::JSONTypeMismatch);
+	}
+
+	bool HTTPJSONValue::is_null() const
+	{
+		return scalar() == "null";
+	}
+
+	std::expected<std::string_view, HTTPErr> HTTPJSONValue::raw() const
+	{
+		size_t end = skip_value(_json, 0);
+		if (end == npos)
+		{
+			return std::unexpected(HTTPErr::InvalidJSON);
+		}
+
+		return _json.substr(0, end);
+	}
+
+	HTTPErr HTTPJSONValue::open_container(char open, size_t& pos, bool& done) const
+	{
+		if (_json.empty() || _json.front() != open)
+		{
+			return HTTPErr::JSONTypeMismatch;
+		}
+
+		pos = skip_whitespace(_json, 1);
+		if (pos >= _json.size())
+		{
+			return HTTPErr::InvalidJSON;
+		}
+
+		done = _json[pos] == (open == '{' ? '}' : ']');
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPJSONValue::next_item(size_t& pos, std::string_view* key, HTTPJSONValue& value, bool& done) const
+	{
+		if (pos == npos)
+		{
+			done = true;
+			return HTTPErr::None;
+		}
+
+		char close = key ? '}' : ']';
+
+		if (key)
+		{
+			if (pos >= _json.size() || _json[pos] != '"')
+				return HTTPErr::InvalidJSON;
+
+			size_t keyEnd = skip_string(_json, pos);
+			if (keyEnd == npos)
+				return HTTPErr::InvalidJSON;
+
+			*key = _json.substr(pos + 1, keyEnd - pos - 2);
+
+			pos = skip_whitespace(_json, keyEnd);
+			if (pos >= _json.size() || _json[pos] != ':')
+				return HTTPErr::InvalidJSON;
+
+			pos = skip_whitespace(_json, pos + 1);
+		}
+
+		size_t valueEnd = skip_value(_json, pos);
+		if (valueEnd == npos)
+			return HTTPErr::InvalidJSON;
+
+		value._json = _json.substr(pos);
+
+		pos = skip_whitespace(_json, valueEnd);
+		if (pos >= _json.size())
+			return HTTPErr::InvalidJSON;
+
+		if (_json[pos] == ',')
+		{
+			pos = skip_whitespace(_json, pos + 1);
+			return HTTPErr::None;
+		}
+
+		if (_json[pos] != close)
+			return HTTPErr::InvalidJSON;
+
+		// The caller still gets this last item, the next call reports the end
+		pos = npos;
+		return HTTPErr::None;
+	}
+
+	std::string_view HTTPJSONValue::scalar() const
+	{
+		size_t end = skip_scalar(_json, 0);
+		return end == npos ? std::string_view() : _json.substr(0, end);
+	}
+
+}
@@ -0,0 +1,217 @@
+#include "headers.h"
+#include "http_limiter.h"
+#include "http_logger.h"
+
+
+namespace communicator
+{
+
+	// --- HTTPLimiterPermit Implementation ---
+
+	HTTPLimiterPermit::HTTPLimiterPermit(HTTPLimiterPermit&& other) noexcept
+		: _limiter(std::exchange(other._limiter, nullptr)), _host(std::exchange(other._host, nullptr)), _start(other._start)
+	{
+	}
+
+	HTTPLimiterPermit& HTTPLimiterPermit::operator=(HTTPLimiterPermit&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release(HTTPLimiterOutcome::Ignored);
+
+			_limiter = std::exchange(other._limiter, nullptr);
+			_host = std::exchange(other._host, nullptr);
+			_start = other._start;
+		}
+		return *this;
+	}
+
+	HTTPLimiterPermit::~HTTPLimiterPermit()
+	{
+		release(HTTPLimiterOutcome::Ignored);
+	}
+
+	void HTTPLimiterPermit::release(HTTPLimiterOutcome outcome)
+	{
+		if (!_limiter)
+			return;
+
+		auto* state = static_cast<HTTPConcurrencyLimiter::HostState*>(_host);
+		_limiter->complete(*state, outcome, std::chrono::steady_clock::now() - _start);
+
+		_limiter = nullptr;
+		_host = nullptr;
+	}
+
+
+	// --- HTTPConcurrencyLimiter Implementation ---
+
+	HTTPConcurrencyLimiter::HTTPConcurrencyLimiter(const HTTPLimiterOptions& options)
+		: _options(options)
+	{
+		_options.minLimit = std::max<size_t>(_options.minLimit, 1);
+		_options.maxLimit = std::max(_options.maxLimit, _options.minLimit);
+		_options.initialLimit = std::clamp(_options.initialLimit, _options.minLimit, _options.maxLimit);
+	}
+
+	std::expected<HTTPLimiterPermit, HTTPErr> HTTPConcurrencyLimiter::acquire(std::string_view host, std::string_view port)
+	{
+		if (_options.queueTimeout.count() <= 0)
+			return try_acquire(host, port);
+
+		HostState& state = host_state(host, port);
+		std::unique_lock lock(state.mutex);
+
+		if (state.inFlight >= static_cast<size_t>(state.limit))
+		{
+			if (state.queued >= _options.maxQueue)
+			{
+				state.rejected++;
+				return std::unexpected(HTTPErr::ConcurrencyLimited);
+			}
+
+			state.queued++;
+			bool admitted = state.available.wait_for(lock, _options.queueTimeout,
+				[&]() { return state.inFlight < static_cast<size_t>(state.limit); });
+			state.queued--;
+
+			if (!admitted)
+			{
+				state.rejected++;
+				HTTP_LOG_DEBUG("Request to {}:{} timed out waiting for a concurrency slot.", host, port);
+				return std::unexpected(HTTPErr::ConcurrencyLimited);
+			}
+		}
+
+		return admit(state);
+	}
+
+	std::expected<HTTPLimiterPermit, HTTPErr> HTTPConcurrencyLimiter::try_acquire(std::string_view host, std::string_view port)
+	{
+		HostState& state = host_state(host, port);
+		std::lock_guard lock(state.mutex);
+
+		if (state.inFlight >= static_cast<size_t>(state.limit))
+		{
+			state.rejected++;
+			return std::unexpected(HTTPErr::ConcurrencyLimited);
+		}
+
+		return admit(state);
+	}
+
+	HTTPLimiterStats HTTPConcurrencyLimiter::stats(std::string_view host, std::string_view port)
+	{
+		return stats_of(host_state(host, port));
+	}
+
+	std::vector<std::pair<std::string, HTTPLimiterStats>> HTTPConcurrencyLimiter::snapshot()
+	{
+		std::vector<std::pair<std::string, HTTPLimiterStats>> result;
+
+		std::lock_guard lock(_hostsMutex);
+		result.reserve(_hosts.size());
+		for (auto& [origin, state] : _hosts)
+			result.emplace_back(origin, stats_of(*state));
+
+		return result;
+	}
+
+	HTTPLimiterOutcome HTTPConcurrencyLimiter::classify(HTTPErr err)
+	{
+		switch (err)
+		{
+		case HTTPErr::ConnectionFailed:
+		case HTTPErr::ConnectionTimeout:
+		case HTTPErr::ConnectionClosed:
+		case HTTPErr::ClosedBeforeResponse:
+		case HTTPErr::RequestTimeout:
+		case HTTPErr::SendFailed:
+		case HTTPErr::ReceiveFailed:
+			return HTTPLimiterOutcome::Dropped;
+		default:
+			return HTTPLimiterOutcome::Ignored;
+		}
+	}
+
+	HTTPConcurrencyLimiter::HostState& HTTPConcurrencyLimiter::host_state(std::string_view host, std::string_view port)
+	{
+		std::string key;
+		key.reserve(host.size() + port.size() + 1);
+		key.append(host).append(":").append(port);
+
+		std::lock_guard lock(_hostsMutex);
+
+		auto it = _hosts.find(key);
+		if (it != _hosts.end())
+			return *it->second;
+
+		auto state = std::make_unique<HostState>();
+		state->limit = static_cast<double>(_options.initialLimit);
+
+		return *_hosts.emplace(std::move(key), std::move(state)).first->second;
+	}
+
+	HTTPLimiterPermit HTTPConcurrencyLimiter::admit(HostState& state)
+	// Caller holds state.mutex
+	{
+		state.inFlight++;
+
+		HTTPLimiterPermit permit;
+		permit._limiter = this;
+		permit._host = &state;
+		permit._start = std::chrono::steady_clock::now();
+		return permit;
+	}
+
+	void HTTPConcurrencyLimiter::complete(HostState& state, HTTPLimiterOutcome outcome, std::chrono::steady_clock::duration latency)
+	{
+		int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+
+		{
+			std::lock_guard lock(state.mutex);
+
+			// Only requests issued while the host was kept busy tell us anything about its capacity
+			bool saturated = state.inFlight * 2 >= static_cast<size_t>(state.limit);
+			state.inFlight--;
+
+			if (outcome == HTTPLimiterOutcome::Success)
+			{
+				state.windowMinUs = state.windowSamples == 0 ? latencyUs : std::min(state.windowMinUs, latencyUs);
+				if (++state.windowSamples >= _options.baselineWindow)
+				{
+					// Re-measure, so a backend that became permanently slower is not treated as overloaded forever
+					state.baselineUs = state.windowMinUs;
+					state.windowSamples = 0;
+				}
+
+				if (state.baselineUs == 0 || latencyUs < state.baselineUs)
+					state.baselineUs = latencyUs;
+
+				if (latencyUs > state.baselineUs * _options.latencyTolerance)
+					outcome = HTTPLimiterOutcome::Dropped;
+			}
+
+			if (outcome == HTTPLimiterOutcome::Dropped)
+				state.limit = std::max(static_cast<double>(_options.minLimit), state.limit * _options.backoffRatio);
+			else if (outcome == HTTPLimiterOutcome::Success && saturated)
+				state.limit = std::min(static_cast<double>(_options.maxLimit), state.limit + 1.0 / state.limit);
+		}
+
+		state.available.notify_one();
+	}
+
+	HTTPLimiterStats HTTPConcurrencyLimiter::stats_of(HostState& state)
+	{
+		std::lock_guard lock(state.mutex);
+
+		return HTTPLimiterStats{
+			static_cast<size_t>(state.limit),
+			state.inFlight,
+			state.queued,
+			state.rejected,
+			std::chrono::microseconds(state.baselineUs)
+		};
+	}
+
+}
@@ -0,0 +1,273 @@
+#include "headers.h"
+#include "http_logger.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+
+namespace communicator
+{
+
+	std::string_view to_string(HTTPLogLevel level)
+	{
+		switch (level)
+		{
+		case HTTPLogLevel::Trace: return "TRACE";
+		case HTTPLogLevel::Debug: return "DEBUG";
+		case HTTPLogLevel::Info: return "INFO";
+		case HTTPLogLevel::Warn: return "WARN";
+		case HTTPLogLevel::Error: return "ERROR";
+		case HTTPLogLevel::Off: return "OFF";
+		}
+		return "UNKNOWN";
+	}
+
+
+	// --- HTTPLogRing Implementation ---
+
+	HTTPLogRing::HTTPLogRing(uint32_t thread)
+		: _thread(thread)
+	{
+	}
+
+	HTTPLogRecord* HTTPLogRing::try_reserve()
+	{
+		uint64_t head = _head.load(std::memory_order_relaxed);
+		if (head - _tail.load(std::memory_order_acquire) >= HTTP_LOG_RING_CAPACITY)
+			return nullptr;
+
+		return &_records[head & (HTTP_LOG_RING_CAPACITY - 1)];
+	}
+
+	void HTTPLogRing::publish()
+	{
+		_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	const HTTPLogRecord* HTTPLogRing::front() const
+	{
+		uint64_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail == _head.load(std::memory_order_acquire))
+			return nullptr;
+
+		return &_records[tail & (HTTP_LOG_RING_CAPACITY - 1)];
+	}
+
+	void HTTPLogRing::pop()
+	{
+		_tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	uint32_t HTTPLogRing::thread() const
+	{
+		return _thread;
+	}
+
+
+	// --- HTTPLogger Implementation ---
+
+	namespace
+	{
+		void default_sink(const HTTPLogRecord& record)
+		{
+			char prefix[64];
+			auto result = std::format_to_n(prefix, sizeof(prefix), "{}.{:06} [{}] [{}] ",
+				record.timestamp / 1'000'000'000, (record.timestamp / 1'000) % 1'000'000, to_string(record.level), record.thread);
+
+			FILE* stream = record.level >= HTTPLogLevel::Warn ? stderr : stdout;
+
+			std::fwrite(prefix, 1, std::min(static_cast<size_t>(result.size), sizeof(prefix)), stream);
+			std::fwrite(record.message, 1, record.length, stream);
+			if (record.truncated)
+				std::fputs("...", stream);
+			std::fputc('\n', stream);
+		}
+
+
+		class LoggerState
+		// Owns the ring registry and the drain thread, rings are only registered once per thread
+		{
+		public:
+
+			~LoggerState()
+			{
+				{
+					std::lock_guard lock(_mutex);
+					_running = false;
+				}
+				_wake.notify_all();
+
+				if (_drainer.joinable())
+					_drainer.join();
+			}
+
+			std::shared_ptr<HTTPLogRing> register_ring()
+			{
+				std::lock_guard lock(_mutex);
+
+				auto ring = std::make_shared<HTTPLogRing>(_nextThread++);
+				_rings.push_back(ring);
+
+				if (!_drainer.joinable())
+					_drainer = std::thread([this]() { drain_loop(); });
+
+				return ring;
+			}
+
+			void set_sink(HTTPLogger::Sink sink)
+			{
+				std::lock_guard lock(_mutex);
+				_sink = sink ? std::move(sink) : HTTPLogger::Sink(default_sink);
+			}
+
+			void flush()
+			{
+				std::unique_lock lock(_mutex);
+				if (!_drainer.joinable())
+					return;
+
+				uint64_t request = ++_flushRequested;
+				_wake.notify_all();
+				_flushed.wait(lock, [&]() { return _flushCompleted >= request || !_running; });
+			}
+
+			uint64_t dropped()
+			{
+				std::lock_guard lock(_mutex);
+
+				uint64_t total = _retiredDropped;
+				for (const auto& ring : _rings)
+					total += ring->dropped.load(std::memory_order_relaxed);
+
+				return total;
+			}
+
+		private:
+
+			std::mutex _mutex;
+			std::condition_variable _wake;
+			std::condition_variable _flushed;
+
+			std::vector<std::shared_ptr<HTTPLogRing>> _rings;
+			HTTPLogger::Sink _sink = default_sink;
+
+			std::thread _drainer;
+			bool _running = true;
+
+			uint32_t _nextThread = 0;
+			uint64_t _retiredDropped = 0;
+			uint64_t _flushRequested = 0;
+			uint64_t _flushCompleted = 0;
+
+		private:
+
+			void drain_loop()
+			{
+				std::vector<std::shared_ptr<HTTPLogRing>> rings;
+				HTTPLogger::Sink sink;
+
+				while (true)
+				{
+					uint64_t flushRequest;
+					bool running;
+					{
+						std::lock_guard lock(_mutex);
+						rings = _rings;
+						sink = _sink;
+						flushRequest = _flushRequested;
+						running = _running;
+					}
+
+					size_t drained = 0;
+					for (const auto& ring : rings)
+					{
+						while (const HTTPLogRecord* record = ring->front())
+						{
+							sink(*record);
+							ring->pop();
+							drained++;
+						}
+					}
+
+					if (drained > 0)
+					{
+						std::fflush(stdout);
+						std::fflush(stderr);
+					}
+
+					std::unique_lock lock(_mutex);
+
+					// Rings of exited threads are dropped once they are empty
+					std::erase_if(_rings, [&](const std::shared_ptr<HTTPLogRing>& ring)
+						{
+							if (!ring->retired.load(std::memory_order_acquire) || ring->front())
+								return false;
+							_retiredDropped += ring->dropped.load(std::memory_order_relaxed);
+							return true;
+						});
+
+					if (flushRequest > _flushCompleted)
+					{
+						_flushCompleted = flushRequest;
+						_flushed.notify_all();
+					}
+
+					if (!running)
+					{
+						_flushed.notify_all();
+						return;
+					}
+
+					if (drained == 0)
+						_wake.wait_for(lock, std::chrono::milliseconds(5), [&]() { return _flushRequested > _flushCompleted || !_running; });
+				}
+			}
+		};
+
+		LoggerState& logger_state()
+		{
+			static LoggerState state;
+			return state;
+		}
+
+		struct ThreadRing
+		{
+			std::shared_ptr<HTTPLogRing> ring = logger_state().register_ring();
+
+			~ThreadRing()
+			{
+				ring->retired.store(true, std::memory_order_release);
+			}
+		};
+	}
+
+	void HTTPLogger::set_sink(Sink sink)
+	{
+		logger_state().set_sink(std::move(sink));
+	}
+
+	void HTTPLogger::flush()
+	{
+		logger_state().flush();
+	}
+
+	uint64_t HTTPLogger::dropped()
+	{
+		return logger_state().dropped();
+	}
+
+	HTTPLogRing& HTTPLogger::thread_ring()
+	{
+		thread_local ThreadRing threadRing;
+		return *threadRing.ring;
+	}
+
+	uint64_t HTTPLogger::now_ns()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
+}
@@ -0,0 +1,308 @@
+#include "headers.h"
+#include "http_multipart.h"
+#include "http_file_io.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+#include <random>
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr std::string_view CRLF = "\r\n";
+
+		std::string escape_disposition_value(std::string_view value)
+		// Quotes and line breaks would end the quoted-string early, so they are percent-encoded
+		{
+			std::string escaped;
+			escaped.reserve(value.size());
+			for (char c : value)
+			{
+				switch (c)
+				{
+				case '"': escaped += "%22"; break;
+				case '\r': escaped += "%0D"; break;
+				case '\n': escaped += "%0A"; break;
+				default: escaped.push_back(c); break;
+				}
+			}
+			return escaped;
+		}
+
+		std::string random_boundary()
+		{
+			std::random_device device;
+			std::mt19937_64 engine((static_cast<uint64_t>(device()) << 32) | device());
+
+			std::string boundary = "----communicator";
+			constexpr char digits[] = "0123456789abcdef";
+			for (int i = 0; i < 24; i++)
+				boundary.push_back(digits[engine() & 0xF]);
+
+			return boundary;
+		}
+	}
+
+
+	HTTPMultipartBody::HTTPMultipartBody()
+		: HTTPMultipartBody(random_boundary())
+	{
+	}
+
+	HTTPMultipartBody::HTTPMultipartBody(std::string boundary)
+		: _boundary(std::move(boundary))
+	{
+		_closing = "--" + _boundary + "--\r\n";
+	}
+
+	void HTTPMultipartBody::add_field(std::string_view name, std::string_view value)
+	{
+		Part part;
+		part.preamble = make_preamble(name, "", HTTPContent::None, false);
+		part.source = PartSource::Memory;
+		part.value = std::string(value);
+		part.size = value.size();
+		_parts.push_back(std::move(part));
+	}
+
+	void HTTPMultipartBody::add_bytes(std::string_view name, std::string_view filename, HTTPContent content, std::span<const uint8_t> data)
+	{
+		Part part;
+		part.preamble = make_preamble(name, filename, content, true);
+		part.source = PartSource::Memory;
+		part.data = data;
+		part.size = data.size();
+		_parts.push_back(std::move(part));
+	}
+
+	HTTPErr HTTPMultipartBody::add_file(std::string_view name, const std::filesystem::path& file, HTTPContent content, std::string_view filename)
+	{
+		std::error_code fsError;
+		uint64_t size = std::filesystem::file_size(file, fsError);
+		if (fsError)
+		{
+			HTTP_LOG_WARN("Failed to stat multipart file: {}:{}", fsError.category().name(), fsError.value());
+			return HTTPErr::FileIOFailed;
+		}
+
+		std::string partFilename = filename.empty() ? file.filename().string() : std::string(filename);
+
+		Part part;
+		part.preamble = make_preamble(name, partFilename, content, true);
+		part.source = PartSource::File;
+		part.file = file;
+		part.size = size;
+		_parts.push_back(std::move(part));
+
+		return HTTPErr::None;
+	}
+
+	void HTTPMultipartBody::add_producer(std::string_view name, std::string_view filename, HTTPContent content, Producer producer, std::optional<uint64_t> size)
+	{
+		Part part;
+		part.preamble = make_preamble(name, filename, content, true);
+		part.source = PartSource::Producer;
+		part.producer = std::move(producer);
+		part.size = size;
+		_parts.push_back(std::move(part));
+	}
+
+	const std::string& HTTPMultipartBody::boundary() const
+	{
+		return _boundary;
+	}
+
+	std::string HTTPMultipartBody::content_type() const
+	{
+		return to_string(HTTPContent::MultipartFormData) + "; boundary=" + _boundary;
+	}
+
+	std::optional<uint64_t> HTTPMultipartBody::content_length() const
+	{
+		uint64_t length = _closing.size();
+
+		for (const auto& part : _parts)
+		{
+			if (!part.size.has_value())
+				return std::nullopt;
+
+			length += part.preamble.size() + *part.size + CRLF.size();
+		}
+
+		return length;
+	}
+
+	HTTPErr HTTPMultipartBody::write_to(HTTPSocket& socket) const
+	// Consecutive in-memory pieces go out as one gathered write, files and producers are streamed between them
+	{
+		const bool chunked = !content_length().has_value();
+
+		std::vector<asio::const_buffer> gathered;
+		size_t gatheredSize = 0;
+
+		char sizeLine[24];
+		asio::error_code ec;
+
+		auto chunk_header = [&](uint64_t size) -> asio::const_buffer
+			{
+				auto [end, errc] = std::to_chars(sizeLine, sizeLine + 16, size, 16);
+				*end++ = '\r';
+				*end++ = '\n';
+				return asio::buffer(sizeLine, static_cast<size_t>(end - sizeLine));
+			};
+
+		auto add = [&](const void* data, size_t size)
+			{
+				if (size == 0)
+					return;
+				gathered.push_back(asio::buffer(data, size));
+				gatheredSize += size;
+			};
+
+		auto flush = [&]() -> HTTPErr
+			{
+				if (gathered.empty())
+					return HTTPErr::None;
+
+				if (chunked)
+				{
+					gathered.insert(gathered.begin(), chunk_header(gatheredSize));
+					gathered.push_back(asio::buffer(CRLF));
+				}
+
+				asio::write(socket, gathered, ec);
+
+				gathered.clear();
+				gatheredSize = 0;
+
+				return to_http_err(ec, HTTPErr::SendFailed);
+			};
+
+		std::vector<uint8_t> produced;
+
+		for (const auto& part : _parts)
+		{
+			add(part.preamble.data(), part.preamble.size());
+
+			switch (part.source)
+			{
+			case PartSource::Memory:
+				if (!part.value.empty())
+					add(part.value.data(), part.value.size());
+				else
+					add(part.data.data(), part.data.size());
+				break;
+
+			case PartSource::File:
+			{
+				HTTPErr err = flush();
+				if (err != HTTPErr::None)
+					return err;
+
+				if (chunked)
+				{
+					asio::write(socket, chunk_header(*part.size), ec);
+					if (ec)
+						return to_http_err(ec, HTTPErr::SendFailed);
+				}
+
+				err = send_file_body(socket, part.file, *part.size);
+				if (err != HTTPErr::None)
+					return err;
+
+				if (chunked)
+				{
+					asio::write(socket, asio::buffer(CRLF), ec);
+					if (ec)
+						return to_http_err(ec, HTTPErr::SendFailed);
+				}
+				break;
+			}
+
+			case PartSource::Producer:
+			{
+				HTTPErr err = flush();
+				if (err != HTTPErr::None)
+					return err;
+
+				if (produced.empty())
+					produced.resize(FILE_IO_CHUNK_SIZE);
+
+				uint64_t total = 0;
+				while (true)
+				{
+					auto producedResult = part.producer(std::span<uint8_t>(produced));
+					if (!producedResult.has_value())
+						return producedResult.error();
+
+					size_t size = *producedResult;
+					if (size == 0)
+						break;
+
+					if (chunked)
+					{
+						std::array<asio::const_buffer, 3> block = { chunk_header(size), asio::buffer(produced.data(), size), asio::buffer(CRLF) };
+						asio::write(socket, block, ec);
+					}
+					else
+					{
+						asio::write(socket, asio::buffer(produced.data(), size), ec);
+					}
+
+					if (ec)
+						return to_http_err(ec, HTTPErr::SendFailed);
+
+					total += size;
+				}
+
+				if (part.size.has_value() && total != *part.size)
+				{
+					HTTP_LOG_WARN("Multipart producer wrote {} bytes, expected {}", total, *part.size);
+					return HTTPErr::InvalidContentSize;
+				}
+				break;
+			}
+			}
+
+			add(CRLF.data(), CRLF.size());
+		}
+
+		add(_closing.data(), _closing.size());
+
+		HTTPErr err = flush();
+		if (err != HTTPErr::None)
+			return err;
+
+		if (chunked)
+		{
+			asio::write(socket, asio::buffer(std::string_view("0\r\n\r\n")), ec);
+			if (ec)
+				return to_http_err(ec, HTTPErr::SendFailed);
+		}
+
+		return HTTPErr::None;
+	}
+
+	std::string HTTPMultipartBody::make_preamble(std::string_view name, std::string_view filename, HTTPContent content, bool hasContentType) const
+	{
+		std::string preamble = "--" + _boundary + "\r\nContent-Disposition: form-data; name=\"" + escape_disposition_value(name) + "\"";
+
+		if (!filename.empty())
+			preamble += "; filename=\"" + escape_disposition_value(filename) + "\"";
+
+		preamble += "\r\n";
+
+		if (hasContentType)
+		{
+			HTTPContent partContent = content == HTTPContent::None ? HTTPContent::ApplicationOctetStream : content;
+			preamble += "Content-Type: " + to_string(partContent) + "\r\n";
+		}
+
+		preamble += "\r\n";
+		return preamble;
+	}
+
+}
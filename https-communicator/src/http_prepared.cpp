@@ -0,0 +1,200 @@
+#include "headers.h"
+#include "http_prepared.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		bool has_line_break(std::string_view text)
+		{
+			return text.find_first_of("\r\n") != std::string_view::npos;
+		}
+
+		std::expected<HTTPOutput, HTTPErr> send_prepared(const HTTPPreparedRequest& request, asio::const_buffer body, HTTPSocket* socket, const HTTPSocketOptions& socketOptions)
+		{
+			HTTPTiming timing;
+			HTTP_TIMING_MARK(&timing, start);
+
+			if (!request.accepts_body_size(body.size()))
+			{
+				return std::unexpected(HTTPErr::NoBodyForMethod);
+			}
+
+			HTTPPreparedRequest::LengthLine lengthLine = request.length_line(body.size());
+
+			asio::io_context ioContext;
+			std::optional<HTTPSocket> ownedSocket;
+
+			HTTP_TIMING_SET(&timing, connectionReused, socket && socket->is_open());
+
+			if (!(socket && socket->is_open()))
+			{
+				auto socketResult = create_and_connect_socket(ioContext, request.host(), request.port(), 10, &timing, socketOptions);
+				if (!socketResult.has_value())
+				{
+					return std::unexpected(socketResult.error());
+				}
+
+				ownedSocket.emplace(std::move(*socketResult));
+				socket = &*ownedSocket;
+			}
+
+			std::array<asio::const_buffer, 3> buffers = { asio::buffer(request.head()), asio::buffer(lengthLine.view()), body };
+
+			HTTPStream stream(*socket);
+
+			asio::error_code ec;
+			asio::write(stream, buffers, ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error sending prepared HTTP request: {}:{}", ec.category().name(), ec.value());
+				return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+			}
+
+			HTTP_TIMING_ADD(&timing, bytesSent, request.head().size() + lengthLine.size + body.size());
+			HTTP_TIMING_MARK(&timing, requestSent);
+
+			HTTP_LOG_DEBUG("Prepared request sent: {}{}<{} body bytes>", request.head(), lengthLine.view(), body.size());
+
+			return read_http_response(stream, &timing);
+		}
+	}
+
+
+	// --- HTTPPreparedRequest Implementation ---
+
+	std::expected<HTTPPreparedRequest, HTTPErr> HTTPPreparedRequest::prepare(
+		HTTPMethod method,
+		HTTPContent content,
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::unordered_map<std::string, std::string>& headers,
+		HTTPConnection connection,
+		const HTTPHeaderBlock* defaultHeaders)
+	{
+		if (has_line_break(host) || has_line_break(path) || path.find(' ') != std::string_view::npos)
+		{
+			return std::unexpected(HTTPErr::InvalidURL);
+		}
+
+		for (const auto& header : headers)
+		{
+			if (header.first.empty() || has_line_break(header.first) || has_line_break(header.second))
+			{
+				HTTP_LOG_WARN("Refusing to prepare a request with header: {}", header.first);
+				return std::unexpected(HTTPErr::InvalidHeader);
+			}
+		}
+
+		HTTPPreparedRequest request;
+		request._host = host;
+		request._port = port;
+		request._method = method;
+		request._connection = connection;
+		request._requiresBody = method == HTTPMethod::POST || method == HTTPMethod::PUT;
+
+		std::string& head = request._head;
+
+		head.append(to_string(method)).append(" ");
+		if (path.empty() || (path.front() != '/' && !path.starts_with("http://")))
+			head.append("/");
+		head.append(path).append(" HTTP/1.1\r\n");
+		head.append("Host: ");
+		append_host(host, head);
+		head.append("\r\n");
+
+		if (defaultHeaders)
+			defaultHeaders->append_to(head, headers);
+
+		for (const auto& header : headers)
+		{
+			head.append(header.first).append(": ").append(header.second).append("\r\n");
+		}
+
+		head.append("Connection: ").append(to_string(connection)).append("\r\n");
+
+		bool explicitContentType = has_header(headers, "Content-Type") || (defaultHeaders && defaultHeaders->contains("Content-Type"));
+		if (!explicitContentType && (content != HTTPContent::None || request._requiresBody))
+			head.append("Content-Type: ").append(to_string(content)).append("\r\n");
+
+		// Validated once here, sending only appends the length line and the body
+		HTTPErr err = is_valid_http_request(head + "\r\n");
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		head.shrink_to_fit();
+		return request;
+	}
+
+	HTTPPreparedRequest::LengthLine HTTPPreparedRequest::length_line(uint64_t contentLength) const
+	{
+		LengthLine line;
+
+		if (contentLength == 0 && !_requiresBody)
+		{
+			line.data[0] = '\r';
+			line.data[1] = '\n';
+			line.size = 2;
+			return line;
+		}
+
+		constexpr std::string_view name = "Content-Length: ";
+		char* out = std::copy(name.begin(), name.end(), line.data.data());
+		out = std::to_chars(out, line.data.data() + line.data.size(), contentLength).ptr;
+		out = std::copy_n("\r\n\r\n", 4, out);
+
+		line.size = static_cast<size_t>(out - line.data.data());
+		return line;
+	}
+
+	bool HTTPPreparedRequest::accepts_body_size(uint64_t contentLength) const
+	{
+		return contentLength > 0 || !_requiresBody;
+	}
+
+	std::string_view HTTPPreparedRequest::head() const
+	{
+		return _head;
+	}
+
+	std::string_view HTTPPreparedRequest::host() const
+	{
+		return _host;
+	}
+
+	std::string_view HTTPPreparedRequest::port() const
+	{
+		return _port;
+	}
+
+	HTTPMethod HTTPPreparedRequest::method() const
+	{
+		return _method;
+	}
+
+	HTTPConnection HTTPPreparedRequest::connection() const
+	{
+		return _connection;
+	}
+
+
+	// --- Prepared Request Sending Methods ---
+
+	std::expected<HTTPOutput, HTTPErr> send_prepared_request(const HTTPPreparedRequest& request, std::string_view body, HTTPSocket* socket, const HTTPSocketOptions& socketOptions)
+	{
+		return send_prepared(request, asio::buffer(body), socket, socketOptions);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> send_prepared_request(const HTTPPreparedRequest& request, const std::vector<uint8_t>& body, HTTPSocket* socket, const HTTPSocketOptions& socketOptions)
+	{
+		return send_prepared(request, asio::buffer(body), socket, socketOptions);
+	}
+
+}
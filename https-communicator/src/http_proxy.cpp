@@ -0,0 +1,103 @@
+#include "headers.h"
+#include "http_proxy.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		bool forwarding(const HTTPProxy& proxy)
+		{
+			return proxy.enabled() && proxy.mode == HTTPProxyMode::Forward;
+		}
+	}
+
+
+	// --- Proxy Methods ---
+
+	HTTPErr open_proxy_tunnel(HTTPSocket& socket, std::string_view host, std::string_view port, const HTTPProxy& proxy)
+	{
+		std::string authority;
+		append_host(host, authority);
+		authority.append(":").append(port.empty() ? "80" : port);
+
+		std::string request;
+		request.reserve(authority.size() * 2 + proxy.authorization.size() + 64);
+		request.append("CONNECT ").append(authority).append(" HTTP/1.1\r\n");
+		request.append("Host: ").append(authority).append("\r\n");
+		if (!proxy.authorization.empty())
+			request.append("Proxy-Authorization: ").append(proxy.authorization).append("\r\n");
+		request.append("\r\n");
+
+		HTTPStream stream(socket);
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(request), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending CONNECT to proxy {}:{}: {}:{}", proxy.host, proxy.port, ec.category().name(), ec.value());
+			return to_http_err(ec, HTTPErr::SendFailed);
+		}
+
+		asio::streambuf responseBuffer;
+		// Any answer but 200 comes back as ResponseError, the proxy refused or could not reach the origin
+		auto head = read_http_head(stream, responseBuffer);
+		if (!head.has_value())
+		{
+			if (head.error() != HTTPErr::ResponseError)
+				return head.error();
+
+			HTTP_LOG_WARN("Proxy {}:{} refused CONNECT {}.", proxy.host, proxy.port, authority);
+			return HTTPErr::ProxyConnectFailed;
+		}
+
+		// Nothing may follow the answer before the first request, the origin has not been spoken to yet
+		if (responseBuffer.size() != 0)
+		{
+			HTTP_LOG_WARN("Proxy {}:{} sent {} bytes after accepting CONNECT.", proxy.host, proxy.port, responseBuffer.size());
+			return HTTPErr::ProxyConnectFailed;
+		}
+
+		HTTP_LOG_DEBUG("Tunnel to {} open through proxy {}:{}.", authority, proxy.host, proxy.port);
+		return HTTPErr::None;
+	}
+
+	std::string_view proxy_request_target(
+		std::string_view host,
+		std::string_view port,
+		std::string_view path,
+		const HTTPProxy& proxy,
+		std::string& buffer)
+	{
+		if (!forwarding(proxy))
+			return path;
+
+		buffer.clear();
+		buffer.append("http://");
+		append_host(host, buffer);
+		if (!port.empty() && port != "80")
+			buffer.append(":").append(port);
+		if (path.empty() || path.front() != '/')
+			buffer.append("/");
+		buffer.append(path);
+
+		return buffer;
+	}
+
+	const std::unordered_map<std::string, std::string>& proxy_request_headers(
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPProxy& proxy,
+		std::unordered_map<std::string, std::string>& buffer)
+	{
+		if (!forwarding(proxy) || proxy.authorization.empty() || has_header(headers, "Proxy-Authorization"))
+			return headers;
+
+		buffer = headers;
+		buffer.emplace("Proxy-Authorization", proxy.authorization);
+		return buffer;
+	}
+
+}
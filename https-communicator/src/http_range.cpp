@@ -0,0 +1,817 @@
+#include "headers.h"
+#include "http_range.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		size_t segment_count(uint64_t total, uint64_t segmentSize)
+		{
+			return static_cast<size_t>((total + segmentSize - 1) / segmentSize);
+		}
+
+		std::string range_validator(const HTTPOutput& head)
+		// If-Range takes a strong ETag or a date, a weak ETag never matches
+		{
+			if (!head.etag.empty() && !head.etag.starts_with("W/"))
+				return head.etag;
+			return head.lastModified;
+		}
+
+
+		class SegmentTarget
+		// Where the segments land, each at its own offset: a preallocated buffer or the part file
+		{
+		public:
+
+			SegmentTarget() = default;
+
+			~SegmentTarget() { close(); }
+
+			SegmentTarget(const SegmentTarget&) = delete;
+			SegmentTarget& operator=(const SegmentTarget&) = delete;
+
+			void use_memory(std::vector<uint8_t>& memory)
+			{
+				_memory = memory.data();
+			}
+
+			HTTPErr open_file(const std::filesystem::path& path, uint64_t size, bool keep)
+			{
+#if defined(__linux__)
+				_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (keep ? 0 : O_TRUNC), 0644);
+				if (_fd < 0)
+				{
+					HTTP_LOG_WARN("Failed to open download file: {}", path.string());
+					return HTTPErr::FileIOFailed;
+				}
+
+				// Reserved up front, so segments arriving out of order never extend the file
+				if (fallocate(_fd, 0, 0, static_cast<off_t>(size)) != 0 && (errno == ENOSPC || ftruncate(_fd, static_cast<off_t>(size)) != 0))
+				{
+					close();
+					return HTTPErr::FileIOFailed;
+				}
+#else
+				if (!keep || !std::filesystem::exists(path))
+					std::ofstream create(path, std::ios::binary | std::ios::trunc);
+
+				std::error_code ec;
+				std::filesystem::resize_file(path, size, ec);
+
+				_stream.open(path, std::ios::binary | std::ios::in | std::ios::out);
+				if (ec || !_stream)
+				{
+					HTTP_LOG_WARN("Failed to open download file: {}", path.string());
+					return HTTPErr::FileIOFailed;
+				}
+#endif
+
+				return HTTPErr::None;
+			}
+
+			std::span<uint8_t> direct(uint64_t offset, uint64_t length)
+			// The destination itself when segments go to memory, so they are read into place without a copy
+			{
+				if (!_memory)
+					return {};
+				return std::span<uint8_t>(_memory + offset, static_cast<size_t>(length));
+			}
+
+			HTTPErr write(uint64_t offset, std::span<const uint8_t> data)
+			{
+				if (_memory)
+				{
+					std::memcpy(_memory + offset, data.data(), data.size());
+					return HTTPErr::None;
+				}
+
+#if defined(__linux__)
+				while (!data.empty())
+				{
+					ssize_t written = pwrite(_fd, data.data(), data.size(), static_cast<off_t>(offset));
+					if (written < 0)
+					{
+						if (errno == EINTR)
+							continue;
+						return HTTPErr::FileIOFailed;
+					}
+
+					data = data.subspan(static_cast<size_t>(written));
+					offset += static_cast<uint64_t>(written);
+				}
+#else
+				std::lock_guard lock(_mutex);
+				_stream.seekp(static_cast<std::streamoff>(offset));
+				_stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+				if (!_stream)
+					return HTTPErr::FileIOFailed;
+#endif
+
+				return HTTPErr::None;
+			}
+
+			HTTPErr close()
+			{
+				HTTPErr err = HTTPErr::None;
+#if defined(__linux__)
+				if (_fd >= 0 && ::close(_fd) != 0)
+					err = HTTPErr::FileIOFailed;
+				_fd = -1;
+#else
+				if (_stream.is_open())
+				{
+					_stream.close();
+					if (_stream.fail())
+						err = HTTPErr::FileIOFailed;
+				}
+#endif
+				return err;
+			}
+
+		private:
+
+			uint8_t* _memory = nullptr;
+
+#if defined(__linux__)
+			int _fd = -1;
+#else
+			std::mutex _mutex;
+			std::fstream _stream;
+#endif
+		};
+
+
+		class SegmentJournal
+		// "<total> <segmentSize>", the validator on its own line, then the index of every segment written so far
+		{
+		public:
+
+			bool load(const std::filesystem::path& path, uint64_t segmentSize)
+			{
+				std::ifstream in(path);
+
+				uint64_t total = 0;
+				uint64_t size = 0;
+				if (!(in >> total >> size) || size != segmentSize || total == 0)
+					return false;
+
+				in >> std::ws;
+				std::getline(in, _validator);
+				if (_validator.empty())
+					return false;
+
+				_total = total;
+				_done.assign(segment_count(total, segmentSize), false);
+
+				size_t index = 0;
+				while (in >> index)
+				{
+					if (index < _done.size())
+						_done[index] = true;
+				}
+
+				return true;
+			}
+
+			HTTPErr open(const std::filesystem::path& path, uint64_t total, uint64_t segmentSize, const std::string& validator, bool keep)
+			{
+				if (!keep)
+				{
+					_total = total;
+					_validator = validator;
+					_done.assign(segment_count(total, segmentSize), false);
+
+					std::ofstream out(path, std::ios::trunc);
+					out << total << ' ' << segmentSize << '\n' << validator << '\n';
+					if (!out)
+						return HTTPErr::FileIOFailed;
+				}
+
+				_stream.open(path, std::ios::app);
+				return _stream ? HTTPErr::None : HTTPErr::FileIOFailed;
+			}
+
+			void mark(size_t index)
+			// Called once the segment's bytes are written, so a listed segment is always whole
+			{
+				std::lock_guard lock(_mutex);
+				_done[index] = true;
+
+				if (_stream.is_open())
+				{
+					_stream << index << '\n';
+					_stream.flush();
+				}
+			}
+
+			bool done(size_t index) const
+			{
+				return index < _done.size() && _done[index];
+			}
+
+			size_t first_missing() const // 0 as well when every segment is done, the first one then probes again
+			{
+				auto it = std::find(_done.begin(), _done.end(), false);
+				return it == _done.end() ? 0 : static_cast<size_t>(it - _done.begin());
+			}
+
+			uint64_t total() const { return _total; }
+
+			const std::string& validator() const { return _validator; }
+
+			void close() { _stream.close(); }
+
+		private:
+
+			uint64_t _total = 0;
+			std::string _validator;
+			std::vector<bool> _done;
+
+			std::mutex _mutex;
+			std::ofstream _stream;
+		};
+
+
+		struct SegmentConnection
+		// One worker's kept-alive connection
+		{
+			asio::io_context ioContext;
+			std::optional<HTTPSocket> socket;
+			std::vector<uint8_t> chunk; // Staging for segments going to a file
+
+			void drop()
+			{
+				if (!socket)
+					return;
+
+				asio::error_code ignored;
+				socket->close(ignored);
+				socket.reset();
+			}
+		};
+
+
+		struct SegmentedDownload
+		{
+			std::string host;
+			std::string port;
+			std::string target; // Absolute form when a forward proxy carries the requests
+			std::unordered_map<std::string, std::string> headers;
+			const HTTPHeaderBlock* defaultHeaders = nullptr;
+			HTTPSocketOptions socketOptions;
+			HTTPSegmentOptions options;
+
+			uint64_t total = 0;
+			std::string validator; // Sent as If-Range, a changed resource then comes back whole instead of mixing versions
+
+			SegmentTarget output;
+			SegmentJournal* journal = nullptr;
+
+			std::mutex mutex; // Guards the queue below, the workers share it
+			std::deque<size_t> pending;
+			std::vector<size_t> attempts;
+			HTTPErr failure = HTTPErr::None;
+
+			SegmentedDownload(
+				std::string_view host,
+				std::string_view path,
+				std::string_view port,
+				const HTTPSegmentOptions& options,
+				const std::unordered_map<std::string, std::string>& headers,
+				const HTTPHeaderBlock* defaultHeaders,
+				const HTTPSocketOptions& socketOptions)
+				: host(host), port(port), defaultHeaders(defaultHeaders), socketOptions(socketOptions), options(options)
+			{
+				std::string proxiedTarget;
+				std::unordered_map<std::string, std::string> proxiedHeaders;
+				target = proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget);
+				this->headers = proxy_request_headers(headers, socketOptions.proxy, proxiedHeaders);
+			}
+
+			uint64_t first_byte(size_t index) const { return static_cast<uint64_t>(index) * options.segmentSize; }
+
+			uint64_t last_byte(size_t index) const { return std::min(total, first_byte(index) + options.segmentSize) - 1; }
+		};
+
+
+		std::expected<HTTPOutput, HTTPErr> request_range(
+			SegmentedDownload& download,
+			SegmentConnection& connection,
+			uint64_t first,
+			uint64_t last,
+			asio::streambuf& responseBuffer)
+		{
+			if (!connection.socket)
+			{
+				auto socketResult = create_and_connect_socket(
+					connection.ioContext, download.host, download.port, download.options.connectTimeout, nullptr, download.socketOptions);
+				if (!socketResult.has_value())
+				{
+					return std::unexpected(socketResult.error());
+				}
+
+				connection.socket.emplace(std::move(*socketResult));
+			}
+
+			auto headers = download.headers;
+			headers["Range"] = std::format("bytes={}-{}", first, last);
+			if (!download.validator.empty())
+				headers["If-Range"] = download.validator;
+
+			auto requestResult = write_str_request(
+				HTTPMethod::GET, HTTPContent::None, HTTPConnection::Persistent, download.host, download.target, "", headers, download.defaultHeaders);
+			if (!requestResult.has_value())
+			{
+				return std::unexpected(requestResult.error());
+			}
+
+			HTTPStream stream(*connection.socket);
+
+			asio::error_code ec;
+			asio::write(stream, asio::buffer(*requestResult), ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error sending range request: {}:{}", ec.category().name(), ec.value());
+				connection.drop();
+				return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+			}
+
+			auto head = read_http_head(stream, responseBuffer);
+			if (!head.has_value())
+			{
+				connection.drop();
+			}
+
+			return head;
+		}
+
+		HTTPErr accept_range(const SegmentedDownload& download, const HTTPOutput& head, uint64_t first, uint64_t last)
+		{
+			// A 200 to a request with If-Range means the validator no longer matches, the new version follows in full
+			if (head.statusCode != 206)
+				return HTTPErr::ResourceChanged;
+
+			uint64_t rangeFirst = 0;
+			uint64_t rangeLast = 0;
+			uint64_t rangeTotal = 0;
+			if (!parse_content_range(head.contentRange, rangeFirst, rangeLast, rangeTotal))
+				return HTTPErr::InvalidContentRange;
+
+			if (rangeTotal != download.total)
+				return HTTPErr::ResourceChanged;
+
+			if (rangeFirst != first || rangeLast != last)
+				return HTTPErr::InvalidContentRange;
+
+			if (head.transferEncoding == HTTPTransferEncoding::Chunked)
+				return HTTPErr::ChunkedEncodingNotSupported;
+
+			if (head.contentLength != last - first + 1)
+				return HTTPErr::InvalidContentLength;
+
+			return HTTPErr::None;
+		}
+
+		HTTPErr read_range_body(
+			HTTPStream& stream,
+			asio::streambuf& responseBuffer,
+			SegmentTarget& output,
+			uint64_t offset,
+			uint64_t length,
+			std::vector<uint8_t>& chunk)
+		{
+			size_t buffered = static_cast<size_t>(std::min<uint64_t>(responseBuffer.size(), length));
+			if (buffered > 0)
+			{
+				HTTPErr err = output.write(offset, std::span<const uint8_t>(static_cast<const uint8_t*>(responseBuffer.data().data()), buffered));
+				if (err != HTTPErr::None)
+					return err;
+
+				responseBuffer.consume(buffered);
+				offset += buffered;
+				length -= buffered;
+			}
+
+			while (length > 0)
+			{
+				asio::error_code ec;
+
+				std::span<uint8_t> direct = output.direct(offset, length);
+				if (!direct.empty())
+				{
+					asio::read(stream, asio::buffer(direct.data(), direct.size()), ec);
+					return ec ? to_http_err(ec, HTTPErr::ReceiveFailed) : HTTPErr::None;
+				}
+
+				if (chunk.empty())
+					chunk.resize(FILE_IO_CHUNK_SIZE);
+
+				size_t received = stream.read_some(asio::buffer(chunk.data(), static_cast<size_t>(std::min<uint64_t>(length, chunk.size()))), ec);
+				if (ec)
+				{
+					HTTP_LOG_WARN("Error reading range body: {}:{}", ec.category().name(), ec.value());
+					return to_http_err(ec, HTTPErr::ReceiveFailed);
+				}
+
+				HTTPErr err = output.write(offset, std::span<const uint8_t>(chunk.data(), received));
+				if (err != HTTPErr::None)
+					return err;
+
+				offset += received;
+				length -= received;
+			}
+
+			return HTTPErr::None;
+		}
+
+		HTTPErr receive_segment(SegmentedDownload& download, SegmentConnection& connection, const HTTPOutput& head, size_t index, asio::streambuf& responseBuffer)
+		// Checks the answer against the segment asked for and reads its body into place
+		{
+			uint64_t first = download.first_byte(index);
+			uint64_t last = download.last_byte(index);
+
+			HTTPErr err = accept_range(download, head, first, last);
+			if (err == HTTPErr::None)
+			{
+				HTTPStream stream(*connection.socket);
+				err = read_range_body(stream, responseBuffer, download.output, first, last - first + 1, connection.chunk);
+			}
+
+			// A rejected answer still has its body on the connection
+			if (err != HTTPErr::None || head.connection == HTTPConnection::Close)
+				connection.drop();
+
+			return err;
+		}
+
+		HTTPErr fetch_segment(SegmentedDownload& download, SegmentConnection& connection, size_t index)
+		{
+			asio::streambuf responseBuffer;
+
+			auto head = request_range(download, connection, download.first_byte(index), download.last_byte(index), responseBuffer);
+			if (!head.has_value())
+			{
+				return head.error();
+			}
+
+			return receive_segment(download, connection, *head, index, responseBuffer);
+		}
+
+		bool requeue(SegmentedDownload& download, size_t index, HTTPErr err)
+		// Callers hold the mutex. False once the segment is out of attempts, the whole download then fails with err
+		{
+			if (err != HTTPErr::ResourceChanged && ++download.attempts[index] < download.options.attempts)
+			{
+				HTTP_LOG_INFO("Segment {} failed: {}, fetching it again.", index, to_string(err));
+				download.pending.push_back(index);
+				return true;
+			}
+
+			if (download.failure == HTTPErr::None)
+			{
+				HTTP_LOG_WARN("Segment {} failed: {}, giving up on the download.", index, to_string(err));
+				download.failure = err;
+			}
+
+			return false;
+		}
+
+		void run_segments(SegmentedDownload& download, SegmentConnection& connection)
+		// One worker: takes segments off the queue until it is empty or the download failed
+		{
+			while (true)
+			{
+				size_t index = 0;
+				{
+					std::lock_guard lock(download.mutex);
+					if (download.failure != HTTPErr::None || download.pending.empty())
+						return;
+
+					index = download.pending.front();
+					download.pending.pop_front();
+				}
+
+				HTTPErr err = fetch_segment(download, connection, index);
+				if (err == HTTPErr::None)
+				{
+					if (download.journal)
+						download.journal->mark(index);
+					continue;
+				}
+
+				std::lock_guard lock(download.mutex);
+				requeue(download, index, err);
+			}
+		}
+
+		HTTPErr start_segments(SegmentedDownload& download, const HTTPOutput& head, size_t index)
+		// Learns the size and validator from the first 206
+		{
+			uint64_t first = 0;
+			uint64_t last = 0;
+			if (!parse_content_range(head.contentRange, first, last, download.total) || first != download.first_byte(index))
+			{
+				HTTP_LOG_WARN("Unusable Content-Range on the first segment: {}", head.contentRange);
+				return HTTPErr::InvalidContentRange;
+			}
+
+			download.validator = range_validator(head);
+			download.attempts.assign(segment_count(download.total, download.options.segmentSize), 0);
+
+			return HTTPErr::None;
+		}
+
+		HTTPErr finish_segments(SegmentedDownload& download, SegmentConnection& connection, size_t index, HTTPErr probeErr)
+		// Queues every segment still missing and fetches them over parallel connections.
+		// The probing connection is kept, the calling thread goes on working with it
+		{
+			for (size_t i = 0; i < download.attempts.size(); i++)
+			{
+				if (i != index && !(download.journal && download.journal->done(i)))
+					download.pending.push_back(i);
+			}
+
+			if (probeErr == HTTPErr::None)
+			{
+				if (download.journal)
+					download.journal->mark(index);
+			}
+			else if (!requeue(download, index, probeErr))
+			{
+				return probeErr;
+			}
+
+			size_t workers = std::min(std::max<size_t>(download.options.connections, 1), download.pending.size());
+
+			std::vector<std::thread> threads;
+			threads.reserve(workers);
+			for (size_t i = 1; i < workers; i++)
+			{
+				threads.emplace_back([&download]()
+					{
+						SegmentConnection connection;
+						run_segments(download, connection);
+					});
+			}
+
+			run_segments(download, connection);
+
+			for (auto& thread : threads)
+				thread.join();
+
+			return download.failure;
+		}
+	}
+
+
+	// --- Segmented Download Methods ---
+
+	std::expected<std::vector<uint8_t>, HTTPErr> get_bytes_segmented(std::string_view url, const HTTPSegmentOptions& options, const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
+		{
+			return std::unexpected(outputResult.error());
+		}
+
+		return get_bytes_segmented(outputResult->host, outputResult->target, outputResult->port, options, headers, nullptr, socket_options_for(*outputResult));
+	}
+
+	std::expected<std::vector<uint8_t>, HTTPErr> get_bytes_segmented(
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPSegmentOptions& options,
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
+	{
+		if (options.segmentSize == 0)
+		{
+			return std::unexpected(HTTPErr::InvalidContentSize);
+		}
+
+		SegmentedDownload download(host, path, port, options, headers, defaultHeaders, socketOptions);
+		SegmentConnection connection;
+
+		asio::streambuf responseBuffer;
+		auto head = request_range(download, connection, 0, options.segmentSize - 1, responseBuffer);
+		if (!head.has_value())
+		{
+			return std::unexpected(head.error());
+		}
+
+		std::vector<uint8_t> body;
+
+		if (head->statusCode != 206)
+		{
+			HTTP_LOG_INFO("{}:{} ignored the Range request, reading the body in one piece.", host, port);
+
+			HTTPStream stream(*connection.socket);
+			HTTPErr err = read_body_to_bytes(stream, responseBuffer, *head, body);
+			if (err != HTTPErr::None)
+			{
+				return std::unexpected(err);
+			}
+
+			return body;
+		}
+
+		HTTPErr err = start_segments(download, *head, 0);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		body.resize(static_cast<size_t>(download.total));
+		download.output.use_memory(body);
+
+		err = finish_segments(download, connection, 0, receive_segment(download, connection, *head, 0, responseBuffer));
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		HTTP_LOG_DEBUG("Segmented download of {} bytes from {}:{} finished.", download.total, host, port);
+		return body;
+	}
+
+	HTTPErr get_to_file_segmented(
+		std::string_view url,
+		const std::filesystem::path& file,
+		const HTTPSegmentOptions& options,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
+		return get_to_file_segmented(outputResult->host, outputResult->target, outputResult->port, file, options, headers, nullptr, socket_options_for(*outputResult));
+	}
+
+	HTTPErr get_to_file_segmented(
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const std::filesystem::path& file,
+		const HTTPSegmentOptions& options,
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
+	{
+		if (options.segmentSize == 0)
+		{
+			return HTTPErr::InvalidContentSize;
+		}
+
+		std::filesystem::path partPath = file;
+		partPath += ".part";
+		std::filesystem::path journalPath = file;
+		journalPath += ".ranges";
+
+		SegmentJournal journal;
+		bool resuming = options.resume && journal.load(journalPath, options.segmentSize) && std::filesystem::exists(partPath);
+		size_t index = resuming ? journal.first_missing() : 0;
+
+		SegmentedDownload download(host, path, port, options, headers, defaultHeaders, socketOptions);
+		SegmentConnection connection;
+
+		asio::streambuf responseBuffer;
+		auto head = request_range(download, connection, download.first_byte(index), download.first_byte(index) + options.segmentSize - 1, responseBuffer);
+
+		// A resource that shrank answers 416 past its new end
+		if (!head.has_value() && resuming && head.error() == HTTPErr::ResponseError)
+		{
+			HTTP_LOG_INFO("{} no longer matches the partial download, starting over.", file.string());
+
+			resuming = false;
+			index = 0;
+			responseBuffer.consume(responseBuffer.size());
+			head = request_range(download, connection, 0, options.segmentSize - 1, responseBuffer);
+		}
+
+		if (!head.has_value())
+		{
+			return head.error();
+		}
+
+		if (head->statusCode != 206)
+		{
+			HTTP_LOG_INFO("{}:{} ignored the Range request, reading the body in one piece.", host, port);
+
+			HTTPFileSink sink;
+			HTTPErr err = sink.open(file, {}, head->contentLength);
+			if (err == HTTPErr::None)
+			{
+				HTTPStream stream(*connection.socket);
+				err = read_body_to_file(stream, responseBuffer, *head, sink);
+			}
+
+			err = err == HTTPErr::None ? sink.commit() : err;
+			if (err != HTTPErr::None)
+			{
+				sink.abort();
+				return err;
+			}
+
+			std::error_code ec;
+			std::filesystem::remove(journalPath, ec);
+			return HTTPErr::None;
+		}
+
+		HTTPErr err = start_segments(download, *head, index);
+		if (err != HTTPErr::None)
+		{
+			return err;
+		}
+
+		if (resuming && (journal.total() != download.total || journal.validator() != download.validator))
+		{
+			HTTP_LOG_INFO("{} changed since the partial download, starting over.", file.string());
+			resuming = false;
+		}
+
+		// Without a validator a later run could not tell whether the resource changed, so nothing is kept to resume from
+		bool journaled = options.resume && !download.validator.empty();
+
+		err = download.output.open_file(partPath, download.total, resuming);
+		if (err == HTTPErr::None && journaled)
+		{
+			err = journal.open(journalPath, download.total, options.segmentSize, download.validator, resuming);
+			download.journal = &journal;
+		}
+
+		if (err == HTTPErr::None)
+		{
+			if (resuming)
+				HTTP_LOG_INFO("Resuming {} from segment {}.", file.string(), index);
+
+			err = finish_segments(download, connection, index, receive_segment(download, connection, *head, index, responseBuffer));
+		}
+
+		HTTPErr closeErr = download.output.close();
+		err = err == HTTPErr::None ? closeErr : err;
+		journal.close();
+
+		std::error_code ec;
+
+		if (err != HTTPErr::None)
+		{
+			if (!journaled)
+				std::filesystem::remove(partPath, ec);
+			return err;
+		}
+
+		std::filesystem::rename(partPath, file, ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Failed to move {} into place: {}", partPath.string(), ec.message());
+			return HTTPErr::FileIOFailed;
+		}
+
+		std::filesystem::remove(journalPath, ec);
+
+		HTTP_LOG_DEBUG("Segmented download of {} bytes into {} finished.", download.total, file.string());
+		return HTTPErr::None;
+	}
+
+	bool parse_content_range(std::string_view value, uint64_t& first, uint64_t& last, uint64_t& total)
+	{
+		if (!value.starts_with("bytes "))
+			return false;
+		value.remove_prefix(6);
+
+		auto parse = [&](char end, uint64_t& out)
+			{
+				size_t pos = end ? value.find(end) : value.size();
+				if (pos == std::string_view::npos || pos == 0)
+					return false;
+
+				auto [ptr, errc] = std::from_chars(value.data(), value.data() + pos, out);
+				if (errc != std::errc() || ptr != value.data() + pos)
+					return false;
+
+				value.remove_prefix(end ? pos + 1 : pos);
+				return true;
+			};
+
+		return parse('-', first) && parse('/', last) && parse('\0', total) && first <= last && last < total;
+	}
+
+}
@@ -0,0 +1,1072 @@
+#include "headers.h"
+#include "http_runtime.h"
+#include "http_logger.h"
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		thread_local HTTPRuntimeShard* currentShard = nullptr;
+
+		std::vector<int> usable_cpus()
+		// The CPUs this process may run on, in ascending order
+		{
+			std::vector<int> cpus;
+
+#ifdef PLATFORM_WINDOWS
+			DWORD_PTR processMask = 0;
+			DWORD_PTR systemMask = 0;
+			if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+			{
+				for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); cpu++)
+				{
+					if (processMask & (static_cast<DWORD_PTR>(1) << cpu))
+						cpus.push_back(cpu);
+				}
+			}
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			if (sched_getaffinity(0, sizeof(set), &set) == 0)
+			{
+				for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				{
+					if (CPU_ISSET(cpu, &set))
+						cpus.push_back(cpu);
+				}
+			}
+#endif
+
+			return cpus;
+		}
+
+		int numa_node_of(int cpu)
+		{
+#ifdef PLATFORM_WINDOWS
+			UCHAR node = 0;
+			if (cpu <= UCHAR_MAX && GetNumaProcessorNode(static_cast<UCHAR>(cpu), &node) && node != 0xFF)
+				return node;
+#elif defined(__linux__)
+			// The kernel links each CPU to its node as /sys/devices/system/cpu/cpuN/nodeM
+			std::error_code ec;
+			for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec))
+			{
+				std::string name = entry.path().filename().string();
+				if (!name.starts_with("node"))
+					continue;
+
+				int node = -1;
+				auto [end, errc] = std::from_chars(name.data() + 4, name.data() + name.size(), node);
+				if (errc == std::errc() && end == name.data() + name.size())
+					return node;
+			}
+#endif
+			return -1;
+		}
+
+		bool pin_current_thread(int cpu)
+		{
+#ifdef PLATFORM_WINDOWS
+			if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+				return false;
+			return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+			return false;
+#endif
+		}
+
+		std::expected<URLDescriptorOutput, HTTPErr> decrypt_pooled_url(std::string_view url)
+		{
+			auto target = decrypt_url_http(url);
+
+			// Pools are keyed by host and port, which every http+unix URL shares. HTTPRuntimeOptions::socket routes a whole runtime instead
+			if (target.has_value() && !target->socketPath.empty())
+			{
+				HTTP_LOG_WARN("The runtime does not take http+unix URLs: {}", url);
+				return std::unexpected(HTTPErr::InvalidURL);
+			}
+
+			return target;
+		}
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> ready(std::expected<HTTPOutput, HTTPErr> result)
+		{
+			std::promise<std::expected<HTTPOutput, HTTPErr>> promise;
+			promise.set_value(std::move(result));
+			return promise.get_future();
+		}
+
+		std::expected<HTTPBatchJob, HTTPErr> make_job(
+			size_t index,
+			HTTPMethod method,
+			HTTPContent content,
+			URLDescriptorOutput& target,
+			const std::unordered_map<std::string, std::string>& headers,
+			const HTTPProxy& proxy,
+			std::string_view body,
+			std::optional<uint64_t> separateLength = std::nullopt)
+			// With separateLength only the head is serialized, the body of that length is sent after it
+		{
+			std::string proxiedTarget;
+			std::unordered_map<std::string, std::string> proxiedHeaders;
+			std::string_view path = proxy_request_target(target.host, target.port, target.path, proxy, proxiedTarget);
+			const auto& requestHeaders = proxy_request_headers(headers, proxy, proxiedHeaders);
+
+			auto serialized = separateLength
+				? write_str_request(method, content, HTTPConnection::Persistent, target.host, path, separateLength, requestHeaders)
+				: write_str_request(method, content, HTTPConnection::Persistent, target.host, path, body, requestHeaders);
+			if (!serialized.has_value())
+				return std::unexpected(serialized.error());
+
+			return HTTPBatchJob{ index, std::move(target.host), std::move(target.port), std::move(*serialized), method };
+		}
+
+		std::future<std::expected<HTTPOutput, HTTPErr>> start_on(HTTPRuntimeShard& shard, HTTPBatchJob job, std::vector<uint8_t> body = {})
+		{
+			auto promise = std::make_shared<std::promise<std::expected<HTTPOutput, HTTPErr>>>();
+			auto future = promise->get_future();
+
+			asio::post(shard.io_context(), [&shard, job = std::move(job), body = std::move(body), promise]() mutable
+				{
+					shard.start_exchange(std::move(job), std::move(body), [promise](std::expected<HTTPOutput, HTTPErr> result)
+						{
+							promise->set_value(std::move(result));
+						});
+				});
+
+			return future;
+		}
+	}
+
+
+	// --- HTTPRuntimeShard Implementation ---
+
+	struct HTTPRuntimeShard::Request
+	{
+		HTTPBatchJob job;
+		std::chrono::steady_clock::time_point deadline;
+		Completion done; // Called once by finish_request
+
+		std::vector<uint8_t> body; // Written after the serialized head in the same gathered write, never copied into it
+
+		std::optional<HTTPSocket> socket;
+		std::vector<asio::generic::stream_protocol::endpoint> endpoints; // The resolved addresses, tried in order
+		std::optional<HTTPLimiterPermit> permit;
+		std::optional<asio::steady_timer> timer; // Fails the request at the deadline, or earlier while it connects
+		bool reused = false; // Taken from the pool rather than connected for this request
+
+		asio::streambuf responseBuffer;
+		HTTPOutput head;
+		bool eof = false; // The server closed the connection, ending a body without a length
+		bool finished = false;
+	};
+
+	struct HTTPRuntimeShard::Batch
+	{
+		explicit Batch(asio::io_context& context) : timer(context) {}
+
+		BatchCompletion complete;
+		std::shared_ptr<const std::atomic<bool>> cancelled;
+		std::chrono::steady_clock::time_point deadline;
+		asio::steady_timer timer;
+
+		std::vector<std::shared_ptr<Request>> requests; // Cleared once the batch ends, the requests hold the batch in turn
+		size_t open = 0;
+		bool stopped = false;
+	};
+
+	HTTPRuntimeShard::HTTPRuntimeShard(size_t index, int cpu, int numaNode, const HTTPRuntimeOptions& options)
+		: _index(index), _cpu(cpu), _numaNode(numaNode), _options(options)
+	{
+		_work.emplace(asio::make_work_guard(_ioContext));
+		_thread = std::thread(&HTTPRuntimeShard::run, this);
+	}
+
+	HTTPRuntimeShard::~HTTPRuntimeShard()
+	{
+		stop();
+	}
+
+	void HTTPRuntimeShard::run()
+	{
+		currentShard = this;
+
+		if (_cpu >= 0 && !pin_current_thread(_cpu))
+			HTTP_LOG_WARN("Failed to pin runtime shard {} to CPU {}.", _index, _cpu);
+
+		// The pool is first touched from here, so after pinning its memory is allocated on the shard's own node
+		_ioContext.run();
+
+		_idle.clear();
+		currentShard = nullptr;
+	}
+
+	void HTTPRuntimeShard::stop()
+	{
+		_work.reset();
+
+		if (_thread.joinable() && !running_in_this_thread())
+			_thread.join();
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPRuntimeShard::exchange(HTTPMethod method, std::string_view host, std::string_view port, const Exchange& send)
+	{
+		// A shard thread serves every origin hashed to it, waiting for one host's slot would stall all of them
+		if (_options.limiter)
+			return _options.limiter->run(host, port, [&]() { return pooled_exchange(method, host, port, send); }, false);
+
+		return pooled_exchange(method, host, port, send);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPRuntimeShard::pooled_exchange(HTTPMethod method, std::string_view host, std::string_view port, const Exchange& send)
+	{
+		auto idle = take_idle(host, port);
+		if (idle)
+		{
+			rearm_quick_ack(*idle, _options.socket);
+
+			auto output = exchange_on(host, port, std::move(*idle), send);
+
+			// The server may still close a connection that passed the liveness check while the request is on its way
+			if (output.has_value() || output.error() != HTTPErr::ClosedBeforeResponse || !is_idempotent(method))
+				return output;
+
+			HTTP_LOG_INFO("Pooled connection to {}:{} closed before the {} response, retrying on a new connection.", host, port, to_string(method));
+		}
+
+		auto socketResult = create_and_connect_socket(_socketContext, host, port, _options.connectTimeout, nullptr, _options.socket);
+		if (!socketResult.has_value())
+		{
+			return std::unexpected(socketResult.error());
+		}
+
+		return exchange_on(host, port, std::move(*socketResult), send);
+	}
+
+	std::expected<HTTPOutput, HTTPErr> HTTPRuntimeShard::exchange_on(std::string_view host, std::string_view port, HTTPSocket socket, const Exchange& send)
+	{
+		auto output = send(socket);
+
+		// A successful exchange has read the response to its end, so the connection can carry the next request
+		if (output.has_value() && output->connection == HTTPConnection::Persistent)
+			release(host, port, std::move(socket));
+
+		return output;
+	}
+
+	void HTTPRuntimeShard::start_exchange(HTTPBatchJob job, std::vector<uint8_t> body, Completion done)
+	{
+		auto request = std::make_shared<Request>();
+		request->job = std::move(job);
+		request->deadline = std::chrono::steady_clock::now() + _options.requestTimeout;
+		request->done = std::move(done);
+		request->body = std::move(body);
+
+		start_request(request);
+	}
+
+	void HTTPRuntimeShard::run_batch(
+		std::vector<HTTPBatchJob> jobs,
+		std::chrono::steady_clock::time_point deadline,
+		std::shared_ptr<const std::atomic<bool>> cancelled,
+		BatchCompletion complete)
+	{
+		auto batch = std::make_shared<Batch>(_ioContext);
+		batch->complete = std::move(complete);
+		batch->cancelled = std::move(cancelled);
+		batch->deadline = deadline;
+		batch->open = jobs.size();
+		batch->requests.reserve(jobs.size());
+
+		for (HTTPBatchJob& job : jobs)
+		{
+			auto request = std::make_shared<Request>();
+			request->job = std::move(job);
+			request->deadline = deadline;
+			request->done = [batch, index = request->job.index](std::expected<HTTPOutput, HTTPErr> result)
+				{
+					batch->open--;
+					if (!batch->stopped && !batch->complete(index, std::move(result)))
+						batch->stopped = true;
+
+					// Wakes watch_batch to end the batch now rather than on its next tick
+					if (batch->open == 0 || batch->stopped)
+						batch->timer.cancel();
+				};
+
+			batch->requests.push_back(std::move(request));
+		}
+
+		for (size_t i = 0; i < batch->requests.size() && !batch->stopped; i++)
+			start_request(batch->requests[i]);
+
+		watch_batch(batch);
+	}
+
+	void HTTPRuntimeShard::watch_batch(const std::shared_ptr<Batch>& batch)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		if (batch->requests.empty())
+			return;
+
+		Clock::time_point now = Clock::now();
+
+		if (batch->open > 0 && !batch->stopped && !batch->cancelled->load() && now < batch->deadline)
+		{
+			batch->timer.expires_after(std::min<Clock::duration>(batch->deadline - now, std::chrono::milliseconds(20)));
+			batch->timer.async_wait([this, batch](const asio::error_code&) { watch_batch(batch); });
+			return;
+		}
+
+		HTTPErr reason = now >= batch->deadline ? HTTPErr::RequestTimeout : HTTPErr::BatchCancelled;
+		batch->stopped = true;
+
+		// Closing the sockets cancels their reads and writes, the aborted handlers find their requests finished
+		std::vector<std::shared_ptr<Request>> requests;
+		requests.swap(batch->requests);
+		for (const auto& request : requests)
+			finish_request(*request, std::unexpected(reason));
+	}
+
+	void HTTPRuntimeShard::start_request(const std::shared_ptr<Request>& request)
+	{
+		request->timer.emplace(_ioContext);
+		arm_timeout(request, request->deadline, HTTPErr::RequestTimeout);
+
+		if (_options.limiter)
+		{
+			auto permit = _options.limiter->try_acquire(request->job.host, request->job.port);
+			if (!permit.has_value())
+			{
+				finish_request(*request, std::unexpected(permit.error()));
+				return;
+			}
+			request->permit.emplace(std::move(*permit));
+		}
+
+		request->socket = take_idle(request->job.host, request->job.port);
+		if (request->socket)
+		{
+			rearm_quick_ack(*request->socket, _options.socket);
+			request->reused = true;
+			write_request(request);
+			return;
+		}
+
+		connect_request(request);
+	}
+
+	void HTTPRuntimeShard::connect_request(const std::shared_ptr<Request>& request)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		request->reused = false;
+		request->endpoints.clear();
+		request->responseBuffer.consume(request->responseBuffer.size());
+		request->socket.emplace(_ioContext);
+
+		if (!_options.socket.unixSocketPath.empty() || _options.socket.proxy.enabled())
+		{
+			// A Unix socket or a proxy route is set up in full before the request can go out, CONNECT waits on the
+			// proxy's answer. It is connected in place, for no longer than the deadline leaves
+			auto left = std::chrono::ceil<std::chrono::seconds>(request->deadline - Clock::now()).count();
+			size_t timeout = std::min<size_t>(_options.connectTimeout, static_cast<size_t>(std::max<int64_t>(left, 1)));
+
+			auto socketResult = create_and_connect_socket(_socketContext, request->job.host, request->job.port, timeout, nullptr, _options.socket);
+			if (!socketResult.has_value())
+			{
+				finish_request(*request, std::unexpected(socketResult.error()));
+				return;
+			}
+
+			request->socket = move_socket(_ioContext, *socketResult);
+			if (!request->socket)
+			{
+				finish_request(*request, std::unexpected(HTTPErr::ConnectionFailed));
+				return;
+			}
+
+			write_request(request);
+			return;
+		}
+
+		// The blocking connects enforce connectTimeout with a timer of their own, this one stands in for it
+		arm_timeout(request, std::min(request->deadline, Clock::now() + std::chrono::seconds(_options.connectTimeout)), HTTPErr::ConnectionTimeout);
+
+		_resolver.async_resolve(request->job.host, request->job.port, [this, request](const asio::error_code& ec, asio::ip::tcp::resolver::results_type results)
+			{
+				if (request->finished)
+					return;
+
+				if (ec)
+				{
+					HTTP_LOG_WARN("DNS resolution failed for {}:{}: {}:{}", request->job.host, request->job.port, ec.category().name(), ec.value());
+					finish_request(*request, std::unexpected(HTTPErr::DNSResolutionFailed));
+					return;
+				}
+
+				for (const auto& result : results)
+					request->endpoints.emplace_back(result.endpoint());
+
+				asio::async_connect(*request->socket, request->endpoints, [this, request](const asio::error_code& ec, const asio::generic::stream_protocol::endpoint&)
+					{
+						if (request->finished)
+							return;
+
+						if (ec)
+						{
+							finish_request(*request, std::unexpected(to_http_err(ec, HTTPErr::ConnectionFailed)));
+							return;
+						}
+
+						// async_connect opens the socket itself, so Fast Open and the window scale are out of reach here
+						apply_socket_options(*request->socket, _options.socket);
+
+						arm_timeout(request, request->deadline, HTTPErr::RequestTimeout);
+						write_request(request);
+					});
+			});
+	}
+
+	void HTTPRuntimeShard::write_request(const std::shared_ptr<Request>& request)
+	{
+		std::array<asio::const_buffer, 2> buffers = { asio::buffer(request->job.request), asio::buffer(request->body) };
+
+		asio::async_write(*request->socket, buffers, [this, request](const asio::error_code& ec, size_t)
+			{
+				if (request->finished)
+					return;
+
+				if (ec)
+				{
+					finish_request(*request, std::unexpected(to_http_err(ec, HTTPErr::SendFailed)));
+					return;
+				}
+
+				read_response_head(request);
+			});
+	}
+
+	void HTTPRuntimeShard::read_response_head(const std::shared_ptr<Request>& request)
+	{
+		asio::streambuf& buffer = request->responseBuffer;
+
+		if (buffered_head_size(std::string_view(static_cast<const char*>(buffer.data().data()), buffer.size())))
+		{
+			// Parsed from the buffer alone, the stream is not read
+			HTTPStream stream(*request->socket);
+			auto head = read_http_head(stream, buffer);
+			if (!head.has_value())
+			{
+				finish_request(*request, std::move(head));
+				return;
+			}
+
+			request->head = std::move(*head);
+			read_response_body(request);
+			return;
+		}
+
+		request->socket->async_read_some(buffer.prepare(4096), [this, request](const asio::error_code& ec, size_t bytes)
+			{
+				if (request->finished)
+					return;
+
+				request->responseBuffer.commit(bytes);
+
+				if (!ec)
+				{
+					read_response_head(request);
+					return;
+				}
+
+				// Read as read_http_head reports it
+				HTTPErr err = to_http_err(ec, HTTPErr::ReceiveFailed);
+				if (request->responseBuffer.size() == 0 && err == HTTPErr::ConnectionClosed)
+				{
+					if (request->reused && is_idempotent(request->job.method))
+					{
+						HTTP_LOG_INFO("Pooled connection to {}:{} closed before the response, retrying on a new connection.", request->job.host, request->job.port);
+
+						asio::error_code ignored;
+						request->socket->close(ignored);
+						connect_request(request);
+						return;
+					}
+
+					err = HTTPErr::ClosedBeforeResponse;
+				}
+				else if (ec == asio::error::eof)
+				{
+					err = HTTPErr::ConnectionClosed;
+				}
+
+				finish_request(*request, std::unexpected(err));
+			});
+	}
+
+	void HTTPRuntimeShard::read_response_body(const std::shared_ptr<Request>& request)
+	{
+		asio::streambuf& buffer = request->responseBuffer;
+		HTTPOutput& head = request->head;
+
+		// The length a HEAD response announces belongs to the body a GET would get
+		if (request->job.method == HTTPMethod::HEAD)
+		{
+			finish_request(*request, std::move(request->head));
+			return;
+		}
+
+		bool hasBody = head.statusCode >= 200 && head.statusCode != 204 && head.statusCode != 304;
+		if (hasBody && head.transferEncoding != HTTPTransferEncoding::Chunked && head.contentLength > buffer.size())
+		{
+			// The same limit the blocking readers apply, nothing is reserved for a length the server only claims
+			if (head.contentLength > HTTP_MAX_BODY_SIZE)
+			{
+				HTTP_LOG_WARN("Content-Length {} is over the {} byte limit.", head.contentLength, HTTP_MAX_BODY_SIZE);
+				finish_request(*request, std::unexpected(HTTPErr::InvalidContentLength));
+				return;
+			}
+
+			if (is_binary_data(head.contentType))
+				head.body.emplace<std::vector<uint8_t>>();
+			else
+				head.body.emplace<std::string>();
+
+			// Only the bytes that came with the head are copied out of the buffer, the rest lands in the body directly
+			std::visit([&](auto& body)
+				{
+					using Byte = typename std::decay_t<decltype(body)>::value_type;
+
+					const Byte* data = static_cast<const Byte*>(buffer.data().data());
+					body.reserve(std::min(head.contentLength, HTTP_BODY_RESERVE_SIZE));
+					body.assign(data, data + buffer.size());
+				}, head.body);
+			buffer.consume(buffer.size());
+
+			read_sized_body(request);
+			return;
+		}
+
+		if (request->eof || buffered_body_size(std::string_view(static_cast<const char*>(buffer.data().data()), buffer.size()), head))
+		{
+			// Parsed from the buffer alone, a body ended by EOF finds the stream already at its end
+			HTTPStream stream(*request->socket);
+			HTTPErr err = read_http_body(stream, buffer, head);
+			if (err != HTTPErr::None)
+			{
+				finish_request(*request, std::unexpected(err));
+				return;
+			}
+
+			finish_request(*request, std::move(request->head));
+			return;
+		}
+
+		// A chunked or EOF-delimited body collects in the buffer until it is complete
+		if (buffer.size() > HTTP_MAX_BODY_SIZE)
+		{
+			HTTP_LOG_WARN("Response body is over the {} byte limit.", HTTP_MAX_BODY_SIZE);
+			finish_request(*request, std::unexpected(HTTPErr::MessageTooLarge));
+			return;
+		}
+
+		request->socket->async_read_some(buffer.prepare(64 * 1024), [this, request](const asio::error_code& ec, size_t bytes)
+			{
+				if (request->finished)
+					return;
+
+				request->responseBuffer.commit(bytes);
+
+				if (ec == asio::error::eof)
+				{
+					request->eof = true;
+				}
+				else if (ec)
+				{
+					finish_request(*request, std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed)));
+					return;
+				}
+
+				read_response_body(request);
+			});
+	}
+
+	void HTTPRuntimeShard::read_sized_body(const std::shared_ptr<Request>& request)
+	{
+		HTTPOutput& head = request->head;
+
+		// The length came from the server, the body only grows a step ahead of what has arrived
+		asio::mutable_buffer next = std::visit([&](auto& body)
+			{
+				size_t offset = body.size();
+				size_t step = std::min(head.contentLength - offset, HTTP_BODY_RESERVE_SIZE);
+				body.resize(offset + step);
+
+				return asio::buffer(body.data() + offset, step);
+			}, head.body);
+
+		asio::async_read(*request->socket, next, [this, request](const asio::error_code& ec, size_t)
+			{
+				if (request->finished)
+					return;
+
+				if (ec)
+				{
+					finish_request(*request, std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed)));
+					return;
+				}
+
+				HTTPOutput& head = request->head;
+				if (std::visit([](const auto& body) { return body.size(); }, head.body) < head.contentLength)
+				{
+					read_sized_body(request);
+					return;
+				}
+
+				HTTP_LOG_DEBUG("HTTP Response Body: {} bytes.", head.contentLength);
+				finish_request(*request, std::move(request->head));
+			});
+	}
+
+	void HTTPRuntimeShard::arm_timeout(const std::shared_ptr<Request>& request, std::chrono::steady_clock::time_point expiry, HTTPErr reason)
+	{
+		// Moving the expiry aborts the wait armed before
+		request->timer->expires_at(expiry);
+		request->timer->async_wait([this, request, reason](const asio::error_code& ec)
+			{
+				// A wait that had already completed when the expiry moved is told apart by the new expiry
+				if (ec == asio::error::operation_aborted || request->finished || request->timer->expiry() > std::chrono::steady_clock::now())
+					return;
+
+				HTTP_LOG_WARN("Request to {}:{} timed out.", request->job.host, request->job.port);
+				finish_request(*request, std::unexpected(reason));
+			});
+	}
+
+	void HTTPRuntimeShard::finish_request(Request& request, std::expected<HTTPOutput, HTTPErr> result)
+	{
+		if (request.finished)
+			return;
+
+		request.finished = true;
+
+		// The timer's handler holds the request, cancelled it lets go right away
+		if (request.timer)
+			request.timer->cancel();
+
+		if (request.permit)
+			request.permit->release(result.has_value() ? HTTPLimiterOutcome::Success : HTTPConcurrencyLimiter::classify(result.error()));
+
+		if (result.has_value() && result->connection == HTTPConnection::Persistent && request.socket && request.socket->is_open())
+		{
+			release(request.job.host, request.job.port, std::move(*request.socket));
+		}
+		else if (request.socket)
+		{
+			asio::error_code ignored;
+			request.socket->close(ignored);
+		}
+
+		request.done(std::move(result));
+	}
+
+	std::expected<HTTPSocket, HTTPErr> HTTPRuntimeShard::acquire(std::string_view host, std::string_view port)
+	{
+		auto socket = take_idle(host, port);
+		if (socket)
+		{
+			return std::move(*socket);
+		}
+
+		return create_and_connect_socket(_socketContext, host, port, _options.connectTimeout, nullptr, _options.socket);
+	}
+
+	std::optional<HTTPSocket> HTTPRuntimeShard::take_idle(std::string_view host, std::string_view port)
+	{
+		auto it = _idle.find(origin_key(host, port));
+		if (it == _idle.end())
+		{
+			return std::nullopt;
+		}
+
+		// Servers close idle connections on their own timeout, which the pool only learns about here
+		while (!it->second.empty())
+		{
+			HTTPSocket socket = std::move(it->second.back());
+			it->second.pop_back();
+
+			if (is_connection_alive(socket))
+				return socket;
+
+			HTTP_LOG_DEBUG("Dropping pooled connection to {}:{} closed by the server.", host, port);
+			asio::error_code ignored;
+			socket.close(ignored);
+		}
+
+		return std::nullopt;
+	}
+
+	void HTTPRuntimeShard::release(std::string_view host, std::string_view port, HTTPSocket socket)
+	{
+		if (!socket.is_open())
+			return;
+
+		std::vector<HTTPSocket>& idle = _idle[origin_key(host, port)];
+		if (idle.size() >= _options.maxIdlePerHost)
+			return;
+
+		// A connection opened by a blocking connect is still on _socketContext
+		if (&asio::query(socket.get_executor(), asio::execution::context) != &_ioContext)
+		{
+			auto moved = move_socket(_ioContext, socket);
+			if (moved)
+				idle.push_back(std::move(*moved));
+			return;
+		}
+
+		idle.push_back(std::move(socket));
+	}
+
+	const HTTPSocketOptions& HTTPRuntimeShard::socket_options() const
+	{
+		return _options.socket;
+	}
+
+	size_t HTTPRuntimeShard::idle_count() const
+	{
+		size_t count = 0;
+		for (const auto& [origin, sockets] : _idle)
+			count += sockets.size();
+		return count;
+	}
+
+	size_t HTTPRuntimeShard::index() const
+	{
+		return _index;
+	}
+
+	int HTTPRuntimeShard::cpu() const
+	{
+		return _cpu;
+	}
+
+	int HTTPRuntimeShard::numa_node() const
+	{
+		return _numaNode;
+	}
+
+	bool HTTPRuntimeShard::running_in_this_thread() const
+	{
+		return currentShard == this;
+	}
+
+	asio::io_context& HTTPRuntimeShard::io_context()
+	{
+		return _ioContext;
+	}
+
+	std::string HTTPRuntimeShard::origin_key(std::string_view host, std::string_view port)
+	{
+		std::string key;
+		key.reserve(host.size() + port.size() + 1);
+		key.append(host).append(":").append(port);
+		return key;
+	}
+
+
+	// --- HTTPRuntime Implementation ---
+
+	HTTPRuntime::HTTPRuntime(const HTTPRuntimeOptions& options)
+	{
+		std::vector<int> cpus = usable_cpus();
+
+		size_t count = options.shards;
+		if (count == 0)
+			count = !cpus.empty() ? cpus.size() : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+		std::vector<int> nodes(cpus.size(), -1);
+		if (options.numaAware && !cpus.empty())
+		{
+			std::vector<std::pair<int, int>> placement;
+			for (int cpu : cpus)
+				placement.emplace_back(numa_node_of(cpu), cpu);
+
+			std::stable_sort(placement.begin(), placement.end());
+
+			for (size_t i = 0; i < placement.size(); i++)
+			{
+				nodes[i] = placement[i].first;
+				cpus[i] = placement[i].second;
+			}
+		}
+
+		_shards.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			bool pinned = options.pinThreads && !cpus.empty();
+			int cpu = pinned ? cpus[i % cpus.size()] : -1;
+			int node = pinned ? nodes[i % cpus.size()] : -1;
+
+			_shards.push_back(std::make_unique<HTTPRuntimeShard>(i, cpu, node, options));
+		}
+
+		HTTP_LOG_DEBUG("HTTP runtime started with {} shards.", _shards.size());
+	}
+
+	HTTPRuntime::~HTTPRuntime()
+	{
+		for (auto& shard : _shards)
+			shard->stop();
+	}
+
+	size_t HTTPRuntime::shard_count() const
+	{
+		return _shards.size();
+	}
+
+	HTTPRuntimeShard& HTTPRuntime::shard(size_t index)
+	{
+		return *_shards[index];
+	}
+
+	HTTPRuntimeShard& HTTPRuntime::shard_for(std::string_view host, std::string_view port)
+	{
+		size_t hash = std::hash<std::string_view>{}(host) ^ (std::hash<std::string_view>{}(port) * 31);
+		return *_shards[hash % _shards.size()];
+	}
+
+	HTTPRuntimeShard* HTTPRuntime::current_shard()
+	{
+		return currentShard;
+	}
+
+	std::future<std::expected<HTTPOutput, HTTPErr>> HTTPRuntime::get(std::string_view url, const std::unordered_map<std::string, std::string>& headers)
+	{
+		return send(HTTPMethod::GET, HTTPContent::None, url, "", headers);
+	}
+
+	std::future<std::expected<HTTPOutput, HTTPErr>> HTTPRuntime::post(
+		std::string_view url,
+		HTTPContent content,
+		std::string_view body,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		return send(HTTPMethod::POST, content, url, body, headers);
+	}
+
+	std::future<std::expected<HTTPOutput, HTTPErr>> HTTPRuntime::post(
+		std::string_view url,
+		HTTPContent content,
+		std::vector<uint8_t> body,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto target = decrypt_pooled_url(url);
+		if (!target.has_value())
+		{
+			return ready(std::unexpected(target.error()));
+		}
+
+		HTTPRuntimeShard& owner = shard_for(target->host, target->port);
+
+		// The shard cannot wait on itself, and a body held back behind Expect waits for 100 Continue in place
+		if (owner.running_in_this_thread() || expects_continue(owner.socket_options(), body.size()))
+		{
+			return owner.submit(
+				[target = std::move(*target), content, body = std::move(body), headers](HTTPRuntimeShard& shard)
+				{
+					return shard.exchange(HTTPMethod::POST, target.host, target.port, [&](HTTPSocket& socket)
+						{
+							return send_http_request(content, target.host, target.path, target.port, body, headers, HTTPConnection::Persistent, &socket, nullptr, shard.socket_options());
+						});
+				});
+		}
+
+		auto job = make_job(0, HTTPMethod::POST, content, *target, headers, owner.socket_options().proxy, "", body.size());
+		if (!job.has_value())
+		{
+			return ready(std::unexpected(job.error()));
+		}
+
+		return start_on(owner, std::move(*job), std::move(body));
+	}
+
+	std::future<std::expected<HTTPOutput, HTTPErr>> HTTPRuntime::send(
+		HTTPMethod method,
+		HTTPContent content,
+		std::string_view url,
+		std::string_view body,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto target = decrypt_pooled_url(url);
+		if (!target.has_value())
+		{
+			return ready(std::unexpected(target.error()));
+		}
+
+		HTTPRuntimeShard& owner = shard_for(target->host, target->port);
+
+		// The shard cannot wait on itself, and a body held back behind Expect waits for 100 Continue in place
+		if (owner.running_in_this_thread() || expects_continue(owner.socket_options(), body.size()))
+		{
+			return owner.submit(
+				[target = std::move(*target), method, content, body = std::string(body), headers](HTTPRuntimeShard& shard)
+				{
+					return shard.exchange(method, target.host, target.port, [&](HTTPSocket& socket)
+						{
+							return send_http_request(method, content, target.host, target.path, target.port, body, headers, HTTPConnection::Persistent, &socket, nullptr, shard.socket_options());
+						});
+				});
+		}
+
+		auto job = make_job(0, method, content, *target, headers, owner.socket_options().proxy, body);
+		if (!job.has_value())
+		{
+			return ready(std::unexpected(job.error()));
+		}
+
+		return start_on(owner, std::move(*job));
+	}
+
+	std::vector<std::expected<HTTPOutput, HTTPErr>> HTTPRuntime::batch(const std::vector<HTTPBatchRequest>& requests, const HTTPBatchOptions& options)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// Shared with the shards, which may still be finishing their part after the caller gave up waiting
+		struct State
+		{
+			std::mutex mutex;
+			std::condition_variable changed;
+			std::vector<std::expected<HTTPOutput, HTTPErr>> results;
+			std::vector<bool> finished;
+			size_t remaining = 0;
+			size_t succeeded = 0;
+			bool failed = false;
+			std::atomic<bool> cancelled = false;
+		};
+
+		auto state = std::make_shared<State>();
+		state->results.resize(requests.size(), std::unexpected(HTTPErr::RequestTimeout));
+		state->finished.resize(requests.size(), false);
+
+		Clock::time_point deadline = Clock::now() + options.deadline;
+
+		std::vector<std::vector<HTTPBatchJob>> jobsByShard(_shards.size());
+
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const HTTPBatchRequest& request = requests[i];
+
+			auto target = decrypt_pooled_url(request.url);
+			if (!target.has_value())
+			{
+				state->results[i] = std::unexpected(target.error());
+				state->finished[i] = true;
+				state->failed = true;
+				continue;
+			}
+
+			HTTPRuntimeShard& owner = shard_for(target->host, target->port);
+
+			auto job = make_job(i, request.method, request.content, *target, request.headers, owner.socket_options().proxy, request.body);
+			if (!job.has_value())
+			{
+				state->results[i] = std::unexpected(job.error());
+				state->finished[i] = true;
+				state->failed = true;
+				continue;
+			}
+
+			jobsByShard[owner.index()].push_back(std::move(*job));
+			state->remaining++;
+		}
+
+		auto done = [&]()
+			{
+				return state->remaining == 0 ||
+					(options.firstN > 0 && state->succeeded >= options.firstN) ||
+					(!options.partialResults && state->failed);
+			};
+
+		auto complete = [state, firstN = options.firstN, partialResults = options.partialResults](size_t index, std::expected<HTTPOutput, HTTPErr> result)
+			{
+				std::lock_guard lock(state->mutex);
+				if (state->cancelled.load())
+					return false;
+
+				if (result.has_value())
+					state->succeeded++;
+				else
+					state->failed = true;
+
+				state->results[index] = std::move(result);
+				state->finished[index] = true;
+				state->remaining--;
+
+				state->changed.notify_all();
+
+				return !(firstN > 0 && state->succeeded >= firstN) && (partialResults || !state->failed);
+			};
+
+		// Outlives this call with the shards' part of the state
+		std::shared_ptr<const std::atomic<bool>> cancelled(state, &state->cancelled);
+
+		for (size_t s = 0; s < _shards.size(); s++)
+		{
+			if (jobsByShard[s].empty())
+				continue;
+
+			_shards[s]->submit(
+				[jobs = std::move(jobsByShard[s]), deadline, cancelled, complete](HTTPRuntimeShard& shard) mutable
+				{
+					shard.run_batch(std::move(jobs), deadline, std::move(cancelled), std::move(complete));
+				});
+		}
+
+		std::unique_lock lock(state->mutex);
+
+		// A caller on a shard thread would hold up its own shard's part by waiting, so it runs the shard in slices instead
+		HTTPRuntimeShard* callerShard = current_shard();
+		if (callerShard)
+		{
+			while (!done() && Clock::now() < deadline)
+			{
+				lock.unlock();
+				callerShard->io_context().run_one_until(std::min(deadline, Clock::now() + std::chrono::milliseconds(20)));
+				lock.lock();
+			}
+		}
+		else
+		{
+			state->changed.wait_until(lock, deadline, [&]() { return done(); });
+		}
+
+		state->cancelled.store(true);
+
+		// Anything not finished was cut off, either by the deadline or because the batch already had what it needed
+		HTTPErr reason = done() ? HTTPErr::BatchCancelled : HTTPErr::RequestTimeout;
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			if (!state->finished[i])
+				state->results[i] = std::unexpected(reason);
+		}
+
+		return std::move(state->results);
+	}
+
+}
@@ -0,0 +1,126 @@
+#include "headers.h"
+#include "http_socket.h"
+#include "http_logger.h"
+
+#if defined(__linux__)
+#include <netinet/tcp.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		template <int Level, int Name>
+		using IntegerOption = asio::detail::socket_option::integer<Level, Name>;
+
+		template <typename Option>
+		bool set(HTTPSocket& socket, const Option& option, std::string_view name)
+		{
+			asio::error_code ec;
+			socket.set_option(option, ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Failed to set {}: {}:{}", name, ec.category().name(), ec.value());
+				return false;
+			}
+			return true;
+		}
+
+		bool is_local(HTTPSocket& socket)
+		// A connected Unix domain socket, which has no TCP options to set
+		{
+#if defined(ASIO_HAS_LOCAL_SOCKETS)
+			asio::error_code ec;
+			auto endpoint = socket.local_endpoint(ec);
+			return !ec && endpoint.protocol().family() == asio::local::stream_protocol().family();
+#else
+			return false;
+#endif
+		}
+	}
+
+
+	// --- Socket Option Methods ---
+
+	HTTPErr apply_socket_options(HTTPSocket& socket, const HTTPSocketOptions& options)
+	{
+		bool ok = true;
+
+		if (options.sendBufferSize)
+			ok &= set(socket, asio::socket_base::send_buffer_size(*options.sendBufferSize), "SO_SNDBUF");
+
+		if (options.receiveBufferSize)
+			ok &= set(socket, asio::socket_base::receive_buffer_size(*options.receiveBufferSize), "SO_RCVBUF");
+
+		if (is_local(socket))
+			return ok ? HTTPErr::None : HTTPErr::SocketOptionFailed;
+
+		if (options.noDelay)
+			ok &= set(socket, asio::ip::tcp::no_delay(true), "TCP_NODELAY");
+
+		if (options.keepAlive)
+		{
+			ok &= set(socket, asio::socket_base::keep_alive(true), "SO_KEEPALIVE");
+
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+			if (options.keepAliveIdle.count() > 0)
+				ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPIDLE>(static_cast<int>(options.keepAliveIdle.count())), "TCP_KEEPIDLE");
+
+			if (options.keepAliveInterval.count() > 0)
+				ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPINTVL>(static_cast<int>(options.keepAliveInterval.count())), "TCP_KEEPINTVL");
+
+			if (options.keepAliveProbes > 0)
+				ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_KEEPCNT>(options.keepAliveProbes), "TCP_KEEPCNT");
+#endif
+		}
+
+#if defined(__linux__)
+		if (options.quickAck)
+			ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_QUICKACK>(1), "TCP_QUICKACK");
+
+		if (options.userTimeout.count() > 0)
+			ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_USER_TIMEOUT>(static_cast<int>(options.userTimeout.count())), "TCP_USER_TIMEOUT");
+
+#ifdef TCP_FASTOPEN_CONNECT
+		// Connect then returns at once and the SYN leaves with the first write, carrying it when a cookie is cached.
+		// Too late once connected, a live connection is left as it is.
+		asio::error_code notConnected;
+		socket.remote_endpoint(notConnected);
+
+		if (options.fastOpen && notConnected)
+			ok &= set(socket, IntegerOption<IPPROTO_TCP, TCP_FASTOPEN_CONNECT>(1), "TCP_FASTOPEN_CONNECT");
+#endif
+#endif
+
+		return ok ? HTTPErr::None : HTTPErr::SocketOptionFailed;
+	}
+
+	void rearm_quick_ack(HTTPSocket& socket, const HTTPSocketOptions& options)
+	{
+#if defined(__linux__)
+		if (options.quickAck && !is_local(socket))
+			set(socket, IntegerOption<IPPROTO_TCP, TCP_QUICKACK>(1), "TCP_QUICKACK");
+#endif
+	}
+
+	std::optional<HTTPSocket> move_socket(asio::io_context& context, HTTPSocket& socket)
+	{
+		// The descriptor moves over under the protocol it was opened with
+		asio::error_code ec;
+		auto protocol = socket.local_endpoint(ec).protocol();
+		if (ec)
+			return std::nullopt;
+
+		HTTPSocket moved(context);
+		auto handle = socket.release(ec);
+		if (!ec)
+			moved.assign(protocol, handle, ec);
+		if (ec)
+			return std::nullopt;
+
+		return moved;
+	}
+
+}
@@ -0,0 +1,434 @@
+#include "headers.h"
+#include "http_sse.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr size_t READ_SIZE = 16 * 1024;
+
+		constexpr size_t RETAINED_CAPACITY = 64 * 1024; // Buffers grown past this by one large event are released after it
+
+		void release_if_large(std::string& buffer)
+		{
+			if (buffer.capacity() > RETAINED_CAPACITY)
+				std::string().swap(buffer);
+		}
+
+		bool reconnectable(HTTPErr err)
+		// Errors of the connection rather than of the stream, the stream is asked for again after them
+		{
+			switch (err)
+			{
+			case HTTPErr::DNSResolutionFailed:
+			case HTTPErr::ConnectionFailed:
+			case HTTPErr::ConnectionTimeout:
+			case HTTPErr::RequestTimeout:
+			case HTTPErr::SendFailed:
+			case HTTPErr::ReceiveFailed:
+			case HTTPErr::ConnectionClosed:
+			case HTTPErr::ClosedBeforeResponse:
+			case HTTPErr::InvalidChunkSize:
+			case HTTPErr::ProxyConnectFailed:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		std::expected<bool, HTTPErr> feed_body(
+			// Hands bytes to the parser as soon as they arrive, length of them or everything up to EOF.
+			// False once the callback stopped the stream
+			HTTPStream& stream,
+			asio::streambuf& responseBuffer,
+			uint64_t length,
+			bool untilEof,
+			HTTPEventStreamParser& parser,
+			const HTTPEventCallback& callback)
+		{
+			while (untilEof || length > 0)
+			{
+				if (responseBuffer.size() == 0)
+				{
+					asio::error_code ec;
+					size_t received = stream.read_some(responseBuffer.prepare(READ_SIZE), ec);
+					if (ec == asio::error::eof && untilEof)
+						return true;
+					if (ec)
+						return std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed));
+
+					responseBuffer.commit(received);
+				}
+
+				size_t available = static_cast<size_t>(std::min<uint64_t>(responseBuffer.size(), length));
+				auto fed = parser.feed(std::string_view(static_cast<const char*>(responseBuffer.data().data()), available), callback);
+				responseBuffer.consume(available);
+
+				if (!fed.has_value() || !*fed)
+					return fed;
+
+				if (!untilEof)
+					length -= available;
+			}
+
+			return true;
+		}
+
+		std::expected<bool, HTTPErr> read_events(
+			HTTPStream& stream,
+			asio::streambuf& responseBuffer,
+			const HTTPOutput& head,
+			HTTPEventStreamParser& parser,
+			const HTTPEventCallback& callback)
+		{
+			if (head.transferEncoding != HTTPTransferEncoding::Chunked)
+			{
+				// Without a length the stream runs until the server closes it, whatever Connection says
+				bool untilEof = head.contentLength == 0;
+				return feed_body(stream, responseBuffer, untilEof ? UINT64_MAX : head.contentLength, untilEof, parser, callback);
+			}
+
+			asio::error_code ec;
+
+			while (true)
+			{
+				size_t lineSize = asio::read_until(stream, responseBuffer, "\r\n", ec);
+				if (ec)
+					return std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed));
+
+				// Chunk extensions after ';' are left unread
+				const char* line = static_cast<const char*>(responseBuffer.data().data());
+				uint64_t chunkSize = 0;
+				auto [end, errc] = std::from_chars(line, line + lineSize, chunkSize, 16);
+				responseBuffer.consume(lineSize);
+				if (errc != std::errc())
+					return std::unexpected(HTTPErr::InvalidChunkSize);
+
+				if (chunkSize == 0)
+				{
+					// The server ended the stream, trailers are of no use to it
+					return true;
+				}
+
+				auto fed = feed_body(stream, responseBuffer, chunkSize, false, parser, callback);
+				if (!fed.has_value() || !*fed)
+					return fed;
+
+				lineSize = asio::read_until(stream, responseBuffer, "\r\n", ec);
+				if (ec)
+					return std::unexpected(to_http_err(ec, HTTPErr::ReceiveFailed));
+				responseBuffer.consume(lineSize);
+			}
+		}
+
+		std::expected<bool, HTTPErr> open_and_read(
+			// One connection's worth of the stream. opened is set once the server answered with an event stream
+			asio::io_context& ioContext,
+			std::string_view host,
+			std::string_view port,
+			std::string_view target,
+			const std::unordered_map<std::string, std::string>& headers,
+			const HTTPHeaderBlock* defaultHeaders,
+			const HTTPSocketOptions& socketOptions,
+			const HTTPEventStreamOptions& options,
+			HTTPEventStreamParser& parser,
+			const HTTPEventCallback& callback,
+			bool& opened)
+		{
+			auto socketResult = create_and_connect_socket(ioContext, host, port, options.connectTimeout, nullptr, socketOptions);
+			if (!socketResult.has_value())
+			{
+				return std::unexpected(socketResult.error());
+			}
+
+			HTTPSocket socket(std::move(*socketResult));
+
+			auto requestResult = write_str_request(HTTPMethod::GET, HTTPContent::None, HTTPConnection::Persistent, host, target, "", headers, defaultHeaders);
+			if (!requestResult.has_value())
+			{
+				return std::unexpected(requestResult.error());
+			}
+
+			HTTPStream stream(socket);
+
+			asio::error_code ec;
+			asio::write(stream, asio::buffer(*requestResult), ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error sending event stream request: {}:{}", ec.category().name(), ec.value());
+				return std::unexpected(to_http_err(ec, HTTPErr::SendFailed));
+			}
+
+			asio::streambuf responseBuffer;
+			auto head = read_http_head(stream, responseBuffer);
+			if (!head.has_value())
+			{
+				return std::unexpected(head.error());
+			}
+
+			if (head->statusCode != 200 || head->contentType != HTTPContent::TextEventStream)
+			{
+				HTTP_LOG_WARN("{}:{}{} answered {} without an event stream.", host, port, target, head->statusCode);
+				return std::unexpected(head->statusCode != 200 ? HTTPErr::ResponseError : HTTPErr::InvalidContentType);
+			}
+
+			opened = true;
+			HTTP_LOG_DEBUG("Event stream open to {}:{}{}", host, port, target);
+
+			auto result = read_events(stream, responseBuffer, *head, parser, callback);
+
+			asio::error_code ignored;
+			socket.shutdown(HTTPSocket::shutdown_both, ignored);
+			socket.close(ignored);
+
+			return result;
+		}
+	}
+
+
+	// --- HTTPEventStreamParser Implementation ---
+
+	HTTPEventStreamParser::HTTPEventStreamParser(size_t maxEventSize)
+		: _maxEventSize(maxEventSize)
+	{
+	}
+
+	std::expected<bool, HTTPErr> HTTPEventStreamParser::feed(std::string_view bytes, const HTTPEventCallback& callback)
+	{
+		size_t pos = 0;
+
+		if (_skipNewline)
+		{
+			_skipNewline = false;
+			if (!bytes.empty() && bytes[0] == '\n')
+				pos = 1;
+		}
+
+		while (pos < bytes.size())
+		{
+			size_t end = bytes.find_first_of("\r\n", pos);
+			if (end == std::string_view::npos)
+			{
+				if (_line.size() + bytes.size() - pos > _maxEventSize)
+					return std::unexpected(HTTPErr::MessageTooLarge);
+
+				_line.append(bytes.substr(pos));
+				break;
+			}
+
+			std::string_view line = bytes.substr(pos, end - pos);
+			if (!_line.empty())
+			{
+				if (_line.size() + line.size() > _maxEventSize)
+					return std::unexpected(HTTPErr::MessageTooLarge);
+
+				_line.append(line);
+				line = _line;
+			}
+
+			// Lines end in CRLF, LF or a lone CR
+			pos = end + 1;
+			if (bytes[end] == '\r')
+			{
+				if (pos == bytes.size())
+					_skipNewline = true;
+				else if (bytes[pos] == '\n')
+					pos++;
+			}
+
+			auto processed = process_line(line, callback);
+			_line.clear();
+
+			if (!processed.has_value() || !*processed)
+				return processed;
+		}
+
+		return true;
+	}
+
+	void HTTPEventStreamParser::reset()
+	{
+		_line.clear();
+		_skipNewline = false;
+		_data.clear();
+		_type.clear();
+		_id = _lastEventId;
+		release_if_large(_line);
+		release_if_large(_data);
+	}
+
+	const std::string& HTTPEventStreamParser::last_event_id() const
+	{
+		return _lastEventId;
+	}
+
+	void HTTPEventStreamParser::set_last_event_id(std::string_view id)
+	{
+		_lastEventId = id;
+		_id = id;
+	}
+
+	std::optional<std::chrono::milliseconds> HTTPEventStreamParser::retry() const
+	{
+		return _retry;
+	}
+
+	std::expected<bool, HTTPErr> HTTPEventStreamParser::process_line(std::string_view line, const HTTPEventCallback& callback)
+	{
+		if (line.empty())
+		{
+			return dispatch(callback);
+		}
+
+		if (line[0] == ':')
+		{
+			// A comment, servers send them to keep idle connections alive
+			return true;
+		}
+
+		size_t colon = line.find(':');
+		std::string_view field = line.substr(0, colon);
+		std::string_view value = colon == std::string_view::npos ? std::string_view() : line.substr(colon + 1);
+		if (value.starts_with(' '))
+			value.remove_prefix(1);
+
+		if (field == "data")
+		{
+			if (_data.size() + value.size() + 1 > _maxEventSize)
+				return std::unexpected(HTTPErr::MessageTooLarge);
+
+			_data.append(value);
+			_data.push_back('\n');
+		}
+		else if (field == "event")
+		{
+			_type = value;
+		}
+		else if (field == "id")
+		{
+			if (value.find('\0') == std::string_view::npos)
+				_id = value;
+		}
+		else if (field == "retry")
+		{
+			uint64_t milliseconds = 0;
+			auto [end, errc] = std::from_chars(value.data(), value.data() + value.size(), milliseconds);
+			if (errc == std::errc() && end == value.data() + value.size() && value[0] != '-' && value[0] != '+')
+				_retry = std::chrono::milliseconds(milliseconds);
+		}
+
+		return true;
+	}
+
+	bool HTTPEventStreamParser::dispatch(const HTTPEventCallback& callback)
+	{
+		// An event without data still moves the last event ID on
+		_lastEventId = _id;
+
+		if (_data.empty())
+		{
+			_type.clear();
+			return true;
+		}
+
+		_data.pop_back();
+
+		HTTPEvent event{ _type.empty() ? std::string_view("message") : std::string_view(_type), _data, _lastEventId };
+		bool keepGoing = callback(event);
+
+		_data.clear();
+		_type.clear();
+		release_if_large(_data);
+		release_if_large(_line);
+
+		return keepGoing;
+	}
+
+
+	// --- Event Stream Methods ---
+
+	HTTPErr stream_events(
+		std::string_view url,
+		const HTTPEventCallback& callback,
+		const HTTPEventStreamOptions& options,
+		const std::unordered_map<std::string, std::string>& headers)
+	{
+		auto outputResult = parse_http_url(url);
+		if (!outputResult.has_value())
+		{
+			return outputResult.error();
+		}
+
+		return stream_events(outputResult->host, outputResult->target, outputResult->port, callback, options, headers, nullptr, socket_options_for(*outputResult));
+	}
+
+	HTTPErr stream_events(
+		std::string_view host,
+		std::string_view path,
+		std::string_view port,
+		const HTTPEventCallback& callback,
+		const HTTPEventStreamOptions& options,
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPHeaderBlock* defaultHeaders,
+		const HTTPSocketOptions& socketOptions)
+	{
+		HTTPEventStreamParser parser(options.maxEventSize);
+		parser.set_last_event_id(options.lastEventId);
+
+		std::string proxiedTarget;
+		std::string_view target = proxy_request_target(host, port, path, socketOptions.proxy, proxiedTarget);
+
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		std::unordered_map<std::string, std::string> requestHeaders = proxy_request_headers(headers, socketOptions.proxy, proxiedHeaders);
+		requestHeaders["Accept"] = "text/event-stream";
+		requestHeaders["Cache-Control"] = "no-cache";
+
+		asio::io_context ioContext;
+		size_t failures = 0;
+
+		while (true)
+		{
+			if (!parser.last_event_id().empty())
+				requestHeaders["Last-Event-ID"] = parser.last_event_id();
+
+			bool opened = false;
+			auto result = open_and_read(ioContext, host, port, target, requestHeaders, defaultHeaders, socketOptions, options, parser, callback, opened);
+
+			if (result.has_value() && !*result)
+			{
+				return HTTPErr::None;
+			}
+
+			HTTPErr err = result.has_value() ? HTTPErr::ConnectionClosed : result.error();
+			if (!reconnectable(err))
+			{
+				HTTP_LOG_WARN("Event stream from {}:{}{} failed: {}", host, port, path, to_string(err));
+				return err;
+			}
+
+			// An event cut off by the connection is never dispatched
+			parser.reset();
+
+			if (opened)
+				failures = 0;
+
+			if (++failures > options.maxReconnects)
+			{
+				HTTP_LOG_WARN("Event stream from {}:{}{} lost after {} reconnects: {}", host, port, path, options.maxReconnects, to_string(err));
+				return err;
+			}
+
+			// The server's retry is the floor, failing attempts back off from it
+			std::chrono::milliseconds retry = parser.retry().value_or(options.reconnectDelay);
+			std::chrono::milliseconds delay = std::max(retry, std::min(retry * (int64_t(1) << std::min<size_t>(failures - 1, 16)), options.maxReconnectDelay));
+			HTTP_LOG_INFO("Event stream from {}:{}{} dropped: {}, reconnecting in {}ms.", host, port, path, to_string(err), delay.count());
+
+			std::this_thread::sleep_for(delay);
+		}
+	}
+
+}
@@ -0,0 +1,95 @@
+#include "headers.h"
+#include "http_stream.h"
+
+#include <climits>
+
+#if !defined(_WIN32)
+#include <poll.h>
+#endif
+
+
+namespace communicator
+{
+
+	HTTPStream::HTTPStream(HTTPSocket& socket)
+		: _socket(socket)
+	{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+		if (HTTPUring* ring = HTTPUring::thread_instance())
+			_channel.emplace(*ring, socket.native_handle());
+#endif
+	}
+
+	void HTTPStream::wait_read(asio::error_code& ec)
+	{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+		if (_channel)
+		{
+			_channel->wait_read(ec);
+			return;
+		}
+#endif
+		_socket.wait(HTTPSocket::wait_read, ec);
+	}
+
+	void HTTPStream::wait_read(asio::error_code& ec, std::chrono::steady_clock::time_point deadline)
+	{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+		if (_channel)
+		{
+			_channel->wait_read(ec, deadline);
+			return;
+		}
+#endif
+		ec = {};
+
+		while (true)
+		{
+			auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			int timeout = static_cast<int>(std::clamp<int64_t>(remaining, 0, INT_MAX));
+
+#if defined(_WIN32)
+			WSAPOLLFD fd{ _socket.native_handle(), POLLRDNORM, 0 };
+			int result = ::WSAPoll(&fd, 1, timeout);
+			if (result == SOCKET_ERROR)
+			{
+				ec = asio::error_code(::WSAGetLastError(), asio::error::get_system_category());
+				return;
+			}
+#else
+			pollfd fd{ _socket.native_handle(), POLLIN, 0 };
+			int result = ::poll(&fd, 1, timeout);
+			if (result < 0 && errno == EINTR)
+				continue;
+			if (result < 0)
+			{
+				ec = asio::error_code(errno, asio::error::get_system_category());
+				return;
+			}
+#endif
+			if (result > 0)
+				return;
+
+			if (timeout == 0)
+			{
+				ec = asio::error::timed_out;
+				return;
+			}
+		}
+	}
+
+	bool HTTPStream::direct() const
+	{
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+		return !_channel.has_value();
+#else
+		return true;
+#endif
+	}
+
+	HTTPSocket& HTTPStream::socket()
+	{
+		return _socket;
+	}
+
+}
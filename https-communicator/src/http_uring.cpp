@@ -0,0 +1,348 @@
+#include "headers.h"
+#include "http_uring.h"
+
+#if defined(HTTP_USE_IO_URING) && defined(__linux__)
+
+#include "http_logger.h"
+
+#include <cstring>
+#include <sys/socket.h>
+
+
+namespace communicator
+{
+
+	// --- HTTPUring Implementation ---
+
+	HTTPUring* HTTPUring::thread_instance()
+	{
+		thread_local std::unique_ptr<HTTPUring> ring;
+		thread_local bool attempted = false;
+
+		if (!attempted)
+		{
+			attempted = true;
+
+			auto candidate = std::make_unique<HTTPUring>();
+			if (candidate->open())
+				ring = std::move(candidate);
+			else
+				HTTP_LOG_WARN("io_uring is unavailable, falling back to socket I/O.");
+		}
+
+		return ring.get();
+	}
+
+	HTTPUring::~HTTPUring()
+	{
+		if (_bufferRing)
+			io_uring_free_buf_ring(&_ring, _bufferRing, URING_RECV_BUFFERS, URING_BUFFER_GROUP);
+
+		if (_open)
+			io_uring_queue_exit(&_ring);
+	}
+
+	bool HTTPUring::open()
+	{
+		// The ring never leaves its thread, so the kernel can skip cross-thread task work
+		io_uring_params params{};
+		params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+
+		int result = io_uring_queue_init_params(URING_QUEUE_DEPTH, &_ring, &params);
+		if (result < 0)
+		{
+			params = {};
+			result = io_uring_queue_init_params(URING_QUEUE_DEPTH, &_ring, &params);
+		}
+
+		if (result < 0)
+			return false;
+
+		_open = true;
+
+		// Without a fixed-file table every operation simply uses the plain descriptor
+		if (io_uring_register_files_sparse(&_ring, URING_FIXED_FILES) == 0)
+		{
+			for (unsigned slot = 0; slot < URING_FIXED_FILES; slot++)
+				_freeSlots[_freeCount++] = static_cast<int>(URING_FIXED_FILES - 1 - slot);
+		}
+
+		int err = 0;
+		_bufferRing = io_uring_setup_buf_ring(&_ring, URING_RECV_BUFFERS, URING_BUFFER_GROUP, 0, &err);
+		if (!_bufferRing)
+			return false;
+
+		_bufferMemory.resize(static_cast<size_t>(URING_RECV_BUFFERS) * URING_RECV_BUFFER_SIZE);
+
+		for (unsigned id = 0; id < URING_RECV_BUFFERS; id++)
+			io_uring_buf_ring_add(_bufferRing, buffer(static_cast<uint16_t>(id)), URING_RECV_BUFFER_SIZE, static_cast<unsigned short>(id), io_uring_buf_ring_mask(URING_RECV_BUFFERS), static_cast<int>(id));
+
+		io_uring_buf_ring_advance(_bufferRing, static_cast<int>(URING_RECV_BUFFERS));
+
+		return true;
+	}
+
+	int HTTPUring::acquire_file(int fd)
+	{
+		if (_freeCount == 0)
+			reap();
+
+		if (_freeCount == 0)
+			return -1;
+
+		int slot = _freeSlots[--_freeCount];
+		if (io_uring_register_files_update(&_ring, static_cast<unsigned>(slot), &fd, 1) != 1)
+		{
+			_freeSlots[_freeCount++] = slot;
+			return -1;
+		}
+
+		return slot;
+	}
+
+	void HTTPUring::release_file(int slot)
+	{
+		static int closedFd = -1;
+
+		io_uring_sqe* sqe = next_sqe();
+		io_uring_prep_files_update(sqe, &closedFd, 1, slot);
+
+		// Odd user data marks a slot release rather than an operation pointer
+		io_uring_sqe_set_data64(sqe, (static_cast<uint64_t>(slot) << 1) | 1);
+	}
+
+	io_uring_sqe* HTTPUring::next_sqe()
+	{
+		io_uring_sqe* sqe = io_uring_get_sqe(&_ring);
+		if (!sqe)
+		{
+			io_uring_submit(&_ring);
+			sqe = io_uring_get_sqe(&_ring);
+		}
+		return sqe;
+	}
+
+	void HTTPUring::submit()
+	{
+		io_uring_submit(&_ring);
+	}
+
+	uint8_t* HTTPUring::buffer(uint16_t id)
+	{
+		return _bufferMemory.data() + static_cast<size_t>(id) * URING_RECV_BUFFER_SIZE;
+	}
+
+	void HTTPUring::recycle(uint16_t id)
+	{
+		io_uring_buf_ring_add(_bufferRing, buffer(id), URING_RECV_BUFFER_SIZE, id, io_uring_buf_ring_mask(URING_RECV_BUFFERS), 0);
+		io_uring_buf_ring_advance(_bufferRing, 1);
+	}
+
+	void HTTPUring::reap()
+	{
+		io_uring_cqe* cqe;
+		unsigned head;
+		unsigned count = 0;
+
+		io_uring_for_each_cqe(&_ring, head, cqe)
+		{
+			count++;
+
+			uint64_t data = io_uring_cqe_get_data64(cqe);
+			if (data == 0)
+				continue;
+
+			if (data & 1)
+			{
+				_freeSlots[_freeCount++] = static_cast<int>(data >> 1);
+				continue;
+			}
+
+			reinterpret_cast<HTTPUringOperation*>(data)->complete(cqe->res, cqe->flags);
+		}
+
+		io_uring_cq_advance(&_ring, count);
+	}
+
+
+	// --- HTTPUringChannel Implementation ---
+
+	HTTPUringChannel::HTTPUringChannel(HTTPUring& ring, int fd)
+		: _ring(ring), _fd(fd), _slot(ring.acquire_file(fd))
+	{
+	}
+
+	HTTPUringChannel::~HTTPUringChannel()
+	{
+		if (_armed)
+		{
+			io_uring_sqe* sqe = _ring.next_sqe();
+			io_uring_prep_cancel64(sqe, reinterpret_cast<uint64_t>(static_cast<HTTPUringOperation*>(this)), 0);
+			io_uring_sqe_set_data64(sqe, 0);
+		}
+
+		// The table holds a reference to the socket, so the release has to reach the kernel before the socket is closed
+		if (_slot >= 0)
+			_ring.release_file(_slot);
+
+		if (_armed)
+			_ring.wait_until([&]() { return !_armed; });
+		else
+			_ring.submit();
+
+		// Bytes past the end of the exchange are dropped, as they would be with the asio::streambuf they were read into
+		while (_receivedCount > 0)
+		{
+			_ring.recycle(_received[_receivedHead].buffer);
+			_receivedHead = (_receivedHead + 1) % URING_RECV_BUFFERS;
+			_receivedCount--;
+		}
+	}
+
+	size_t HTTPUringChannel::write(const iovec* iov, size_t count, asio::error_code& ec)
+	{
+		msghdr message{};
+		message.msg_iov = const_cast<iovec*>(iov);
+		message.msg_iovlen = count;
+
+		SendOperation operation;
+
+		io_uring_sqe* sqe = _ring.next_sqe();
+		io_uring_prep_sendmsg(sqe, _fd, &message, MSG_NOSIGNAL);
+		prepare_target(sqe);
+		io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(static_cast<HTTPUringOperation*>(&operation)));
+
+		// The receive for the response goes into the same submission as the request
+		if (!_armed && _terminal == NO_RESULT)
+			arm_recv();
+
+		ec = _ring.wait_until([&]() { return operation.done; });
+		if (ec)
+			return 0;
+
+		if (operation.result < 0)
+		{
+			ec = asio::error_code(-operation.result, asio::error::get_system_category());
+			return 0;
+		}
+
+		return static_cast<size_t>(operation.result);
+	}
+
+	size_t HTTPUringChannel::read(const iovec* iov, size_t count, asio::error_code& ec)
+	{
+		wait_read(ec);
+		if (ec)
+			return 0;
+
+		if (_receivedCount == 0)
+		{
+			ec = _terminal == 0 ? asio::error_code(asio::error::eof) : asio::error_code(-_terminal, asio::error::get_system_category());
+			return 0;
+		}
+
+		size_t copied = 0;
+		size_t index = 0;
+		size_t offset = 0;
+
+		while (_receivedCount > 0 && index < count)
+		{
+			Received& front = _received[_receivedHead];
+
+			size_t size = std::min<size_t>(front.length - front.offset, iov[index].iov_len - offset);
+			std::memcpy(static_cast<uint8_t*>(iov[index].iov_base) + offset, _ring.buffer(front.buffer) + front.offset, size);
+
+			copied += size;
+			offset += size;
+			front.offset += static_cast<uint32_t>(size);
+
+			if (offset == iov[index].iov_len)
+			{
+				index++;
+				offset = 0;
+			}
+
+			if (front.offset == front.length)
+			{
+				_ring.recycle(front.buffer);
+				_receivedHead = (_receivedHead + 1) % URING_RECV_BUFFERS;
+				_receivedCount--;
+			}
+		}
+
+		return copied;
+	}
+
+	void HTTPUringChannel::wait_read(asio::error_code& ec)
+	{
+		ec = {};
+
+		while (_receivedCount == 0 && _terminal == NO_RESULT)
+		{
+			// A multishot receive stops when the buffer ring runs dry, it is simply armed again
+			if (!_armed)
+				arm_recv();
+
+			ec = _ring.wait_until([&]() { return _receivedCount > 0 || !_armed; });
+			if (ec)
+				return;
+		}
+	}
+
+	void HTTPUringChannel::wait_read(asio::error_code& ec, std::chrono::steady_clock::time_point deadline)
+	{
+		ec = {};
+
+		while (_receivedCount == 0 && _terminal == NO_RESULT)
+		{
+			if (!_armed)
+				arm_recv();
+
+			// The receive stays armed past a timeout, whatever it brings in is read by the next call
+			ec = _ring.wait_until([&]() { return _receivedCount > 0 || !_armed; }, deadline);
+			if (ec)
+				return;
+		}
+	}
+
+	void HTTPUringChannel::complete(int result, uint32_t flags)
+	{
+		if (result > 0)
+		{
+			_received[(_receivedHead + _receivedCount) % URING_RECV_BUFFERS] = { static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT), static_cast<uint32_t>(result), 0 };
+			_receivedCount++;
+		}
+		else if (result != -ENOBUFS || _receivedCount == 0)
+		{
+			// Running out of buffers is only recoverable while this channel holds some of them
+			_terminal = result;
+		}
+
+		if (!(flags & IORING_CQE_F_MORE))
+			_armed = false;
+	}
+
+	void HTTPUringChannel::arm_recv()
+	{
+		io_uring_sqe* sqe = _ring.next_sqe();
+		io_uring_prep_recv_multishot(sqe, _fd, nullptr, 0, 0);
+		prepare_target(sqe);
+		sqe->flags |= IOSQE_BUFFER_SELECT;
+		sqe->buf_group = URING_BUFFER_GROUP;
+		io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(static_cast<HTTPUringOperation*>(this)));
+
+		_armed = true;
+	}
+
+	void HTTPUringChannel::prepare_target(io_uring_sqe* sqe)
+	{
+		if (_slot >= 0)
+		{
+			sqe->fd = _slot;
+			sqe->flags |= IOSQE_FIXED_FILE;
+		}
+	}
+
+}
+
+#endif
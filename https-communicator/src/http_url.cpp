@@ -0,0 +1,372 @@
+#include "headers.h"
+#include "http_url.h"
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		enum CharClass : uint8_t
+		{
+			SchemeChar = 1 << 0, // ALPHA / DIGIT / "+" / "-" / "."
+			HostChar = 1 << 1, // unreserved / pct-encoded / sub-delims
+			Unreserved = 1 << 2, // ALPHA / DIGIT / "-" / "." / "_" / "~"
+			Visible = 1 << 3, // Anything printable, paths and queries are taken as the server will see them
+			HexDigit = 1 << 4
+		};
+
+		constexpr std::array<uint8_t, 256> make_char_classes()
+		{
+			std::array<uint8_t, 256> table{};
+
+			for (int c = 0x21; c < 0x7F; c++)
+				table[c] |= Visible;
+
+			for (int c = 0x80; c < 0x100; c++)
+				table[c] |= Visible;
+
+			for (int c = 'a'; c <= 'z'; c++)
+				table[c] |= SchemeChar | HostChar | Unreserved;
+			for (int c = 'A'; c <= 'Z'; c++)
+				table[c] |= SchemeChar | HostChar | Unreserved;
+			for (int c = '0'; c <= '9'; c++)
+				table[c] |= SchemeChar | HostChar | Unreserved | HexDigit;
+			for (int c = 'a'; c <= 'f'; c++)
+				table[c] |= HexDigit;
+			for (int c = 'A'; c <= 'F'; c++)
+				table[c] |= HexDigit;
+
+			for (char c : std::string_view("+-."))
+				table[static_cast<uint8_t>(c)] |= SchemeChar;
+			for (char c : std::string_view("-._~"))
+				table[static_cast<uint8_t>(c)] |= HostChar | Unreserved;
+			for (char c : std::string_view("%!$&'()*+,;="))
+				table[static_cast<uint8_t>(c)] |= HostChar;
+
+			return table;
+		}
+
+		constexpr std::array<uint8_t, 256> charClasses = make_char_classes();
+
+		bool is(char c, CharClass charClass)
+		{
+			return (charClasses[static_cast<uint8_t>(c)] & charClass) != 0;
+		}
+
+		bool all_of(std::string_view text, CharClass charClass)
+		{
+			for (char c : text)
+			{
+				if (!is(c, charClass))
+					return false;
+			}
+			return true;
+		}
+	}
+
+
+	HTTPErr parse_url(std::string_view url, HTTPURLView& out)
+	{
+		out = HTTPURLView{};
+
+		size_t size = url.size();
+		size_t i = 0;
+
+		// scheme ":" "//"
+		if (size == 0 || !std::isalpha(static_cast<unsigned char>(url[0])))
+			return HTTPErr::InvalidURL;
+
+		while (i < size && is(url[i], SchemeChar))
+			i++;
+
+		if (i + 2 >= size || url[i] != ':' || url[i + 1] != '/' || url[i + 2] != '/')
+			return HTTPErr::InvalidURL;
+
+		out.scheme = url.substr(0, i);
+		i += 3;
+
+		// authority = [ userinfo "@" ] host [ ":" port ]
+		size_t authorityStart = i;
+		size_t at = std::string_view::npos;
+
+		while (i < size && url[i] != '/' && url[i] != '?' && url[i] != '#')
+		{
+			if (!is(url[i], Visible))
+				return HTTPErr::InvalidURL;
+
+			if (url[i] == '@')
+				at = i;
+			i++;
+		}
+
+		std::string_view authority = url.substr(authorityStart, i - authorityStart);
+		if (at != std::string_view::npos)
+		{
+			out.userinfo = url.substr(authorityStart, at - authorityStart);
+			authority = url.substr(at + 1, i - at - 1);
+		}
+
+		std::string_view portText;
+
+		if (!authority.empty() && authority.front() == '[')
+		{
+			size_t close = authority.find(']');
+			if (close == std::string_view::npos)
+				return HTTPErr::InvalidURL;
+
+			out.host = authority.substr(1, close - 1);
+			out.ipv6 = true;
+
+			for (char c : out.host)
+			{
+				if (!is(c, HexDigit) && c != ':' && c != '.')
+					return HTTPErr::InvalidURL;
+			}
+
+			std::string_view rest = authority.substr(close + 1);
+			if (!rest.empty())
+			{
+				if (rest.front() != ':')
+					return HTTPErr::InvalidURL;
+				portText = rest.substr(1);
+			}
+		}
+		else
+		{
+			size_t colon = authority.find(':');
+			out.host = authority.substr(0, colon);
+			if (colon != std::string_view::npos)
+				portText = authority.substr(colon + 1);
+
+			if (!all_of(out.host, HostChar))
+				return HTTPErr::InvalidURL;
+		}
+
+		if (out.host.empty())
+			return HTTPErr::InvalidURL;
+
+		// An empty port after the colon is allowed and means the default one
+		out.port = portText.empty() ? default_port(out.scheme) : portText;
+
+		if (!out.port.empty())
+		{
+			uint32_t port = 0;
+			auto [end, errc] = std::from_chars(out.port.data(), out.port.data() + out.port.size(), port);
+			if (errc != std::errc() || end != out.port.data() + out.port.size() || port > 65535)
+				return HTTPErr::InvalidURL;
+
+			out.portNumber = static_cast<uint16_t>(port);
+		}
+
+		// path [ "?" query ] [ "#" fragment ]
+		size_t pathStart = i;
+		while (i < size && url[i] != '?' && url[i] != '#')
+		{
+			if (!is(url[i], Visible))
+				return HTTPErr::InvalidURL;
+			i++;
+		}
+		out.path = url.substr(pathStart, i - pathStart);
+
+		if (i < size && url[i] == '?')
+		{
+			size_t queryStart = ++i;
+			while (i < size && url[i] != '#')
+			{
+				if (!is(url[i], Visible))
+					return HTTPErr::InvalidURL;
+				i++;
+			}
+			out.query = url.substr(queryStart, i - queryStart);
+		}
+
+		out.target = url.substr(pathStart, i - pathStart);
+
+		if (i < size)
+		{
+			out.fragment = url.substr(i + 1);
+			if (!all_of(out.fragment, Visible))
+				return HTTPErr::InvalidURL;
+		}
+
+		return HTTPErr::None;
+	}
+
+	std::expected<HTTPURLView, HTTPErr> parse_url(std::string_view url)
+	{
+		HTTPURLView view;
+
+		HTTPErr err = parse_url(url, view);
+		if (err != HTTPErr::None)
+		{
+			return std::unexpected(err);
+		}
+
+		return view;
+	}
+
+	std::expected<HTTPURLView, HTTPErr> parse_http_url(std::string_view url)
+	{
+		auto view = parse_url(url);
+		if (!view.has_value() || iequals_ascii(view->scheme, "http"))
+		{
+			return view;
+		}
+
+		if (!iequals_ascii(view->scheme, "http+unix") || !view->userinfo.empty() || view->ipv6 || !view->port.empty())
+		{
+			return std::unexpected(HTTPErr::InvalidURL);
+		}
+
+		for (size_t i = 0; i < view->host.size(); i++)
+		{
+			if (view->host[i] == '%' && (i + 2 >= view->host.size() || !is(view->host[i + 1], HexDigit) || !is(view->host[i + 2], HexDigit)))
+				return std::unexpected(HTTPErr::InvalidURL);
+		}
+
+		// The socket is named by the authority, the request itself goes to a generic local host
+		view->socketPath = view->host;
+		view->host = "localhost";
+		return view;
+	}
+
+	std::string_view default_port(std::string_view scheme)
+	{
+		if (iequals_ascii(scheme, "http") || iequals_ascii(scheme, "ws"))
+			return "80";
+		if (iequals_ascii(scheme, "https") || iequals_ascii(scheme, "wss"))
+			return "443";
+		return {};
+	}
+
+	bool iequals_ascii(std::string_view a, std::string_view b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+				return false;
+		}
+		return true;
+	}
+
+	void percent_encode(std::string_view value, std::string& out)
+	{
+		constexpr char hex[] = "0123456789ABCDEF";
+
+		for (char c : value)
+		{
+			if (is(c, Unreserved))
+			{
+				out.push_back(c);
+				continue;
+			}
+
+			uint8_t byte = static_cast<uint8_t>(c);
+			char escaped[3] = { '%', hex[byte >> 4], hex[byte & 0x0F] };
+			out.append(escaped, sizeof(escaped));
+		}
+	}
+
+
+	HTTPErr percent_decode(std::string_view value, std::string& out)
+	{
+		for (size_t i = 0; i < value.size(); i++)
+		{
+			if (value[i] != '%')
+			{
+				out.push_back(value[i]);
+				continue;
+			}
+
+			if (i + 2 >= value.size() || !is(value[i + 1], HexDigit) || !is(value[i + 2], HexDigit))
+				return HTTPErr::InvalidURL;
+
+			uint8_t byte = 0;
+			std::from_chars(value.data() + i + 1, value.data() + i + 3, byte, 16);
+			out.push_back(static_cast<char>(byte));
+			i += 2;
+		}
+		return HTTPErr::None;
+	}
+
+	void append_host(std::string_view host, std::string& out)
+	{
+		// A reg-name or IPv4 address never holds a ':', an already bracketed literal is kept as is
+		bool ipv6 = host.find(':') != std::string_view::npos && !host.starts_with('[');
+		if (ipv6)
+			out.push_back('[');
+		out.append(host);
+		if (ipv6)
+			out.push_back(']');
+	}
+
+
+	// --- HTTPURLBuilder Implementation ---
+
+	HTTPURLBuilder& HTTPURLBuilder::clear()
+	{
+		_buffer.clear();
+		_hasQuery = false;
+		return *this;
+	}
+
+	HTTPURLBuilder& HTTPURLBuilder::origin(std::string_view scheme, std::string_view host, std::string_view port)
+	{
+		_buffer.append(scheme).append("://");
+		append_host(host, _buffer);
+
+		if (!port.empty() && port != default_port(scheme))
+			_buffer.append(":").append(port);
+
+		return *this;
+	}
+
+	HTTPURLBuilder& HTTPURLBuilder::path(std::string_view path)
+	{
+		if (path.empty() || path.front() != '/')
+			_buffer.push_back('/');
+		_buffer.append(path);
+		return *this;
+	}
+
+	HTTPURLBuilder& HTTPURLBuilder::segment(std::string_view segment)
+	{
+		if (_buffer.empty() || _buffer.back() != '/')
+			_buffer.push_back('/');
+		percent_encode(segment, _buffer);
+		return *this;
+	}
+
+	HTTPURLBuilder& HTTPURLBuilder::query(std::string_view key, std::string_view value)
+	{
+		_buffer.push_back(_hasQuery ? '&' : '?');
+		_hasQuery = true;
+
+		percent_encode(key, _buffer);
+		_buffer.push_back('=');
+		percent_encode(value, _buffer);
+		return *this;
+	}
+
+	HTTPURLBuilder& HTTPURLBuilder::fragment(std::string_view fragment)
+	{
+		_buffer.push_back('#');
+		percent_encode(fragment, _buffer);
+		return *this;
+	}
+
+	std::string_view HTTPURLBuilder::view() const
+	{
+		return _buffer;
+	}
+
+	std::string HTTPURLBuilder::str() const
+	{
+		return _buffer;
+	}
+
+}
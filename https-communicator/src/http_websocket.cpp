@@ -0,0 +1,929 @@
+#include "headers.h"
+#include "http_websocket.h"
+#include "http_communicator.h"
+#include "http_logger.h"
+
+#include <cstring>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#include <bcrypt.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <sys/random.h>
+#else
+#include <stdlib.h>
+#endif
+
+#if defined(__AVX2__)
+#define HTTP_WS_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HTTP_WS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define HTTP_WS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(HTTP_USE_ZLIB)
+#include <zlib.h>
+#endif
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr std::string_view WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+		constexpr size_t RECEIVE_BUFFER_SIZE = 64 * 1024;
+
+		constexpr size_t DEFLATE_THRESHOLD = 64; // Shorter messages go out uncompressed, deflate would only grow them
+
+		constexpr std::array<uint8_t, 4> DEFLATE_TAIL = { 0x00, 0x00, 0xFF, 0xFF };
+
+		bool fill_random(std::span<uint8_t> out)
+		// The operating system's CSPRNG, RFC 6455 needs nonces and masking keys an intermediary cannot predict
+		{
+#ifdef PLATFORM_WINDOWS
+			return BCRYPT_SUCCESS(BCryptGenRandom(nullptr, out.data(), static_cast<ULONG>(out.size()), BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+#elif defined(__linux__)
+			size_t filled = 0;
+			while (filled < out.size())
+			{
+				ssize_t received = getrandom(out.data() + filled, out.size() - filled, 0);
+				if (received < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				filled += static_cast<size_t>(received);
+			}
+			return true;
+#else
+			arc4random_buf(out.data(), out.size());
+			return true;
+#endif
+		}
+
+		std::array<uint8_t, 20> sha1(std::string_view input)
+		// Only for checking Sec-WebSocket-Accept
+		{
+			uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+			std::string message(input);
+			uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+			message.push_back(static_cast<char>(0x80));
+			while (message.size() % 64 != 56)
+				message.push_back('\0');
+			for (int i = 7; i >= 0; i--)
+				message.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+
+			auto rotl = [](uint32_t value, int count) { return (value << count) | (value >> (32 - count)); };
+
+			for (size_t block = 0; block < message.size(); block += 64)
+			{
+				uint32_t w[80];
+				for (int i = 0; i < 16; i++)
+				{
+					const auto* p = reinterpret_cast<const uint8_t*>(message.data() + block + i * 4);
+					w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+				}
+				for (int i = 16; i < 80; i++)
+					w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+				uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+				for (int i = 0; i < 80; i++)
+				{
+					uint32_t f, k;
+					if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+					else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+					else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+					else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+					uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+					e = d;
+					d = c;
+					c = rotl(b, 30);
+					b = a;
+					a = temp;
+				}
+
+				h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+			}
+
+			std::array<uint8_t, 20> digest;
+			for (int i = 0; i < 20; i++)
+				digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+			return digest;
+		}
+
+		std::string base64(std::span<const uint8_t> data)
+		{
+			constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+			std::string out;
+			out.reserve((data.size() + 2) / 3 * 4);
+
+			for (size_t i = 0; i < data.size(); i += 3)
+			{
+				uint32_t group = uint32_t(data[i]) << 16;
+				if (i + 1 < data.size()) group |= uint32_t(data[i + 1]) << 8;
+				if (i + 2 < data.size()) group |= uint32_t(data[i + 2]);
+
+				out.push_back(alphabet[(group >> 18) & 0x3F]);
+				out.push_back(alphabet[(group >> 12) & 0x3F]);
+				out.push_back(i + 1 < data.size() ? alphabet[(group >> 6) & 0x3F] : '=');
+				out.push_back(i + 2 < data.size() ? alphabet[group & 0x3F] : '=');
+			}
+
+			return out;
+		}
+
+		bool contains_token(std::string_view list, std::string_view token)
+		// Case-insensitive search of a comma separated header value
+		{
+			while (!list.empty())
+			{
+				size_t comma = list.find(',');
+				if (iequals_ascii(trim_header_value(list.substr(0, comma)), token))
+					return true;
+				if (comma == std::string_view::npos)
+					break;
+				list.remove_prefix(comma + 1);
+			}
+			return false;
+		}
+
+		bool is_control(uint8_t opcode)
+		{
+			return (opcode & 0x8) != 0;
+		}
+	}
+
+
+	// --- Deflate State ---
+
+	struct HTTPWebSocket::Deflate
+	// permessage-deflate (RFC 7692): raw deflate streams, each message flushed and its 00 00 FF FF tail dropped
+	{
+#if defined(HTTP_USE_ZLIB)
+		z_stream deflater{};
+		z_stream inflater{};
+		bool deflaterReady = false;
+		bool inflaterReady = false;
+
+		bool resetDeflater = false; // client_no_context_takeover, every message starts from an empty window
+		bool resetInflater = false; // server_no_context_takeover
+
+		std::vector<uint8_t> compressed;
+		std::vector<uint8_t> inflated;
+
+		bool init(int clientWindowBits)
+		{
+			deflaterReady = deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -clientWindowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+			inflaterReady = inflateInit2(&inflater, -15) == Z_OK;
+			return deflaterReady && inflaterReady;
+		}
+
+		~Deflate()
+		{
+			if (deflaterReady)
+				deflateEnd(&deflater);
+			if (inflaterReady)
+				inflateEnd(&inflater);
+		}
+#endif
+	};
+
+
+	// --- HTTPWebSocket Implementation ---
+
+	HTTPWebSocket::HTTPWebSocket() = default;
+
+	HTTPErr HTTPWebSocket::connect(
+		std::string_view url,
+		const HTTPWebSocketOptions& options,
+		const std::unordered_map<std::string, std::string>& headers,
+		const HTTPSocketOptions& socketOptions)
+	{
+		fail();
+
+		auto view = parse_url(url);
+		if (!view.has_value())
+		{
+			return view.error();
+		}
+
+		if ((!iequals_ascii(view->scheme, "ws") && !iequals_ascii(view->scheme, "http")) || view->host.empty())
+		{
+			// wss needs TLS, which the library does not have yet
+			HTTP_LOG_ERROR("Unsupported WebSocket URL: {}", url);
+			return HTTPErr::InvalidURL;
+		}
+
+		_options = options;
+		_protocol.clear();
+		_closeSent = false;
+		_deflate.reset();
+		_start = 0;
+		_size = 0;
+		if (_receive.size() < RECEIVE_BUFFER_SIZE)
+			_receive.resize(RECEIVE_BUFFER_SIZE);
+
+		auto socketResult = create_and_connect_socket(_ioContext, view->host, view->port, options.connectTimeout, nullptr, socketOptions);
+		if (!socketResult.has_value())
+		{
+			return socketResult.error();
+		}
+
+		_socket.emplace(std::move(*socketResult));
+
+		std::array<uint8_t, 16> nonce;
+		if (!fill_random(nonce))
+		{
+			HTTP_LOG_ERROR("Failed to read the system random source.");
+			fail();
+			return HTTPErr::RandomSourceFailed;
+		}
+		std::string key = base64(nonce);
+
+		std::unordered_map<std::string, std::string> proxiedHeaders;
+		std::unordered_map<std::string, std::string> requestHeaders = proxy_request_headers(headers, socketOptions.proxy, proxiedHeaders);
+		requestHeaders["Upgrade"] = "websocket";
+		requestHeaders["Sec-WebSocket-Key"] = key;
+		requestHeaders["Sec-WebSocket-Version"] = "13";
+		if (!options.protocol.empty())
+			requestHeaders["Sec-WebSocket-Protocol"] = options.protocol;
+#if defined(HTTP_USE_ZLIB)
+		if (options.permessageDeflate)
+			requestHeaders["Sec-WebSocket-Extensions"] = "permessage-deflate; client_max_window_bits";
+#endif
+
+		std::string proxiedTarget;
+		auto requestResult = write_str_request(
+			HTTPMethod::GET,
+			HTTPContent::None,
+			HTTPConnection::Upgrade,
+			view->host,
+			proxy_request_target(view->host, view->port, view->target, socketOptions.proxy, proxiedTarget),
+			"",
+			requestHeaders);
+		if (!requestResult.has_value())
+		{
+			fail();
+			return requestResult.error();
+		}
+
+		HTTPStream stream(*_socket);
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(*requestResult), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending WebSocket handshake: {}:{}", ec.category().name(), ec.value());
+			fail();
+			return to_http_err(ec, HTTPErr::SendFailed);
+		}
+
+		asio::streambuf responseBuffer;
+		size_t headSize = asio::read_until(stream, responseBuffer, "\r\n\r\n", ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error reading WebSocket handshake: {}:{}", ec.category().name(), ec.value());
+			fail();
+			return to_http_err(ec, HTTPErr::ReceiveFailed);
+		}
+
+		std::string_view head(static_cast<const char*>(responseBuffer.data().data()), headSize);
+
+		size_t lineEnd = head.find("\r\n");
+		std::string_view statusLine = head.substr(0, lineEnd);
+		if (!statusLine.starts_with("HTTP/1.1 101"))
+		{
+			HTTP_LOG_WARN("WebSocket upgrade refused: {}", statusLine);
+			fail();
+			return HTTPErr::WebSocketHandshakeFailed;
+		}
+
+		std::string expectedAccept = key + std::string(WEBSOCKET_GUID);
+		expectedAccept = base64(sha1(expectedAccept));
+
+		bool upgraded = false;
+		bool connectionUpgrade = false;
+		bool accepted = false;
+		std::string_view extensions;
+
+		head.remove_prefix(lineEnd + 2);
+		while (!head.empty())
+		{
+			lineEnd = head.find("\r\n");
+			std::string_view line = head.substr(0, lineEnd);
+			head.remove_prefix(lineEnd == std::string_view::npos ? head.size() : lineEnd + 2);
+
+			size_t colon = line.find(':');
+			if (colon == std::string_view::npos)
+				continue;
+
+			std::string_view name = line.substr(0, colon);
+			std::string_view value = trim_header_value(line.substr(colon + 1));
+
+			if (iequals_ascii(name, "Upgrade"))
+				upgraded = iequals_ascii(value, "websocket");
+			else if (iequals_ascii(name, "Connection"))
+				connectionUpgrade = contains_token(value, "upgrade");
+			else if (iequals_ascii(name, "Sec-WebSocket-Accept"))
+				accepted = value == expectedAccept;
+			else if (iequals_ascii(name, "Sec-WebSocket-Protocol"))
+				_protocol = value;
+			else if (iequals_ascii(name, "Sec-WebSocket-Extensions"))
+				extensions = value;
+		}
+
+		if (!upgraded || !connectionUpgrade || !accepted)
+		{
+			HTTP_LOG_WARN("Invalid WebSocket handshake response from {}:{}", view->host, view->port);
+			fail();
+			return HTTPErr::WebSocketHandshakeFailed;
+		}
+
+		if (!extensions.empty())
+		{
+#if defined(HTTP_USE_ZLIB)
+			if (!options.permessageDeflate || !extensions.starts_with("permessage-deflate"))
+			{
+				HTTP_LOG_WARN("Server enabled an extension that was not offered: {}", extensions);
+				fail();
+				return HTTPErr::WebSocketHandshakeFailed;
+			}
+
+			auto deflate = std::make_unique<Deflate>();
+			int clientWindowBits = 15;
+
+			std::string_view params = extensions.substr(std::string_view("permessage-deflate").size());
+			while (!params.empty())
+			{
+				size_t semicolon = params.find(';');
+				std::string_view param = trim_header_value(params.substr(0, semicolon));
+				params.remove_prefix(semicolon == std::string_view::npos ? params.size() : semicolon + 1);
+
+				if (iequals_ascii(param, "client_no_context_takeover"))
+					deflate->resetDeflater = true;
+				else if (iequals_ascii(param, "server_no_context_takeover"))
+					deflate->resetInflater = true;
+				else if (param.starts_with("client_max_window_bits="))
+				{
+					std::string_view value = param.substr(23);
+					if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+						value = value.substr(1, value.size() - 2);
+
+					auto [end, errc] = std::from_chars(value.data(), value.data() + value.size(), clientWindowBits);
+					if (errc != std::errc() || end != value.data() + value.size())
+						clientWindowBits = 0;
+				}
+			}
+
+			// zlib cannot write raw streams with an 8 bit window, and a larger one would exceed what the server granted
+			if (clientWindowBits < 9 || clientWindowBits > 15)
+			{
+				HTTP_LOG_WARN("Unusable client_max_window_bits in: {}", extensions);
+				fail();
+				return HTTPErr::WebSocketHandshakeFailed;
+			}
+
+			if (!deflate->init(clientWindowBits))
+			{
+				fail();
+				return HTTPErr::WebSocketHandshakeFailed;
+			}
+
+			_deflate = std::move(deflate);
+#else
+			HTTP_LOG_WARN("Server enabled an extension that was not offered: {}", extensions);
+			fail();
+			return HTTPErr::WebSocketHandshakeFailed;
+#endif
+		}
+
+		responseBuffer.consume(headSize);
+
+		// Frames the server sent right behind its answer
+		size_t early = responseBuffer.size();
+		if (early > _receive.size())
+			_receive.resize(early);
+		std::memcpy(_receive.data(), responseBuffer.data().data(), early);
+		_size = early;
+
+		HTTP_LOG_DEBUG("WebSocket open to {}:{}{}", view->host, view->port, view->target);
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPWebSocket::send_text(std::string_view text)
+	{
+		return send_message(HTTPWebSocketOpcode::Text, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(text.data()), text.size()));
+	}
+
+	HTTPErr HTTPWebSocket::send_binary(std::span<const uint8_t> data)
+	{
+		return send_message(HTTPWebSocketOpcode::Binary, data);
+	}
+
+	HTTPErr HTTPWebSocket::ping(std::span<const uint8_t> payload)
+	{
+		if (payload.size() > 125)
+		{
+			return HTTPErr::MessageTooLarge;
+		}
+
+		return send_frame(HTTPWebSocketOpcode::Ping, payload);
+	}
+
+	HTTPErr HTTPWebSocket::close(uint16_t code, std::string_view reason)
+	{
+		if (!_socket)
+		{
+			return HTTPErr::None;
+		}
+
+		if (!_closeSent)
+		{
+			std::string payload;
+			payload.push_back(static_cast<char>(code >> 8));
+			payload.push_back(static_cast<char>(code & 0xFF));
+			payload.append(reason.substr(0, 123));
+
+			HTTPErr err = send_frame(HTTPWebSocketOpcode::Close, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()));
+			if (err != HTTPErr::None)
+			{
+				fail();
+				return err;
+			}
+			_closeSent = true;
+		}
+
+		// Messages still in flight are dropped until the server's Close arrives
+		while (_socket)
+		{
+			auto message = receive();
+			if (!message.has_value() || message->opcode == HTTPWebSocketOpcode::Close)
+				break;
+		}
+
+		fail();
+		return HTTPErr::None;
+	}
+
+	std::expected<HTTPWebSocketMessage, HTTPErr> HTTPWebSocket::receive()
+	{
+		if (!_socket)
+		{
+			return std::unexpected(HTTPErr::WebSocketClosed);
+		}
+
+		// Offsets are relative to _start, which stays on the first frame of the message until it is complete,
+		// so moving the unread bytes to the front of the buffer never loses assembled fragments
+		size_t pos = 0;
+		bool inMessage = false;
+		bool compressed = false;
+		HTTPWebSocketOpcode messageOpcode = HTTPWebSocketOpcode::Binary;
+		size_t messageStart = 0;
+		size_t messageLength = 0;
+
+		while (true)
+		{
+			HTTPErr err = fill(pos + 2);
+			if (err != HTTPErr::None)
+				return std::unexpected(err);
+
+			const uint8_t* frame = _receive.data() + _start + pos;
+			bool fin = (frame[0] & 0x80) != 0;
+			bool rsv1 = (frame[0] & 0x40) != 0;
+			uint8_t opcode = frame[0] & 0x0F;
+			bool masked = (frame[1] & 0x80) != 0;
+			uint64_t length = frame[1] & 0x7F;
+
+			size_t headerSize = 2 + (length == 126 ? 2 : length == 127 ? 8 : 0) + (masked ? 4 : 0);
+
+			bool invalid = (frame[0] & 0x30) != 0 ||
+				(rsv1 && (!_deflate || is_control(opcode) || opcode == 0)) ||
+				(is_control(opcode) && (!fin || length > 125));
+			if (invalid)
+			{
+				HTTP_LOG_WARN("Invalid WebSocket frame header: {:#04x} {:#04x}", frame[0], frame[1]);
+				fail();
+				return std::unexpected(HTTPErr::WebSocketProtocolError);
+			}
+
+			err = fill(pos + headerSize);
+			if (err != HTTPErr::None)
+				return std::unexpected(err);
+			frame = _receive.data() + _start + pos;
+
+			if (length >= 126)
+			{
+				size_t bytes = length == 126 ? 2 : 8;
+				length = 0;
+				for (size_t i = 0; i < bytes; i++)
+					length = (length << 8) | frame[2 + i];
+			}
+
+			if (length > _options.maxMessageSize || messageLength + length > _options.maxMessageSize)
+			{
+				HTTP_LOG_WARN("WebSocket message over {} bytes.", _options.maxMessageSize);
+				fail();
+				return std::unexpected(HTTPErr::MessageTooLarge);
+			}
+
+			err = fill(pos + headerSize + static_cast<size_t>(length));
+			if (err != HTTPErr::None)
+				return std::unexpected(err);
+			frame = _receive.data() + _start + pos;
+
+			uint8_t* payload = _receive.data() + _start + pos + headerSize;
+			if (masked)
+			{
+				std::array<uint8_t, 4> key;
+				std::memcpy(key.data(), frame + headerSize - 4, 4);
+				mask_websocket_payload(std::span<uint8_t>(payload, static_cast<size_t>(length)), key);
+			}
+
+			size_t frameEnd = pos + headerSize + static_cast<size_t>(length);
+
+			if (is_control(opcode))
+			{
+				auto control = static_cast<HTTPWebSocketOpcode>(opcode);
+				std::span<const uint8_t> data(payload, static_cast<size_t>(length));
+
+				if (control == HTTPWebSocketOpcode::Close)
+				{
+					if (!_closeSent)
+					{
+						// The status code goes back, the reason is not repeated
+						send_frame(HTTPWebSocketOpcode::Close, data.first(std::min<size_t>(data.size(), 2)));
+						_closeSent = true;
+					}
+
+					_start += frameEnd;
+					fail();
+					return HTTPWebSocketMessage{ control, data };
+				}
+
+				if (control == HTTPWebSocketOpcode::Ping)
+				{
+					err = send_frame(HTTPWebSocketOpcode::Pong, data);
+					if (err != HTTPErr::None)
+						return std::unexpected(err);
+				}
+				else if (control != HTTPWebSocketOpcode::Pong)
+				{
+					fail();
+					return std::unexpected(HTTPErr::WebSocketProtocolError);
+				}
+
+				// A control frame between fragments stays where it is, the next fragment is moved over it
+				if (inMessage)
+				{
+					pos = frameEnd;
+				}
+				else
+				{
+					_start += frameEnd;
+					pos = 0;
+				}
+				continue;
+			}
+
+			if (opcode == 0)
+			{
+				if (!inMessage)
+				{
+					fail();
+					return std::unexpected(HTTPErr::WebSocketProtocolError);
+				}
+
+				std::memmove(_receive.data() + _start + messageStart + messageLength, payload, static_cast<size_t>(length));
+				messageLength += static_cast<size_t>(length);
+			}
+			else if (opcode == 1 || opcode == 2)
+			{
+				if (inMessage)
+				{
+					fail();
+					return std::unexpected(HTTPErr::WebSocketProtocolError);
+				}
+
+				inMessage = true;
+				compressed = rsv1;
+				messageOpcode = static_cast<HTTPWebSocketOpcode>(opcode);
+				messageStart = pos + headerSize;
+				messageLength = static_cast<size_t>(length);
+			}
+			else
+			{
+				HTTP_LOG_WARN("Unknown WebSocket opcode: {}", opcode);
+				fail();
+				return std::unexpected(HTTPErr::WebSocketProtocolError);
+			}
+
+			pos = frameEnd;
+			if (!fin)
+				continue;
+
+			const uint8_t* data = _receive.data() + _start + messageStart;
+			_start += pos;
+
+			if (!compressed)
+			{
+				return HTTPWebSocketMessage{ messageOpcode, std::span<const uint8_t>(data, messageLength) };
+			}
+
+#if defined(HTTP_USE_ZLIB)
+			Deflate& deflate = *_deflate;
+			deflate.inflated.clear();
+
+			auto inflate_from = [&](const uint8_t* input, size_t size)
+				{
+					deflate.inflater.next_in = const_cast<Bytef*>(input);
+					deflate.inflater.avail_in = static_cast<uInt>(size);
+
+					while (deflate.inflater.avail_in > 0)
+					{
+						size_t offset = deflate.inflated.size();
+						size_t room = std::max<size_t>(size * 2, 4096);
+						if (offset + room > _options.maxMessageSize + 4096)
+							return HTTPErr::MessageTooLarge;
+
+						deflate.inflated.resize(offset + room);
+						deflate.inflater.next_out = deflate.inflated.data() + offset;
+						deflate.inflater.avail_out = static_cast<uInt>(room);
+
+						int result = ::inflate(&deflate.inflater, Z_SYNC_FLUSH);
+						deflate.inflated.resize(offset + room - deflate.inflater.avail_out);
+
+						if (result != Z_OK && result != Z_BUF_ERROR)
+							return HTTPErr::WebSocketProtocolError;
+					}
+					return HTTPErr::None;
+				};
+
+			err = inflate_from(data, messageLength);
+			if (err == HTTPErr::None)
+				err = inflate_from(DEFLATE_TAIL.data(), DEFLATE_TAIL.size());
+			if (err == HTTPErr::None && deflate.inflated.size() > _options.maxMessageSize)
+				err = HTTPErr::MessageTooLarge;
+
+			if (err != HTTPErr::None)
+			{
+				HTTP_LOG_WARN("Failed to inflate WebSocket message: {}", to_string(err));
+				fail();
+				return std::unexpected(err);
+			}
+
+			if (deflate.resetInflater)
+				inflateReset(&deflate.inflater);
+
+			return HTTPWebSocketMessage{ messageOpcode, std::span<const uint8_t>(deflate.inflated) };
+#else
+			fail();
+			return std::unexpected(HTTPErr::WebSocketProtocolError);
+#endif
+		}
+	}
+
+	bool HTTPWebSocket::is_open() const
+	{
+		return _socket.has_value();
+	}
+
+	bool HTTPWebSocket::deflate_enabled() const
+	{
+		return _deflate != nullptr;
+	}
+
+	const std::string& HTTPWebSocket::protocol() const
+	{
+		return _protocol;
+	}
+
+	HTTPWebSocket::~HTTPWebSocket()
+	{
+		// Going away, without waiting for the server to answer
+		if (_socket && !_closeSent)
+		{
+			constexpr std::array<uint8_t, 2> goingAway = { 0x03, 0xE9 };
+			send_frame(HTTPWebSocketOpcode::Close, goingAway);
+		}
+
+		fail();
+	}
+
+	HTTPErr HTTPWebSocket::send_message(HTTPWebSocketOpcode opcode, std::span<const uint8_t> payload)
+	{
+#if defined(HTTP_USE_ZLIB)
+		if (_deflate && payload.size() >= DEFLATE_THRESHOLD)
+		{
+			Deflate& deflate = *_deflate;
+
+			deflate.compressed.resize(deflateBound(&deflate.deflater, static_cast<uLong>(payload.size())) + 16);
+			deflate.deflater.next_in = const_cast<Bytef*>(payload.data());
+			deflate.deflater.avail_in = static_cast<uInt>(payload.size());
+			deflate.deflater.next_out = deflate.compressed.data();
+			deflate.deflater.avail_out = static_cast<uInt>(deflate.compressed.size());
+
+			int result = ::deflate(&deflate.deflater, Z_SYNC_FLUSH);
+			if (result != Z_OK || deflate.deflater.avail_in != 0)
+			{
+				HTTP_LOG_WARN("Failed to deflate WebSocket message: {}", result);
+				return HTTPErr::SendFailed;
+			}
+
+			size_t size = deflate.compressed.size() - deflate.deflater.avail_out;
+			if (size >= DEFLATE_TAIL.size())
+				size -= DEFLATE_TAIL.size();
+
+			if (deflate.resetDeflater)
+				deflateReset(&deflate.deflater);
+
+			return send_frame(opcode, std::span<const uint8_t>(deflate.compressed.data(), size), true);
+		}
+#endif
+
+		return send_frame(opcode, payload);
+	}
+
+	HTTPErr HTTPWebSocket::send_frame(HTTPWebSocketOpcode opcode, std::span<const uint8_t> payload, bool compressed)
+	{
+		if (!_socket)
+		{
+			return HTTPErr::WebSocketClosed;
+		}
+
+		// Header and payload go out in one write, the payload masked in place after it is copied in
+		size_t size = payload.size();
+		_send.resize(14 + size);
+		uint8_t* out = _send.data();
+		size_t headerSize = 0;
+
+		out[headerSize++] = static_cast<uint8_t>(0x80 | (compressed ? 0x40 : 0) | static_cast<uint8_t>(opcode));
+		if (size < 126)
+		{
+			out[headerSize++] = static_cast<uint8_t>(0x80 | size);
+		}
+		else if (size <= 0xFFFF)
+		{
+			out[headerSize++] = 0x80 | 126;
+			out[headerSize++] = static_cast<uint8_t>(size >> 8);
+			out[headerSize++] = static_cast<uint8_t>(size & 0xFF);
+		}
+		else
+		{
+			out[headerSize++] = 0x80 | 127;
+			for (int i = 7; i >= 0; i--)
+				out[headerSize++] = static_cast<uint8_t>((static_cast<uint64_t>(size) >> (i * 8)) & 0xFF);
+		}
+
+		// Keys come from the system CSPRNG in batches, one read covers many frames
+		if (_maskKeyOffset == _maskKeys.size())
+		{
+			if (!fill_random(_maskKeys))
+			{
+				HTTP_LOG_ERROR("Failed to read the system random source.");
+				return HTTPErr::RandomSourceFailed;
+			}
+			_maskKeyOffset = 0;
+		}
+
+		std::array<uint8_t, 4> key;
+		std::memcpy(key.data(), _maskKeys.data() + _maskKeyOffset, 4);
+		_maskKeyOffset += 4;
+		std::memcpy(out + headerSize, key.data(), 4);
+		headerSize += 4;
+
+		if (size > 0)
+		{
+			std::memcpy(out + headerSize, payload.data(), size);
+			mask_websocket_payload(std::span<uint8_t>(out + headerSize, size), key);
+		}
+
+		HTTPStream stream(*_socket);
+
+		asio::error_code ec;
+		asio::write(stream, asio::buffer(out, headerSize + size), ec);
+		if (ec)
+		{
+			HTTP_LOG_WARN("Error sending WebSocket frame: {}:{}", ec.category().name(), ec.value());
+			fail();
+			return to_http_err(ec, HTTPErr::SendFailed);
+		}
+
+		return HTTPErr::None;
+	}
+
+	HTTPErr HTTPWebSocket::fill(size_t needed)
+	{
+		if (_size - _start >= needed)
+		{
+			return HTTPErr::None;
+		}
+
+		if (!_socket)
+		{
+			return HTTPErr::WebSocketClosed;
+		}
+
+		if (_receive.size() - _start < needed)
+		{
+			if (_start > 0)
+			{
+				std::memmove(_receive.data(), _receive.data() + _start, _size - _start);
+				_size -= _start;
+				_start = 0;
+			}
+
+			if (_receive.size() < needed)
+				_receive.resize(std::max(needed, _receive.size() * 2));
+		}
+
+		HTTPStream stream(*_socket);
+
+		// Everything the socket has goes in at once, so a burst of small messages costs one read
+		while (_size - _start < needed)
+		{
+			asio::error_code ec;
+			size_t received = stream.read_some(asio::buffer(_receive.data() + _size, _receive.size() - _size), ec);
+			if (ec)
+			{
+				HTTP_LOG_WARN("Error reading WebSocket frame: {}:{}", ec.category().name(), ec.value());
+				fail();
+				return to_http_err(ec, HTTPErr::ReceiveFailed);
+			}
+
+			_size += received;
+		}
+
+		return HTTPErr::None;
+	}
+
+	void HTTPWebSocket::fail()
+	{
+		if (!_socket)
+			return;
+
+		asio::error_code ignored;
+		_socket->shutdown(HTTPSocket::shutdown_both, ignored);
+		_socket->close(ignored);
+		_socket.reset();
+	}
+
+
+	// --- Masking ---
+
+	void mask_websocket_payload(std::span<uint8_t> payload, std::array<uint8_t, 4> key, size_t offset)
+	{
+		// The key repeated and rotated so that pattern[0] lines up with payload[0]
+		alignas(32) uint8_t pattern[32];
+		for (size_t i = 0; i < sizeof(pattern); i++)
+			pattern[i] = key[(offset + i) % 4];
+
+		uint8_t* data = payload.data();
+		size_t size = payload.size();
+		size_t i = 0;
+
+#if defined(HTTP_WS_AVX2)
+		__m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(pattern));
+		for (; i + 32 <= size; i += 32)
+		{
+			__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(chunk, mask));
+		}
+#elif defined(HTTP_WS_SSE2)
+		__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+		for (; i + 16 <= size; i += 16)
+		{
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(chunk, mask));
+		}
+#elif defined(HTTP_WS_NEON)
+		uint8x16_t mask = vld1q_u8(pattern);
+		for (; i + 16 <= size; i += 16)
+			vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), mask));
+#endif
+
+		uint64_t wide;
+		std::memcpy(&wide, pattern, sizeof(wide));
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t chunk;
+			std::memcpy(&chunk, data + i, sizeof(chunk));
+			chunk ^= wide;
+			std::memcpy(data + i, &chunk, sizeof(chunk));
+		}
+
+		for (; i < size; i++)
+			data[i] ^= pattern[i % 4];
+	}
+
+}
@@ -0,0 +1,284 @@
+#include "headers.h"
+#include "http_communicator.h"
+#include "http_runtime.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+// Every copy of a body needs a buffer at least as large as the body. Counting the allocations that large while a
+// response is read counts the body buffer itself plus one per copy made on the way to the caller
+
+namespace
+{
+	std::atomic<size_t> largeThreshold = SIZE_MAX;
+	std::atomic<size_t> largeAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+	if (size >= largeThreshold.load(std::memory_order_relaxed))
+		largeAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (!memory)
+		std::abort();
+
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+
+namespace communicator
+{
+
+	namespace
+	{
+		constexpr size_t BODY_SIZE = 4 * 1024 * 1024;
+
+		std::string body_response(std::string_view contentType, size_t size = BODY_SIZE)
+		{
+			std::string body(size, 'x');
+			return std::format("HTTP/1.1 200 OK\r\nContent-Type: {}\r\nContent-Length: {}\r\n\r\n", contentType, body.size()) + body;
+		}
+
+		class BodyServer
+		// Accepts one connection and answers every request on it with the same response
+		{
+		public:
+
+			explicit BodyServer(std::string response)
+				: _acceptor(_ioContext, asio::ip::tcp::endpoint(asio::ip::make_address("127.0.0.1"), 0)), _response(std::move(response))
+			{
+				// Built before anything is counted, the server only ever writes it
+				_thread = std::thread([this]() { serve(); });
+			}
+
+			~BodyServer()
+			{
+				_thread.join();
+			}
+
+			std::string url() const
+			{
+				return std::format("http://127.0.0.1:{}/", _acceptor.local_endpoint().port());
+			}
+
+		private:
+
+			void serve()
+			{
+				asio::ip::tcp::socket socket(_ioContext);
+
+				asio::error_code ec;
+				_acceptor.accept(socket, ec);
+				if (ec)
+					return;
+
+				// Until the client closes the connection
+				asio::streambuf request;
+				while (true)
+				{
+					size_t bytes = asio::read_until(socket, request, "\r\n\r\n", ec);
+					if (ec)
+						return;
+					request.consume(bytes);
+
+					asio::write(socket, asio::buffer(_response), ec);
+					if (ec)
+						return;
+				}
+			}
+
+		private:
+
+			asio::io_context _ioContext;
+			asio::ip::tcp::acceptor _acceptor;
+			std::string _response;
+			std::thread _thread;
+		};
+
+		class BodyCopies
+		// Counts the allocations of a full body made from its construction on
+		{
+		public:
+
+			BodyCopies()
+			{
+				largeAllocations.store(0);
+				largeThreshold.store(BODY_SIZE);
+			}
+
+			~BodyCopies()
+			{
+				largeThreshold.store(SIZE_MAX);
+			}
+
+			size_t count() const
+			{
+				return largeAllocations.load();
+			}
+		};
+	}
+
+
+	TEST(BodyCopies, GetReadsTextBodyIntoOneBuffer)
+	{
+		BodyServer server(body_response("text/plain"));
+
+		BodyCopies copies;
+		auto output = get(server.url());
+
+		ASSERT_TRUE(output.has_value());
+		ASSERT_EQ(std::get<std::string>(output->body).size(), BODY_SIZE);
+		EXPECT_EQ(copies.count(), 1);
+	}
+
+	TEST(BodyCopies, GetReadsBinaryBodyIntoOneBuffer)
+	{
+		BodyServer server(body_response("application/octet-stream"));
+
+		BodyCopies copies;
+		auto output = get(server.url());
+
+		ASSERT_TRUE(output.has_value());
+		ASSERT_EQ(std::get<std::vector<uint8_t>>(output->body).size(), BODY_SIZE);
+		EXPECT_EQ(copies.count(), 1);
+	}
+
+	TEST(BodyCopies, GetStringMovesTheBodyOut)
+	{
+		BodyServer server(body_response("text/plain"));
+		HTTPCommunicator communicator(server.url(), {}, 10);
+
+		BodyCopies copies;
+		auto body = communicator.get_string("/");
+
+		ASSERT_TRUE(body.has_value());
+		ASSERT_EQ(body->size(), BODY_SIZE);
+		EXPECT_EQ(copies.count(), 1);
+	}
+
+	TEST(BodyCopies, GetBytesMovesTheBodyOut)
+	{
+		BodyServer server(body_response("application/octet-stream"));
+		HTTPCommunicator communicator(server.url(), {}, 10);
+
+		BodyCopies copies;
+		auto body = communicator.get_bytes("/");
+
+		ASSERT_TRUE(body.has_value());
+		ASSERT_EQ(body->size(), BODY_SIZE);
+		EXPECT_EQ(copies.count(), 1);
+	}
+
+	TEST(BodyCopies, RuntimeReadsBodyIntoOneBuffer)
+	{
+		BodyServer server(body_response("text/plain"));
+		HTTPRuntimeOptions options;
+		options.shards = 1;
+		options.pinThreads = false;
+		HTTPRuntime runtime(options);
+
+		BodyCopies copies;
+		auto output = runtime.get(server.url()).get();
+
+		ASSERT_TRUE(output.has_value());
+		ASSERT_EQ(std::get<std::string>(output->body).size(), BODY_SIZE);
+		EXPECT_EQ(copies.count(), 1);
+	}
+
+
+	TEST(BodyLimits, GetRefusesContentLengthOverTheLimit)
+	{
+		// Nothing is reserved for a length the server only claims
+		BodyServer server("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 99999999999999\r\n\r\nxxxx");
+
+		auto output = get(server.url());
+
+		ASSERT_FALSE(output.has_value());
+		EXPECT_EQ(output.error(), HTTPErr::InvalidContentLength);
+	}
+
+	TEST(BodyLimits, GetRefusesChunkOverTheLimit)
+	{
+		BodyServer server("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\nFFFFFFFFFFFF\r\nxxxx");
+
+		auto output = get(server.url());
+
+		ASSERT_FALSE(output.has_value());
+		EXPECT_EQ(output.error(), HTTPErr::MessageTooLarge);
+	}
+
+	TEST(BodyLimits, GetGrowsBodyPastTheReservation)
+	{
+		BodyServer server(body_response("text/plain", HTTP_BODY_RESERVE_SIZE * 2 + 3));
+
+		auto output = get(server.url());
+
+		ASSERT_TRUE(output.has_value());
+		const std::string& body = std::get<std::string>(output->body);
+		EXPECT_EQ(body.size(), HTTP_BODY_RESERVE_SIZE * 2 + 3);
+		EXPECT_EQ(body.find_first_not_of('x'), std::string::npos);
+	}
+
+
+	TEST(BodyLimits, RuntimeRefusesContentLengthOverTheLimit)
+	{
+		BodyServer server("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 99999999999999\r\n\r\nxxxx");
+		HTTPRuntimeOptions options;
+		options.shards = 1;
+		options.pinThreads = false;
+		HTTPRuntime runtime(options);
+
+		auto output = runtime.get(server.url()).get();
+
+		ASSERT_FALSE(output.has_value());
+		EXPECT_EQ(output.error(), HTTPErr::InvalidContentLength);
+	}
+
+	TEST(BodyLimits, RuntimeGrowsBodyPastTheReservation)
+	{
+		BodyServer server(body_response("application/octet-stream", HTTP_BODY_RESERVE_SIZE * 2 + 3));
+		HTTPRuntimeOptions options;
+		options.shards = 1;
+		options.pinThreads = false;
+		HTTPRuntime runtime(options);
+
+		auto output = runtime.get(server.url()).get();
+
+		ASSERT_TRUE(output.has_value());
+		const auto& body = std::get<std::vector<uint8_t>>(output->body);
+		EXPECT_EQ(body.size(), HTTP_BODY_RESERVE_SIZE * 2 + 3);
+		EXPECT_EQ(std::count(body.begin(), body.end(), 'x'), static_cast<std::ptrdiff_t>(body.size()));
+	}
+
+
+	TEST(RequestTimeouts, RuntimeFailsAStalledResponse)
+	{
+		// The head never ends, the server waits on the next request until the runtime gives up and closes
+		BodyServer server("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n");
+		HTTPRuntimeOptions options;
+		options.shards = 1;
+		options.pinThreads = false;
+		options.requestTimeout = std::chrono::milliseconds(200);
+		HTTPRuntime runtime(options);
+
+		auto output = runtime.get(server.url()).get();
+
+		ASSERT_FALSE(output.has_value());
+		EXPECT_EQ(output.error(), HTTPErr::RequestTimeout);
+	}
+}
@@ -30,7 +30,45 @@ newoption
     description = "Include the Google Testing Library"
 }
 
+newoption 
+{
+    trigger = "with-timing",
+    description = "Record per-request phase timings on HTTPOutput"
+}
+
+newoption 
+{
+    trigger = "log-level",
+    value = "LEVEL",
+    description = "Lowest log level compiled into the library",
+    allowed = 
+    {
+        { "trace", "Trace" },
+        { "debug", "Debug" },
+        { "info", "Info" },
+        { "warn", "Warn" },
+        { "error", "Error" },
+        { "off", "Off" },
+    }
+}
+
+newoption 
+{
+    trigger = "with-io-uring",
+    description = "Run socket I/O through io_uring on Linux (requires liburing)"
+}
+
+newoption 
+{
+    trigger = "with-zlib",
+    description = "Enable permessage-deflate for WebSockets (requires zlib)"
+}
+
 
 
 group "https-communicator"
-    include "https-communicator/https-communicator.lua"
\ No newline at end of file
+    include "https-communicator/https-communicator.lua"
+
+    if _OPTIONS["with-gtest"] then
+        include "https-communicator/https-communicator-tests.lua"
+    end
\ No newline at end of file